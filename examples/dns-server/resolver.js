@@ -13,11 +13,12 @@ import { decodeMessage, buildQuery, TYPE, RCODE } from './dns-message.js';
 import { ROOT_SERVERS } from './root-hints.js';
 import { Cache } from './cache.js';
 import { toArrayBuffer, concatBytes } from './bytes.js';
+import { LWSByteQueue } from 'lws';
 
 export function createResolver({ timeoutMs = 4000, maxHops = 32, maxGlueDepth = 2 } = {}) {
   const cache = new Cache();
   const pendingUdp = new Map(); // wsi -> { queryBuf, resolve, reject }
-  const pendingTcp = new Map(); // wsi -> { queryBuf, chunks, resolve, reject }
+  const pendingTcp = new Map(); // wsi -> { queryBuf, rx, resolve, reject }
   let ctx;
   let nextId = 1;
 
@@ -89,7 +90,7 @@ export function createResolver({ timeoutMs = 4000, maxHops = 32, maxGlueDepth =
         return;
       }
 
-      pendingTcp.set(wsi, { queryBuf, chunks: [], resolve: d => finish(null, d), reject: e => finish(e) });
+      pendingTcp.set(wsi, { queryBuf, rx: new LWSByteQueue(), resolve: d => finish(null, d), reject: e => finish(e) });
     });
   }
 
@@ -122,13 +123,19 @@ export function createResolver({ timeoutMs = 4000, maxHops = 32, maxGlueDepth =
         const p = pendingTcp.get(wsi);
         if(!p) return;
 
-        p.chunks.push(new Uint8Array(data));
+        // Chunks are queued as they are; only the reply itself gets
+        // gathered into one piece, once all of it has arrived.
+        p.rx.push(data);
 
-        const merged = concatBytes(p.chunks);
-        if(merged.length < 2) return;
+        const prefix = p.rx.peek(2);
+        if(!prefix) return;
 
-        const msgLen = (merged[0] << 8) | merged[1];
-        if(merged.length >= 2 + msgLen) p.resolve(merged.subarray(2, 2 + msgLen));
+        const msgLen = (prefix[0] << 8) | prefix[1];
+
+        if(p.rx.length >= 2 + msgLen) {
+          p.rx.skip(2);
+          p.resolve(p.rx.read(msgLen));
+        }
       },
       onRawClose(wsi) {
         pendingTcp.get(wsi)?.reject(new Error('tcp socket closed before a reply arrived'));
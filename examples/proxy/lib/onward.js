@@ -46,7 +46,7 @@ function dialRaw(host, port, onward) {
   return session.opened;
 }
 
-/** Bidirectionally pumps bytes between two `{readable, writable}` pairs until either side ends. Neither stream may already have an active reader/writer lock. */
+/** Bidirectionally pumps bytes between two `{readable, writable}` pairs until either side ends. Neither stream may already have an active reader/writer lock. Between two socket legs, each pipeTo() is a native wsi.splice() - no chunk goes through JS; a `prependTo()`-wrapped readable still takes the JS path. */
 export function pipePair(a, b) {
   return Promise.all([a.readable.pipeTo(b.writable).catch(() => {}), b.readable.pipeTo(a.writable).catch(() => {})]);
 }
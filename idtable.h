@@ -0,0 +1,125 @@
+#ifndef IDTABLE_H
+#define IDTABLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Open-addressing (linear probing) map from a non-zero 32-bit id to a
+   pointer - the LWSSocket.get(id) index (lws-socket.c). Ids there are
+   handed out sequentially and never reused, so a Fibonacci-hashed id
+   spreads evenly without any further mixing. Removed slots become
+   tombstones (id != 0, ptr == NULL) so probe chains past them stay intact;
+   they're dropped the next time the table is rebuilt, which happens once
+   live entries plus tombstones pass 3/4 of the slots. Kept free of
+   QuickJS/lws dependencies so tests/bench/bench-idtable.c can build it on
+   its own. */
+typedef struct {
+  uint32_t id;
+  void* ptr;
+} IdTableEntry;
+
+typedef struct {
+  IdTableEntry* slots;
+  uint32_t size, count, used;
+} IdTable;
+
+#define IDTABLE_MIN_SIZE 64
+
+static inline uint32_t
+idtable_hash(const IdTable* t, uint32_t id) {
+  return (id * 2654435769u) & (t->size - 1);
+}
+
+static IdTableEntry*
+idtable_slot(const IdTable* t, uint32_t id) {
+  uint32_t i = idtable_hash(t, id);
+
+  for(;;) {
+    IdTableEntry* e = &t->slots[i];
+
+    if(e->id == id || e->id == 0)
+      return e;
+
+    i = (i + 1) & (t->size - 1);
+  }
+}
+
+static void*
+idtable_get(const IdTable* t, uint32_t id) {
+  if(!t->slots || id == 0)
+    return NULL;
+
+  return idtable_slot(t, id)->ptr;
+}
+
+static int
+idtable_resize(IdTable* t, uint32_t size) {
+  IdTableEntry *old = t->slots, *slots;
+  uint32_t old_size = t->size;
+
+  if(!(slots = calloc(size, sizeof(IdTableEntry))))
+    return -1;
+
+  t->slots = slots;
+  t->size = size;
+  t->used = t->count;
+
+  for(uint32_t i = 0; i < old_size; i++)
+    if(old[i].ptr)
+      *idtable_slot(t, old[i].id) = old[i];
+
+  free(old);
+  return 0;
+}
+
+static int
+idtable_put(IdTable* t, uint32_t id, void* ptr) {
+  IdTableEntry* e;
+
+  if(!t->slots || (t->used + 1) * 4 > t->size * 3) {
+    uint32_t size = t->size ? t->size : IDTABLE_MIN_SIZE;
+
+    /* Only grow if it's live entries filling the table - if it's mostly
+       tombstones, rebuilding at the same size is enough. */
+    while((t->count + 1) * 2 > size)
+      size *= 2;
+
+    if(idtable_resize(t, size))
+      return -1;
+  }
+
+  e = idtable_slot(t, id);
+
+  if(!e->ptr) {
+    if(e->id == 0)
+      t->used++;
+
+    t->count++;
+  }
+
+  e->id = id;
+  e->ptr = ptr;
+  return 0;
+}
+
+static void
+idtable_remove(IdTable* t, uint32_t id) {
+  IdTableEntry* e;
+
+  if(!t->slots || id == 0)
+    return;
+
+  if((e = idtable_slot(t, id))->ptr) {
+    e->ptr = NULL;
+    t->count--;
+  }
+}
+
+static void
+idtable_free(IdTable* t) {
+  free(t->slots);
+  t->slots = NULL;
+  t->size = t->count = t->used = 0;
+}
+
+#endif /* defined IDTABLE_H */
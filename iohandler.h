@@ -6,87 +6,79 @@
 #include <list.h>
 #include "lws.h"
 
-typedef struct {
-  struct list_head link;
-  int fd;
-  BOOL write;
-} HandlerFunction;
-
-static JSValue
-iohandler_function(JSContext* ctx, BOOL write) {
-  JSValue glob = JS_GetGlobalObject(ctx);
-  JSValue os = JS_GetPropertyStr(ctx, glob, "os");
-  JS_FreeValue(ctx, glob);
-  JSValue fn = JS_GetPropertyStr(ctx, os, write ? "setWriteHandler" : "setReadHandler");
-  JS_FreeValue(ctx, os);
-  return fn;
-}
-
-static HandlerFunction*
-iohandler_find(LWSContext* lws, int fd, BOOL write) {
-  struct list_head* el;
-
-  list_for_each(el, &lws->handlers) {
-    HandlerFunction* hf = list_entry(el, HandlerFunction, link);
-
-    if(hf->fd == fd && hf->write == write)
-      return hf;
+#define IOHANDLER_READ 1
+#define IOHANDLER_WRITE 2
+
+/* os.setReadHandler / os.setWriteHandler, looked up through the global
+   object once per context and kept in lws->os_handlers[] - they're called
+   on every registration change, which on a busy server is thousands of
+   times a second. Returns a borrowed reference. */
+static JSValueConst
+iohandler_function(LWSContext* lws, BOOL write) {
+  if(JS_IsUndefined(lws->os_handlers[write])) {
+    JSValue glob = JS_GetGlobalObject(lws->js);
+    JSValue os = JS_GetPropertyStr(lws->js, glob, "os");
+    JS_FreeValue(lws->js, glob);
+    lws->os_handlers[write] = JS_GetPropertyStr(lws->js, os, write ? "setWriteHandler" : "setReadHandler");
+    JS_FreeValue(lws->js, os);
   }
 
-  return NULL;
+  return lws->os_handlers[write];
 }
 
-static HandlerFunction*
-iohandler_add(LWSContext* lws, int fd, BOOL write) {
-  HandlerFunction* hf;
-
-  if((hf = iohandler_find(lws, fd, write)))
-    return hf;
+/* fd's slot in lws->fds, growing the table if fd is past its end. NULL on
+   allocation failure. */
+static LWSFdSlot*
+iohandler_slot(LWSContext* lws, int fd) {
+  if(fd < 0)
+    return NULL;
 
-  if((hf = js_malloc(lws->js, sizeof(HandlerFunction)))) {
-    hf->fd = fd;
-    hf->write = write;
+  if(fd >= lws->nfds) {
+    int i, n = lws->nfds ? lws->nfds : 64;
+    LWSFdSlot* fds;
 
-    DEBUG("%s %d %s", __func__, fd, write ? "write" : "read");
+    while(n <= fd)
+      n *= 2;
 
-    list_add(&hf->link, &lws->handlers);
-    return hf;
-  }
-
-  return 0;
-}
+    if(!(fds = js_realloc(lws->js, lws->fds, n * sizeof(LWSFdSlot))))
+      return NULL;
 
-static BOOL
-iohandler_remove(LWSContext* lws, int fd, BOOL write) {
-  HandlerFunction* hf;
+    for(i = lws->nfds; i < n; i++)
+      fds[i] = (LWSFdSlot){.pollfd = {JS_UNDEFINED, JS_UNDEFINED}};
 
-  if((hf = iohandler_find(lws, fd, write))) {
-    DEBUG("%s %d %s", __func__, fd, write ? "write" : "read");
-
-    list_del(&hf->link);
-    js_free(lws->js, hf);
-    return TRUE;
+    lws->fds = fds;
+    lws->nfds = n;
   }
 
-  return FALSE;
+  return &lws->fds[fd];
 }
 
+/* Registers (handler is a function) or clears (anything else) fd's read
+   or write handler with quickjs-libc. Clearing a handler this context
+   never set is a no-op. */
 static void
 iohandler_set(LWSContext* lws, int fd, JSValueConst handler, BOOL write) {
-  JSValue fn = iohandler_function(lws->js, write);
-  JSValue args[2] = {JS_NewInt32(lws->js, fd), handler};
   BOOL add = JS_IsFunction(lws->js, handler);
+  int bit = write ? IOHANDLER_WRITE : IOHANDLER_READ;
+  LWSFdSlot* slot;
 
-  DEBUG("%s %d %s", write ? "os.setWriteHandler" : "os.setReadHandler", fd, add ? "[function]" : "NULL");
+  if(add) {
+    if(!(slot = iohandler_slot(lws, fd)))
+      return;
 
-  if(add)
-    iohandler_add(lws, fd, write);
-  else
-    iohandler_remove(lws, fd, write);
+    slot->handlers |= bit;
+  } else {
+    if(fd < 0 || fd >= lws->nfds || !(lws->fds[fd].handlers & bit))
+      return;
 
-  JSValue ret = JS_Call(lws->js, fn, JS_NULL, 2, args);
+    lws->fds[fd].handlers &= ~bit;
+  }
+
+  DEBUG("%s %d %s", write ? "os.setWriteHandler" : "os.setReadHandler", fd, add ? "[function]" : "NULL");
+
+  JSValue args[2] = {JS_NewInt32(lws->js, fd), add ? handler : JS_NULL};
+  JSValue ret = JS_Call(lws->js, iohandler_function(lws, write), JS_NULL, 2, args);
   JS_FreeValue(lws->js, ret);
-  JS_FreeValue(lws->js, fn);
 }
 
 static void
@@ -95,17 +87,36 @@ iohandler_clear(LWSContext* lws, int fd) {
   iohandler_set(lws, fd, JS_NULL, TRUE);
 }
 
+/* Clears every handler this context has registered. */
 static void
 iohandler_cleanup(LWSContext* lws) {
-  struct list_head *el, *next;
-
-  list_for_each_safe(el, next, &lws->handlers) {
-    HandlerFunction* hf = list_entry(el, HandlerFunction, link);
+  for(int fd = 0; fd < lws->nfds; fd++) {
+    if(lws->fds[fd].handlers) {
+      DEBUG("delete handlers (fd = %d, %s%s)", fd, lws->fds[fd].handlers & IOHANDLER_READ ? "read" : "", lws->fds[fd].handlers & IOHANDLER_WRITE ? "write" : "");
 
-    DEBUG("delete handler (fd = %d, %s)", hf->fd, hf->write ? "write" : "read");
+      iohandler_clear(lws, fd);
+    }
+  }
+}
 
-    iohandler_set(lws, hf->fd, JS_NULL, hf->write);
+/* Drops the fd table along with its cached closures and the cached os
+   functions. Doesn't call into JS, so it's safe from a finalizer;
+   quickjs-libc keeps its own references to whatever is still
+   registered. */
+static void
+iohandler_free(LWSContext* lws) {
+  for(int fd = 0; fd < lws->nfds; fd++) {
+    JS_FreeValue(lws->js, lws->fds[fd].pollfd[0]);
+    JS_FreeValue(lws->js, lws->fds[fd].pollfd[1]);
   }
+
+  js_free(lws->js, lws->fds);
+  lws->fds = NULL;
+  lws->nfds = 0;
+
+  JS_FreeValue(lws->js, lws->os_handlers[0]);
+  JS_FreeValue(lws->js, lws->os_handlers[1]);
+  lws->os_handlers[0] = lws->os_handlers[1] = JS_UNDEFINED;
 }
 
 #endif /* defined IOHANDLER_H */
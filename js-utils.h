@@ -29,6 +29,7 @@ char** to_stringarray(JSContext*, JSValueConst);
 JSValue from_stringarray(JSContext* ctx, const char* const* strs);
 void str_or_buf_property(const char**, const void**, unsigned int*, JSContext*, JSValueConst, const char*);
 size_t get_offset_length(JSContext*, int, JSValueConst[], size_t, size_t*);
+JSValue get_typedarray_buffer(JSContext*, JSValueConst, size_t*, size_t*);
 void* get_buffer(JSContext*, int, JSValueConst[], size_t*);
 JSValue js_function_cclosure(JSContext*, CClosureFunc*, int, int, void*, void (*opaque_finalize)(void*));
 JSValue js_invoke_deferred(JSContext*, JSValueConst obj, const char* method_name, int argc, JSValueConst argv[]);
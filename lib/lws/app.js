@@ -14,7 +14,7 @@
  * handler is equivalent to calling `next(err)`.
  */
 
-import { LWSContext, LWSMPRO_CALLBACK } from 'lws.so';
+import { LWSContext, LWSRouter, LWSMPRO_CALLBACK } from 'lws.so';
 import { http } from './protocols.js';
 
 /* ServerRequest/ServerResponse now live in ./request.js/./response.js
@@ -36,6 +36,10 @@ export { ServerResponse } from './response.js';
  * - When `end` is false (mount prefixes), the regex anchors at a `/`
  *   boundary instead of EOL, so `app.use('/api', …)` matches both
  *   `/api` and `/api/users/42`.
+ *
+ * App/Router and serve()'s `routes` only take `keys` from here: they
+ * match with an `LWSRouter` (lws-router.c), which follows the same rules
+ * in a radix tree instead of running one regex per route.
  */
 export function compilePath(pattern, end = true) {
   if(pattern === '*' || pattern === '/*') return { regex: /^.*/, keys: [] };
@@ -66,10 +70,9 @@ export function compilePath(pattern, end = true) {
 const METHODS = ['get', 'post', 'put', 'delete', 'patch', 'head', 'options'];
 
 class Layer {
-  constructor({ method, prefix, regex, keys, handler }) {
+  constructor({ method, prefix, keys, handler }) {
     this.method = method; // null for use(), 'GET' etc. otherwise
     this.prefix = prefix; // for stripping mount paths (sub-routers)
-    this.regex = regex;
     this.keys = keys;
     this.handler = handler;
     this.isError = handler.length === 4;
@@ -82,6 +85,7 @@ class Layer {
  */
 export class App {
   layers = [];
+  #router = new LWSRouter();
 
   use(arg, ...rest) {
     let path = '/',
@@ -95,12 +99,13 @@ export class App {
 
     for(const h of handlers.flat()) {
       if(h instanceof App) {
-        const { regex, keys } = compilePath(path, false);
-        this.layers.push(
+        const { keys } = compilePath(path, false);
+        this.#push(
+          path,
+          false,
           new Layer({
             method: null,
             prefix: path,
-            regex,
             keys,
             handler: (req, res, next) => {
               const saved = req.path;
@@ -119,8 +124,8 @@ export class App {
           }),
         );
       } else if(typeof h === 'function') {
-        const { regex, keys } = compilePath(path, false);
-        this.layers.push(new Layer({ method: null, prefix: path, regex, keys, handler: h }));
+        const { keys } = compilePath(path, false);
+        this.#push(path, false, new Layer({ method: null, prefix: path, keys, handler: h }));
       }
     }
 
@@ -131,31 +136,38 @@ export class App {
    * Internal: register a method+path handler.
    */
   _route(method, path, handlers) {
-    const { regex, keys } = compilePath(path, true);
-    for(const h of handlers.flat()) if(typeof h === 'function') this.layers.push(new Layer({ method, prefix: '/', regex, keys, handler: h }));
+    const { keys } = compilePath(path, true);
+    for(const h of handlers.flat()) if(typeof h === 'function') this.#push(path, true, new Layer({ method, prefix: '/', keys, handler: h }));
     return this;
   }
 
+  /* Layer i is route i of #router - add() hands out indices in order. */
+  #push(path, end, layer) {
+    this.#router.add(path, end);
+    this.layers.push(layer);
+  }
+
   /**
    * Run the chain. Resolves to `true` if a handler responded, `false`
    * otherwise — App.listen()'s onHttp uses the latter to emit a 404.
    */
   async dispatch(req, res) {
-    const layers = this.layers;
+    const layers = this.layers,
+      router = this.#router;
     let i = 0,
       responded = false;
 
     const next = err => run(err);
 
     const run = async err => {
-      while(i < layers.length) {
-        const layer = layers[i++];
+      /* m is [index, ...params] of the next layer whose path matches -
+         req.path is re-read each time, a mount may have changed it. */
+      for(let m; (m = router.match(req.path, i)); ) {
+        const layer = layers[m[0]];
+        i = m[0] + 1;
 
         if(layer.method && layer.method !== req.method) continue;
 
-        const m = layer.regex.exec(req.path);
-        if(!m) continue;
-
         for(let k = 0; k < layer.keys.length; k++) req.params[layer.keys[k]] = decodeURIComponent(m[k + 1]);
 
         if(err && !layer.isError) continue;
@@ -1,18 +1,24 @@
+import { LWSByteQueue } from 'lws.so';
+
 // Bridges the push-driven onRawRx callback into pull-style reads, so the
 // frame decoder below can be written top-to-bottom like a synchronous
 // parser (mirrors readFully()'s contract: resolves the requested number of
-// bytes, or null once closed).
+// bytes, or null once closed). The bytes sit in an LWSByteQueue
+// (lws-byte-queue.c), which keeps fed chunks by reference - feeding costs
+// no copy, and a read that falls within one chunk resolves to a view onto
+// it. With a protocol's zeroCopyRx on, feed a .slice() of the rx buffer:
+// that one is detached once onRawRx returns.
 export class ByteQueue {
-  #buf = new Uint8Array(0);
+  #queue = new LWSByteQueue();
   #closed = false;
-  #waiting = null; // { n, resolve }
+  #waiting = null; // { n, delimiter, resolve }
+
+  get length() {
+    return this.#queue.length;
+  }
 
   feed(chunk) {
-    const add = new Uint8Array(chunk);
-    const buf = new Uint8Array(this.#buf.length + add.length);
-    buf.set(this.#buf, 0);
-    buf.set(add, this.#buf.length);
-    this.#buf = buf;
+    this.#queue.push(chunk);
     this.#check();
   }
 
@@ -28,18 +34,26 @@ export class ByteQueue {
     });
   }
 
+  /** Resolves with everything up to and including `delimiter` (a byte value, string or buffer), or null once closed without one. */
+  readUntil(delimiter) {
+    return new Promise(resolve => {
+      this.#waiting = { delimiter, resolve };
+      this.#check();
+    });
+  }
+
   #check() {
     if(!this.#waiting) return;
 
-    const { n, resolve } = this.#waiting;
+    const { n, delimiter, resolve } = this.#waiting;
+    const bytes = delimiter === undefined ? this.#queue.read(n) : this.#queue.readUntil(delimiter);
 
-    if(this.#buf.length >= n) {
-      resolve(this.#buf.slice(0, n));
-      this.#buf = this.#buf.subarray(n);
+    if(bytes) {
       this.#waiting = null;
+      resolve(bytes);
     } else if(this.#closed) {
-      resolve(null);
       this.#waiting = null;
+      resolve(null);
     }
   }
 }
@@ -1,5 +1,8 @@
 export class Headers {
   #map = Object.setPrototypeOf({}, null);
+  /* Read-only source get() and has() go to until something needs #map -
+     see fromLWSHeaders(). */
+  #native;
 
   /**
    * Constructs a Headers object
@@ -8,7 +11,15 @@ export class Headers {
    */
   constructor(headers) {
     if(headers instanceof Headers) {
-      headers.forEach((value, name) => this.append(name, value));
+      /* Already normalized - copy the map as-is (set-cookie arrays
+         included, so the two don't share one). A native source is
+         read-only, so both can keep reading from it. */
+      if(headers.#native) this.#native = headers.#native;
+      else for(const name in headers.#map) {
+        const v = headers.#map[name];
+
+        this.#map[name] = Array.isArray(v) ? [...v] : v;
+      }
     } else if(Array.isArray(headers)) {
       headers.forEach(header => {
         if(header.length != 2) throw new TypeError('Expected name/value pair to be length 2, found' + header.length);
@@ -33,6 +44,52 @@ export class Headers {
     }
   }
 
+  /**
+   * Wraps a header object as the native binding hands it out (`wsi.headers`):
+   * its names come from lws's interned, already-lowercased header-name table
+   * and its values are plain strings, so both skip the normalization the
+   * constructor would apply to arbitrary input.
+   *
+   * @param  {object}  headers  `wsi.headers`
+   * @return {Headers}
+   */
+  static fromNative(headers) {
+    const h = new Headers();
+
+    for(const name in headers) h.#map[name] = headers[name];
+
+    return h;
+  }
+
+  /**
+   * Wraps an `LWSHeaders` (lws.so): get() and has() are answered by it - from
+   * lws's header table while the request is live, without building a map -
+   * and the rest copies its `toObject()` into this Headers the first time
+   * it's needed. Anything with the same get/has/toObject trio will do.
+   *
+   * @param  {LWSHeaders}  native  `new LWSHeaders(wsi)`
+   * @return {Headers}
+   */
+  static fromLWSHeaders(native) {
+    const h = new Headers();
+
+    h.#native = native;
+
+    return h;
+  }
+
+  /* Copies the native source's headers into #map, once: everything but
+     get() and has() works on #map. */
+  #materialize() {
+    if(this.#native) {
+      const headers = this.#native.toObject();
+
+      this.#native = undefined;
+
+      for(const name in headers) this.#map[name] = headers[name];
+    }
+  }
+
   /**
    * The append() method of the Headers interface appends a new value onto an existing header,
    *   or adds the header if it does not already exist.
@@ -44,6 +101,8 @@ export class Headers {
    * @param  {string} value The value of the HTTP header you want to add
    */
   append(name, value) {
+    this.#materialize();
+
     name = normalizeName(name);
     value = normalizeValue(value);
 
@@ -65,6 +124,8 @@ export class Headers {
    * @param  {string} name  The name of the HTTP header you want to delete
    */
   delete(name) {
+    this.#materialize();
+
     delete this.#map[normalizeName(name)];
   }
 
@@ -81,6 +142,8 @@ export class Headers {
   get(name) {
     name = normalizeName(name);
 
+    if(this.#native) return this.#native.get(name);
+
     if(!this.has(name)) return null;
 
     const v = this.#map[name];
@@ -95,6 +158,8 @@ export class Headers {
    * @return {string[]}
    */
   getSetCookie() {
+    this.#materialize();
+
     const v = this.#map['set-cookie'];
 
     if(v == null) return [];
@@ -109,7 +174,11 @@ export class Headers {
    * @return {boolean}
    */
   has(name) {
-    return Object.prototype.hasOwnProperty.call(this.#map, normalizeName(name));
+    name = normalizeName(name);
+
+    if(this.#native) return this.#native.has(name);
+
+    return Object.prototype.hasOwnProperty.call(this.#map, name);
   }
 
   /**
@@ -121,6 +190,8 @@ export class Headers {
    * @param  {string} value The value of the HTTP header you want to add
    */
   set(name, value) {
+    this.#materialize();
+
     name = normalizeName(name);
     value = normalizeValue(value);
     this.#map[name] = name === 'set-cookie' ? [value] : value;
@@ -136,6 +207,8 @@ export class Headers {
    * @param  {object}   thisArg   Value to use as this when executing callback.
    */
   forEach(callback, thisArg) {
+    this.#materialize();
+
     for(const name in this.#map)
       if(Object.prototype.hasOwnProperty.call(this.#map, name)) {
         const v = this.#map[name];
@@ -152,6 +225,8 @@ export class Headers {
    * @return {object}
    */
   toObject() {
+    this.#materialize();
+
     const out = {};
 
     for(const name in this.#map)
@@ -170,6 +245,8 @@ export class Headers {
    * WHATWG spec requires lexicographic sorting (case-insensitive, by normalized name).
    */
   keys() {
+    this.#materialize();
+
     const names = Object.keys(this.#map).sort();
     const items = [];
 
@@ -185,6 +262,8 @@ export class Headers {
    * WHATWG spec requires lexicographic sorting (case-insensitive, by normalized name).
    */
   values() {
+    this.#materialize();
+
     const names = Object.keys(this.#map).sort();
     const items = [];
 
@@ -204,6 +283,8 @@ export class Headers {
    * WHATWG spec requires lexicographic sorting (case-insensitive, by normalized name).
    */
   entries() {
+    this.#materialize();
+
     const names = Object.keys(this.#map).sort();
     const items = [];
 
@@ -19,7 +19,7 @@
 import { Headers } from './headers.js';
 import { Request, ServerRequest } from './request.js';
 import { Response, ServerResponse } from './response.js';
-import { ReadableStream, WritableStream } from './streams.js';
+import { ReadableStream, WritableStream, setNativeEndpoint } from './streams.js';
 import { safeClose, waitWrite } from './util.js';
 import { LWS_WRITE_HTTP, LWS_WRITE_HTTP_FINAL } from 'lws.so';
 import { MultipartMixin } from './multipart.js';
@@ -30,17 +30,19 @@ import { MultipartMixin } from './multipart.js';
    parser)`/`parser.formData()` without the rest of ServerRequest. */
 class MultipartHandle extends MultipartMixin(class {}) {}
 
-const isMultipart = headers => /^multipart\/form-data/i.test((headers && headers['content-type']) || '');
+const isMultipart = wsi => /^multipart\/form-data/i.test(wsi.header('content-type') || '');
 
 /* Per HTTP, a request only carries a body if it declares Content-Length > 0
    or chunked Transfer-Encoding - lws never fires onHttpBody/
    onHttpBodyCompletion otherwise (a bodyless GET, most commonly), so that's
-   the only reliable signal onHttp has for deciding whether to expect one. */
-const hasBody = headers => {
-  if(!headers) return false;
-  const cl = headers['content-length'];
+   the only reliable signal onHttp has for deciding whether to expect one.
+   Like isMultipart() above, this reads just the header(s) it needs through
+   wsi.header(), so a request whose handler never looks at req.headers
+   never has the whole object built. */
+const hasBody = wsi => {
+  const cl = wsi.header('content-length');
   if(cl != null && Number(cl) > 0) return true;
-  return /chunked/i.test(headers['transfer-encoding'] || '');
+  return /chunked/i.test(wsi.header('transfer-encoding') || '');
 };
 
 /**
@@ -95,13 +97,13 @@ export class HttpProtocol {
     const req = new ServerRequest(wsi);
     const resp = new ServerResponse(wsi);
 
-    if(hasBody(req.headers)) {
+    if(hasBody(wsi)) {
       /* Content-Type is already known (headers arrive before body) - a
          multipart request starts its own parse (MultipartMixin,
          ./multipart.js - ServerRequest's own base class), fed alongside
          the usual Body sink below, so req.formData() can drain it
          incrementally instead of buffering the whole body via .text(). */
-      if(isMultipart(req.headers)) req._startMultipart(wsi);
+      if(isMultipart(wsi)) req._startMultipart(wsi);
 
       this.#requests.set(wsi, req);
     } else {
@@ -352,7 +354,7 @@ export class HttpClientProtocol {
     session.resp = new Response(session.stream, {
       status,
       url: session.req.url,
-      headers: new Headers(wsi.headers),
+      headers: Headers.fromNative(wsi.headers ?? {}),
       redirected: session.redirected === true,
     });
     session.established = true;
@@ -488,6 +490,10 @@ export class WsProtocol {
   #message;
   #close;
   #closed = new WsCloseTracker();
+  /* Fragmented messages are reassembled natively (see the `reassemble`
+     option in doc/native/protocols.md), so `message` always gets one
+     whole message. */
+  reassemble = true;
 
   constructor({ name, open, message, close } = {}) {
     this.#open = open;
@@ -513,6 +519,7 @@ export class WsClientProtocol {
   #close;
   #error;
   #closed = new WsCloseTracker();
+  reassemble = true; // see WsProtocol
   #pending;
 
   constructor({ name, open, message, close, error } = {}) {
@@ -597,6 +604,46 @@ export class RawProtocol {
   onClientConnectionError = (wsi, msg) => this.#error?.(wsi, msg);
 }
 
+/*
+ * One StreamAdapter session's socket, as the native endpoint of both its
+ * streams (see setNativeEndpoint(), lib/lws/streams.js): a pipeTo() from
+ * one session's readable to another's writable becomes wsi.splice()
+ * (lws-socket.c) - the bytes go from socket to socket in C, and lws's RX
+ * flow control throttles the source while the destination has too much
+ * queued. Either socket closing closes the other, which is when the
+ * promise splice() returns settles.
+ */
+class SocketEndpoint {
+  wsi;
+  controller;
+  ended = false;
+  #onEnd;
+
+  constructor(wsi) {
+    this.wsi = wsi;
+  }
+
+  write(chunk) {
+    this.wsi.write(chunk);
+  }
+
+  splice(to) {
+    if(this.ended || to.ended || !this.wsi || !to.wsi || !this.wsi.splice(to.wsi)) return;
+
+    return new Promise((resolve, reject) => {
+      to.#onEnd = () => (this.ended ? resolve() : reject(new TypeError('the destination writable stream closed before all data could be piped to it')));
+    });
+  }
+
+  end() {
+    const onEnd = this.#onEnd;
+
+    this.ended = true;
+    this.#onEnd = undefined;
+    onEnd?.();
+  }
+}
+
 /**
  * Promisified `{ opened, closed }` (each resolving to `{ readable, writable,
  * ...extra }`) fed directly from open/message/close/error events - no
@@ -632,7 +679,7 @@ export class StreamAdapter {
   }
 
   session(wsi) {
-    const box = { wsi, controller: undefined };
+    const box = new SocketEndpoint(wsi);
 
     const readable = new ReadableStream({
       start: c => (box.controller = c),
@@ -648,6 +695,9 @@ export class StreamAdapter {
       abort: reason => box.wsi && safeClose(box.wsi, undefined, reason),
     });
 
+    setNativeEndpoint(readable, box);
+    setNativeEndpoint(writable, box);
+
     let resolveOpened, rejectOpened, resolveClosed;
     const opened = new Promise((resolve, reject) => {
       resolveOpened = resolve;
@@ -693,6 +743,8 @@ export class StreamAdapter {
     this.#sessions.delete(wsi);
     if(!session) return;
 
+    session.box.end();
+
     try {
       session.box.controller.close();
     } catch(e) {}
@@ -707,6 +759,8 @@ export class StreamAdapter {
 
     const err = new Error(message);
 
+    session.box.end();
+
     try {
       session.box.controller.error(err);
     } catch(e) {}
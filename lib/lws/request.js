@@ -2,7 +2,7 @@ import { Body } from './body.js';
 import { Headers } from './headers.js';
 import { MultipartMixin } from './multipart.js';
 import { readableStreamSink } from './stream-utils.js';
-import { toString } from 'lws.so';
+import { LWSHeaders, toString } from 'lws.so';
 import { URL } from './url.js';
 
 /**
@@ -159,6 +159,8 @@ Request.prototype[Symbol.toStringTag] = 'Request';
  */
 export class ServerRequest extends MultipartMixin(Body) {
   #cookies;
+  #headers;
+  #native;
   #query;
   #sink;
 
@@ -170,15 +172,15 @@ export class ServerRequest extends MultipartMixin(Body) {
     this.#sink = sink;
 
     this.wsi = wsi;
+    this.#native = new LWSHeaders(wsi);
     this.method = normalizeMethod(wsi.method || 'GET');
-    this.headers = wsi.headers || {};
 
     /* lws splits the request line's URI at '?' itself - wsi.uri is only
        ever the path; the query string arrives separately as the
        synthetic 'uri-args' entry lwsjs_socket_headers() (lws-socket.c)
        folds into wsi.headers. Recombine here so .originalUrl/.query see
        the query string at all. */
-    const uriArgs = this.headers['uri-args'];
+    const uriArgs = wsi.header('uri-args');
 
     this.originalUrl = (wsi.uri || '/') + (uriArgs ? '?' + uriArgs : '');
 
@@ -192,6 +194,34 @@ export class ServerRequest extends MultipartMixin(Body) {
     this.rawBody = undefined;
   }
 
+  /**
+   * The request headers, as the plain object `wsi.headers` returns - only
+   * built (natively) the first time this is read. Reading it after the
+   * response is complete (say, after an `await`) still works: the
+   * `LWSHeaders` it is built from took a snapshot before lws released
+   * the header table, and never sees the next request on a keep-alive
+   * connection.
+   */
+  get headers() {
+    return (this.#headers ??= this.#native.toObject());
+  }
+
+  set headers(value) {
+    this.#headers = value;
+  }
+
+  /**
+   * The request headers as a WHATWG `Headers`. Unless `.headers` was read
+   * (or replaced) first, it's backed by an `LWSHeaders` (lws.so): get()/has()
+   * go straight to lws's header table, and nothing is copied unless the
+   * `Headers` is modified, enumerated or outlives the transaction.
+   *
+   * @return {Headers}
+   */
+  toHeaders() {
+    return this.#headers ? new Headers(this.#headers) : Headers.fromLWSHeaders(this.#native);
+  }
+
   /** Lazily decoded `?a=1&b=2` query string. */
   get query() {
     if(this.#query) return this.#query;
@@ -118,17 +118,6 @@ function chunkByteLength(chunk) {
   return typeof chunk === 'string' ? toArrayBuffer(chunk).byteLength : chunk.byteLength;
 }
 
-/**
- * Writes one HTTP chunked-encoding segment (`<hex-length>\r\n<data>\r\n`).
- */
-function writeChunk(wsi, chunk) {
-  const len = chunkByteLength(chunk);
-  if(len === 0) return;
-  wsi.write(`${len.toString(16)}\r\n`, LWS_WRITE_HTTP);
-  wsi.write(chunk, LWS_WRITE_HTTP);
-  wsi.write('\r\n', LWS_WRITE_HTTP);
-}
-
 /**
  * ServerResponse - mutable, imperative, streaming-oriented.
  * Used by Express-style middleware (app.js, middleware.js).
@@ -284,7 +273,7 @@ export class ServerResponse {
     this.#flushHeaders();
 
     if(chunk != null) {
-      if(this.#chunked) writeChunk(this.#wsi, chunk);
+      if(this.#chunked) this.#wsi.writeChunked(chunk);
       else this.#wsi.write(chunk, LWS_WRITE_HTTP);
     }
 
@@ -305,8 +294,7 @@ export class ServerResponse {
     this.#flushHeaders();
 
     if(this.#chunked) {
-      if(chunk != null) writeChunk(this.#wsi, chunk);
-      this.#wsi.write('0\r\n\r\n', LWS_WRITE_HTTP_FINAL);
+      this.#wsi.writeChunked(chunk, true);
     } else if(chunk != null) {
       this.#wsi.write(chunk, LWS_WRITE_HTTP_FINAL);
     } else {
@@ -317,6 +305,32 @@ export class ServerResponse {
     return this;
   }
 
+  /**
+   * Sends a whole response at once: headers compiled ahead of time with
+   * `LWSSocket.compileHeaders()` plus `body` (string/ArrayBuffer/view, or
+   * null). Only the status line and content-length are built per call, and
+   * headers set on this response so far go out after the block's.
+   * Chainable.
+   *
+   * @param  {LWSHeaderBlock}  block
+   * @param  {*}               body
+   */
+  sendCompiled(block, body) {
+    if(this.#ended) return this;
+
+    const len = body == null ? 0 : chunkByteLength(body);
+
+    this.#headersSent = true;
+    this.#headers.delete('content-length');
+
+    if(this.#headers.keys().next().done) this.#wsi.respond(this.#status, len, block);
+    else this.#wsi.respond(this.#status, len, block, this.#headers.toObject());
+
+    this.#wsi.write(body ?? '', LWS_WRITE_HTTP_FINAL);
+    this.#ended = true;
+    return this;
+  }
+
   /**
    * Flush headers to the underlying wsi.
    * Called automatically by write() and end().
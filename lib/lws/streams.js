@@ -2447,6 +2447,62 @@ function createPolyfill() {
 const DOMException = getFromGlobal() ?? createPolyfill();
 
 // src/lib/readable-stream/pipe.ts
+/*
+ * Streams whose chunks come from, or go to, something that can move them
+ * without JS in between register an endpoint for it here - StreamAdapter
+ * (lib/lws/protocols.js) does, for both streams of every lws socket. A
+ * pipeTo() from one such stream to another then asks the source's
+ * endpoint to splice() itself into the destination's, and only falls back
+ * to the read/write loop below if it can't. splice(to) returns undefined
+ * for "can't", or a promise that settles once the splice is over: it
+ * fulfills when the source ended and the destination was closed after it,
+ * and rejects when the destination went first. write(chunk) puts a chunk
+ * on the destination ahead of anything spliced.
+ */
+const NativeEndpoints = new WeakMap();
+
+export function setNativeEndpoint(stream, endpoint) {
+  NativeEndpoints.set(stream, endpoint);
+}
+
+/* pipeTo() through NativeEndpoints, or undefined. Only for a plain
+   pipeTo() (no prevent* options, no signal) between streams that are in
+   use by nothing else: the endpoints close and cancel on their own,
+   there's no way to stop one halfway. */
+function NativePipeTo(source, dest, preventClose, preventAbort, preventCancel, signal) {
+  const from = NativeEndpoints.get(source);
+  const to = NativeEndpoints.get(dest);
+  if(!from || !to || preventClose || preventAbort || preventCancel || signal !== undefined) return;
+  const S = STRM(source);
+  const D = STRM(dest);
+  if(S.state != 'readable' || D.state != 'writable' || WritableStreamCloseQueuedOrInFlight(dest) || D.writeRequests.length > 0 || D.inFlightWriteRequest !== undefined) return;
+  const controller = S.readableStreamController;
+  if(!IsReadableStreamDefaultController(controller) || CTRL(controller).closeRequested) return;
+  const piped = from.splice(to);
+  if(piped === undefined) return;
+  const reader = AcquireReadableStreamDefaultReader(source);
+  const writer = AcquireWritableStreamDefaultWriter(dest);
+  S.disturbed = true;
+  /* Whatever the source had queued goes first - before the event loop gets
+     to deliver any of the data that from now on bypasses the queue. */
+  while(CTRL(controller).queue.length > 0) to.write(DequeueValue(controller));
+  return newPromise((resolve, reject) => {
+    uponPromise(
+      piped,
+      () => finalize(false),
+      error => finalize(true, error),
+    );
+    function finalize(isError, error) {
+      if(D.state == 'writable' && !WritableStreamCloseQueuedOrInFlight(dest)) setPromiseIsHandledToTrue(WritableStreamDefaultWriterClose(writer));
+      WritableStreamDefaultWriterRelease(writer);
+      ReadableStreamReaderGenericRelease(reader);
+      if(isError) reject(error);
+      else resolve(undefined);
+      return null;
+    }
+  });
+}
+
 function ReadableStreamPipeTo(source, dest, preventClose, preventAbort, preventCancel, signal) {
   assert(IsReadableStream(source));
   assert(IsWritableStream(dest));
@@ -3220,7 +3276,7 @@ export class ReadableStream {
     }
     if(IsReadableStreamLocked(this)) return promiseRejectedWith(new TypeError('ReadableStream.prototype.pipeTo cannot be used on a locked ReadableStream'));
     if(IsWritableStreamLocked(destination)) return promiseRejectedWith(new TypeError('ReadableStream.prototype.pipeTo cannot be used on a locked WritableStream'));
-    return ReadableStreamPipeTo(this, destination, options.preventClose, options.preventAbort, options.preventCancel, options.signal);
+    return NativePipeTo(this, destination, options.preventClose, options.preventAbort, options.preventCancel, options.signal) ?? ReadableStreamPipeTo(this, destination, options.preventClose, options.preventAbort, options.preventCancel, options.signal);
   }
 
   /**
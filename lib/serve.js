@@ -85,6 +85,14 @@
  * before `fetch`/the iterator form - a request only reaches those once no
  * route matches.
  *
+ * A `Response` entry is also rendered into an `LWSStaticResponse`
+ * (`LWSSocket.compileResponse()`, lws-socket.c) as soon as its body has
+ * been read, right after `serve()` returns. From then on a GET or HEAD
+ * for it is answered in C on `LWS_CALLBACK_HTTP` (the `http` protocol's
+ * `router` option) and never reaches JS. Pass `gzip: true` to store a
+ * gzipped copy of those bodies as well, sent to clients whose
+ * `Accept-Encoding` allows it.
+ *
  * A response with no `content-length` header streams as
  * `Transfer-Encoding: chunked` (proper `<hex-len>\r\n<data>\r\n` framing +
  * `0\r\n\r\n` terminator - `ServerResponse#write()`/`#end()`,
@@ -157,10 +165,11 @@ import { Request } from './lws/request.js';
 import { Response, ServerResponse } from './lws/response.js';
 import { URL } from './lws/url.js';
 import { isPrototypeOf } from './lws/util.js';
+import { SimpleQueue } from './lws/simple-queue.js';
 import { WebSocket } from './websocket.js';
 import { WebSocketStream } from './websocketstream.js';
 import { TCPSocket } from './tcpsocket.js';
-import { LWSMPRO_CALLBACK, LWSMPRO_NO_MOUNT, LWS_SERVER_OPTION_FALLBACK_TO_APPLY_LISTEN_ACCEPT_CONFIG, LWS_SERVER_OPTION_ADOPT_APPLY_LISTEN_ACCEPT_CONFIG, CONTEXT_PORT_NO_LISTEN, LWSVhost, toArrayBuffer, } from 'lws.so';
+import { LWSMPRO_CALLBACK, LWSMPRO_NO_MOUNT, LWS_SERVER_OPTION_FALLBACK_TO_APPLY_LISTEN_ACCEPT_CONFIG, LWS_SERVER_OPTION_ADOPT_APPLY_LISTEN_ACCEPT_CONFIG, CONTEXT_PORT_NO_LISTEN, LWSRouter, LWSSocket, LWSVhost, toArrayBuffer, } from 'lws.so';
 
 const NO_BODY_METHODS = new Set(['GET', 'HEAD']);
 
@@ -173,7 +182,8 @@ const requestPeers = new WeakMap();
 /** `ServerRequest` (lib/lws/app.js) -> a WHATWG `Request` streaming its body as it arrives. */
 function toRequest(req) {
   const scheme = req.wsi.tls ? 'https' : 'http';
-  const url = `${scheme}://${req.headers.host ?? 'localhost'}${req.originalUrl}`;
+  const headers = req.toHeaders();
+  const url = `${scheme}://${headers.get('host') ?? 'localhost'}${req.originalUrl}`;
 
   // req.body (ServerRequest extends Body, lib/lws/app.js) enqueues each
   // chunk as it's read off the socket - unlike req.readBody(), it doesn't
@@ -181,7 +191,7 @@ function toRequest(req) {
   // here.
   const body = NO_BODY_METHODS.has(req.method) ? undefined : req.body;
 
-  const request = new Request(url, { method: req.method, headers: req.headers, body });
+  const request = new Request(url, { method: req.method, headers, body });
 
   requestPeers.set(request, req.wsi.peer?.host ?? null);
 
@@ -235,37 +245,79 @@ function syncResponseBytes(response) {
  * Wraps a static `Response` route entry (`routes` option) as a handler
  * function - buffers the body once, on first use, and hands out a fresh
  * `Response` per call, so the same route entry can serve any number of
- * requests despite a body being a one-shot stream.
+ * requests despite a body being a one-shot stream. Its headers are compiled
+ * into an `LWSHeaderBlock` (`LWSSocket.compileHeaders()`) at the same time;
+ * `handler.serve(resp)` answers from that and the buffered body directly.
+ * `handler.load()` resolves once that's done, with the whole response
+ * rendered as an `LWSStaticResponse` too (`compiled`).
  */
-function staticHandler(response) {
+function staticHandler(response, { gzip = false } = {}) {
   let cached;
 
-  return () =>
-    (cached ??= response.arrayBuffer().then(buf => ({ buf, status: response.statusCode, headers: new Headers(response.headers) }))).then(
-      ({ buf, status, headers }) => new Response(buf, { status, headers }),
+  const load = () =>
+    (cached ??= response.arrayBuffer().then(buf => {
+      const headers = new Headers(response.headers);
+      const fields = headers.toObject();
+      const status = response.statusCode;
+
+      /* respond() derives content-length from the body on every hit. */
+      delete fields['content-length'];
+
+      return { buf, status, headers, block: LWSSocket.compileHeaders(fields), compiled: LWSSocket.compileResponse(status, fields, buf, { gzip }) };
+    }));
+
+  const handler = () => load().then(({ buf, status, headers }) => new Response(buf, { status, headers }));
+
+  /* handleRequest() below sends straight from the compiled header block,
+     without a Request/Response pair per hit. */
+  handler.serve = resp =>
+    load().then(
+      ({ buf, status, block }) => resp.status(status).sendCompiled(block, buf),
+      e => respond(resp, Promise.reject(e)),
     );
+
+  handler.load = load;
+
+  return handler;
 }
 
 /**
- * Compiles `options.routes` (Bun-shaped) into a match table: each pattern
- * (`compilePath()`, lib/lws/app.js - `:name` segments, trailing `*`) maps
- * to either a single any-method `handler`, or `methods` ({METHOD: handler})
- * for per-method dispatch.
+ * Compiles `options.routes` (Bun-shaped) into a match table: an
+ * `LWSRouter` over the patterns (`compilePath()` rules, lib/lws/app.js -
+ * `:name` segments, trailing `*`), and for each one either a single
+ * any-method `handler`, or `methods` ({METHOD: handler}) for per-method
+ * dispatch - `routes[i]` belonging to the router's pattern `i`.
+ *
+ * A static `Response`'s rendered form goes onto its router route once its
+ * body has been read, for the `http` protocol to send natively.
  */
-function compileRoutes(routes) {
-  const table = [];
+function compileRoutes(routes, { gzip } = {}) {
+  const table = { router: new LWSRouter(), routes: [] };
 
   for(const pattern in routes) {
-    const { regex, keys } = compilePath(pattern, true);
+    const { keys } = compilePath(pattern, true);
     const entry = routes[pattern];
+    let route;
 
-    if(typeof entry === 'function') table.push({ regex, keys, handler: entry });
-    else if(isPrototypeOf(Response.prototype, entry)) table.push({ regex, keys, handler: staticHandler(entry) });
+    if(typeof entry === 'function') route = { keys, handler: entry };
+    else if(isPrototypeOf(Response.prototype, entry)) route = { keys, handler: staticHandler(entry, { gzip }) };
     else if(entry && typeof entry === 'object') {
       const methods = Object.setPrototypeOf({}, null);
 
       for(const m in entry) methods[m.toUpperCase()] = entry[m];
-      table.push({ regex, keys, methods });
+      route = { keys, methods };
+    }
+
+    if(route) {
+      const index = table.router.add(pattern, true);
+
+      table.routes.push(route);
+
+      /* Left to handler.serve() if the body can't be read. */
+      route.handler?.load?.().then(
+        ({ compiled }) => table.router.setResponse(index, compiled),
+        () => {},
+      );
     }
   }
 
@@ -274,27 +326,24 @@ function compileRoutes(routes) {
 
 /** First matching route (declaration order) for `path`/`method`, or `null`. */
 function matchRoute(table, path, method) {
-  for(const route of table) {
-    const m = route.regex.exec(path);
+  const m = table.router.match(path);
 
-    if(!m) continue;
+  if(!m) return null;
 
-    const params = Object.setPrototypeOf({}, null);
+  const route = table.routes[m[0]];
+  const params = Object.setPrototypeOf({}, null);
 
-    for(let i = 0; i < route.keys.length; i++) params[route.keys[i]] = decodeURIComponent(m[i + 1]);
+  for(let i = 0; i < route.keys.length; i++) params[route.keys[i]] = decodeURIComponent(m[i + 1]);
 
-    if(route.methods) {
-      const handler = route.methods[method] ?? (method === 'HEAD' ? route.methods.GET : undefined);
+  if(route.methods) {
+    const handler = route.methods[method] ?? (method === 'HEAD' ? route.methods.GET : undefined);
 
-      if(!handler) return { params, allow: Object.keys(route.methods) };
-
-      return { params, handler };
-    }
+    if(!handler) return { params, allow: Object.keys(route.methods) };
 
-    return { params, handler: route.handler };
+    return { params, handler };
   }
 
-  return null;
+  return { params, handler: route.handler };
 }
 
 /** Coerce whatever the handler returned into a real `Response`, matching Bun's leniency. */
@@ -345,15 +394,14 @@ async function respond(resp, response) {
   }
 }
 
-/** A minimal FIFO async queue - `push()` from callbacks, consume with `for await`. */
+/** A minimal FIFO async queue - `push()` from callbacks, consume with `for await`. Both sides are SimpleQueues, so a burst of pushes with no consumer yet doesn't make draining it quadratic (Array.prototype.shift() is O(n)). */
 function asyncQueue() {
-  const values = [];
-  const waiters = [];
+  const values = new SimpleQueue();
+  const waiters = new SimpleQueue();
 
   return {
     push(value) {
-      const waiter = waiters.shift();
-      if(waiter) waiter(value);
+      if(waiters.length) waiters.shift()(value);
       else values.push(value);
     },
     [Symbol.asyncIterator]() {
@@ -372,9 +420,11 @@ class Server {
   #id;
   #subscriberCount;
   #timeoutSeconds = 0;
+  #router;
 
-  constructor(ctx, port, hostname, publish, development = false, subscriberCount) {
+  constructor(ctx, port, hostname, publish, development = false, subscriberCount, router) {
     this.#ctx = ctx;
+    this.#router = router;
     this.port = port;
     this.hostname = hostname;
     this.#development = development;
@@ -456,9 +506,13 @@ class Server {
   /** Bun's server.timeout(seconds) - sets the server-wide idle timeout.
       Applied via wsi.setTimeout() (native lws_set_timeout()) to each
       connection as it's accepted/re-armed on activity - see _applyTimeout()
-      below. `0` disables it. */
+      below. `0` disables it. A static `routes` response is sent natively
+      without reaching _applyTimeout(), so the `routes` LWSRouter gets the
+      same value to arm before it sends one. */
   timeout(seconds) {
     this.#timeoutSeconds = seconds;
+
+    if(this.#router) this.#router.timeout = seconds;
   }
 
   /** Bun's server.closeIdleConnections() - closes all idle keep-alive connections.
@@ -530,10 +584,10 @@ export function serve(...args) {
 
   fetchHandler ??= opts.fetch;
 
-  const { port = 0, hostname, host = hostname, tls, websocket = '/ws', raw = false, mounts, protocols = [], headers, html, access, upgrade, auth, routes, development = false, ...rest } = opts;
+  const { port = 0, hostname, host = hostname, tls, websocket = '/ws', raw = false, mounts, protocols = [], headers, html, access, upgrade, auth, routes, gzip = false, development = false, ...rest } = opts;
 
   const sink = fetchHandler ? null : asyncQueue();
-  const routeTable = routes ? compileRoutes(routes) : null;
+  const routeTable = routes ? compileRoutes(routes, { gzip }) : null;
 
   // Assigned once the Server exists (below, after createContext()) -
   // referenced by closures (handleRequest, the upgrade hook) that only
@@ -560,6 +614,11 @@ export function serve(...args) {
         return;
       }
 
+      if(match.handler.serve) {
+        match.handler.serve(resp);
+        return;
+      }
+
       const request = toRequest(req);
 
       request.params = match.params;
@@ -725,7 +784,7 @@ export function serve(...args) {
   // With rawAlways, the raw entry has to be protocols[0] (see the class
   // doc comment above) - everywhere else, order doesn't matter, so it's
   // simplest to just append it after 'ws' like before.
-  const allProtocols = [...(rawAlways && rawEntry ? [rawEntry] : []), { name: 'http', ...http(handleRequest, { headers, html, access, upgrade: effectiveUpgrade, auth }) }, ...protocols];
+  const allProtocols = [...(rawAlways && rawEntry ? [rawEntry] : []), { name: 'http', ...http(handleRequest, { headers, html, access, upgrade: effectiveUpgrade, auth }), router: routeTable?.router }, ...protocols];
   const allMounts = mounts ?? [];
 
   if(!mounts) allMounts.push({ mountpoint: '/', protocol: 'http', originProtocol: LWSMPRO_CALLBACK });
@@ -774,6 +833,7 @@ export function serve(...args) {
 
   const ctx = createContext({
     port: CONTEXT_PORT_NO_LISTEN,
+    dateHeader: true,
     ...rest,
   });
 
@@ -794,7 +854,7 @@ export function serve(...args) {
 
   const actualPort = vhost.listenPort;
 
-  server = new Server(ctx, actualPort, host, wsDescriptor?.publish, development, wsDescriptor?.subscriberCount);
+  server = new Server(ctx, actualPort, host, wsDescriptor?.publish, development, wsDescriptor?.subscriberCount, routeTable?.router);
   server.upgrade = upgradeConnection;
 
   if(fetchHandler) return server;
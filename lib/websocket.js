@@ -225,16 +225,9 @@ export class WebSocket extends EventTargetProperties(['open', 'error', 'message'
             open: wsi => ((sockets(wsi).readyState = OPEN), fire(wsi, 'open')),
             error: (wsi, message) => ((sockets(wsi).readyState = CLOSING), fire(wsi, 'error', { message }), this.#ref.release(wsi)),
             close: (wsi, code, reason) => ((sockets(wsi).readyState = CLOSED), fire(wsi, 'close', { code, reason }), this.#ref.release(wsi)),
-            /* `frame` (only present for multi-fragment messages, per
-               LWS_CALLBACK_CLIENT_RECEIVE's doc) would in principle let us
-               reassemble here, but lws_is_final_fragment() has been observed
-               to report true for every fragment of a manually- or
-               internally-split large WS message in this build, making that
-               reassembly unreliable - callers needing to handle large
-               payloads robustly should frame them explicitly at the
-               application level instead (see examples/debugger/server.js +
-               demo.js for the pattern) rather than relying on WS message
-               boundaries. */
+            /* client() sets the `reassemble` protocol option, so fragments
+               arrive here already joined into one message - including
+               frames lws hands over in several pieces (see test-ws.js). */
             message: (wsi, data, size) => fire(wsi, 'message', { data, size }),
           }),
         },
@@ -0,0 +1,527 @@
+#include "js-utils.h"
+#include "lws.h"
+#include <cutils.h>
+#include <string.h>
+
+static JSClassID lwsjs_byte_queue_class_id;
+static JSValue lwsjs_byte_queue_proto, lwsjs_byte_queue_ctor;
+
+/* Byte queue for parsing protocols over raw sockets: the chunks onRawRx
+   hands over are queued by reference - the ArrayBuffer plus the range of
+   it still unread - in a ring of segments, so buffering a stream costs
+   no copying at all, and read()/peek() return a Uint8Array onto the
+   chunk itself whenever the bytes asked for sit in one. Only a read that
+   spans chunks copies, and then it merges the chunks involved into one
+   segment, so peeking at the same bytes again (or reading them after a
+   peek) doesn't copy a second time. */
+typedef struct {
+  JSValue buffer;
+  size_t offset, len;
+} ByteQueueSegment;
+
+typedef struct {
+  ByteQueueSegment* segs; /* ring, size is a power of 2 */
+  uint32_t head, count, size;
+  size_t length;
+} LWSByteQueue;
+
+enum {
+  METHOD_PUSH = 0,
+  METHOD_READ,
+  METHOD_PEEK,
+  METHOD_SKIP,
+  METHOD_INDEX_OF,
+  METHOD_READ_UNTIL,
+  METHOD_CLEAR,
+};
+
+enum {
+  PROP_LENGTH = 0,
+  PROP_SEGMENTS,
+};
+
+static inline LWSByteQueue*
+lwsjs_byte_queue_data2(JSContext* ctx, JSValueConst value) {
+  return JS_GetOpaque2(ctx, value, lwsjs_byte_queue_class_id);
+}
+
+static inline ByteQueueSegment*
+byte_queue_segment(LWSByteQueue* q, uint32_t i) {
+  return &q->segs[(q->head + i) & (q->size - 1)];
+}
+
+/* Where seg's bytes are now, looked up again on every access: the
+   reference keeps the ArrayBuffer alive, but not attached. */
+static uint8_t*
+byte_queue_segment_data(JSContext* ctx, ByteQueueSegment* seg) {
+  uint8_t* ptr;
+  size_t size;
+
+  if(!(ptr = JS_GetArrayBuffer(ctx, &size, seg->buffer)) || seg->offset + seg->len > size) {
+    if(ptr)
+      JS_ThrowTypeError(ctx, "LWSByteQueue: a queued buffer was resized or detached");
+
+    return NULL;
+  }
+
+  return ptr + seg->offset;
+}
+
+static int
+byte_queue_push(JSContext* ctx, LWSByteQueue* q, JSValueConst buffer, size_t offset, size_t len) {
+  if(len == 0)
+    return 0;
+
+  if(q->count == q->size) {
+    uint32_t size = q->size ? q->size * 2 : 8;
+    ByteQueueSegment* segs;
+
+    if(!(segs = js_malloc(ctx, size * sizeof(ByteQueueSegment))))
+      return -1;
+
+    for(uint32_t i = 0; i < q->count; i++)
+      segs[i] = *byte_queue_segment(q, i);
+
+    js_free(ctx, q->segs);
+    q->segs = segs;
+    q->head = 0;
+    q->size = size;
+  }
+
+  *byte_queue_segment(q, q->count++) = (ByteQueueSegment){JS_DupValue(ctx, buffer), offset, len};
+  q->length += len;
+  return 0;
+}
+
+/* Drops n <= q->length bytes off the front. */
+static void
+byte_queue_consume(JSContext* ctx, LWSByteQueue* q, size_t n) {
+  q->length -= n;
+
+  while(n > 0) {
+    ByteQueueSegment* seg = byte_queue_segment(q, 0);
+
+    if(n < seg->len) {
+      seg->offset += n;
+      seg->len -= n;
+      break;
+    }
+
+    n -= seg->len;
+    JS_FreeValue(ctx, seg->buffer);
+    q->head = (q->head + 1) & (q->size - 1);
+    q->count--;
+  }
+}
+
+static void
+byte_queue_free_buffer(JSRuntime* rt, void* opaque, void* ptr) {
+  js_free_rt(rt, ptr);
+}
+
+/* Makes the first 0 < n <= q->length bytes contiguous: if they span
+   segments, those segments are copied whole into one new ArrayBuffer that
+   replaces them. Returns the front segment, which then holds them, or
+   NULL on exception. */
+static ByteQueueSegment*
+byte_queue_front(JSContext* ctx, LWSByteQueue* q, size_t n) {
+  ByteQueueSegment* seg = byte_queue_segment(q, 0);
+  uint32_t k = 0;
+  size_t total = 0, pos = 0;
+  uint8_t* ptr;
+  JSValue buffer;
+
+  if(seg->len >= n)
+    return seg;
+
+  while(total < n)
+    total += byte_queue_segment(q, k++)->len;
+
+  if(!(ptr = js_malloc(ctx, total)))
+    return NULL;
+
+  for(uint32_t i = 0; i < k; i++) {
+    ByteQueueSegment* s = byte_queue_segment(q, i);
+    const uint8_t* data;
+
+    if(!(data = byte_queue_segment_data(ctx, s))) {
+      js_free(ctx, ptr);
+      return NULL;
+    }
+
+    memcpy(ptr + pos, data, s->len);
+    pos += s->len;
+  }
+
+  buffer = JS_NewArrayBuffer(ctx, ptr, total, byte_queue_free_buffer, NULL, FALSE);
+
+  if(JS_IsException(buffer)) {
+    js_free(ctx, ptr);
+    return NULL;
+  }
+
+  for(uint32_t i = 0; i < k; i++)
+    JS_FreeValue(ctx, byte_queue_segment(q, i)->buffer);
+
+  /* The merged segment takes the last one's slot. */
+  q->head = (q->head + k - 1) & (q->size - 1);
+  q->count -= k - 1;
+
+  seg = byte_queue_segment(q, 0);
+  *seg = (ByteQueueSegment){buffer, 0, total};
+  return seg;
+}
+
+static JSValue
+byte_queue_view(JSContext* ctx, ByteQueueSegment* seg, size_t len) {
+  JSValue args[3] = {seg->buffer, JS_NewInt64(ctx, seg->offset), JS_NewInt64(ctx, len)};
+  JSValue ctor = global_get(ctx, "Uint8Array"), ret;
+
+  ret = JS_CallConstructor(ctx, ctor, countof(args), args);
+  JS_FreeValue(ctx, ctor);
+  return ret;
+}
+
+/* The first n bytes as a Uint8Array, consumed if consume. */
+static JSValue
+byte_queue_get(JSContext* ctx, LWSByteQueue* q, size_t n, BOOL consume) {
+  ByteQueueSegment* seg;
+  JSValue ret;
+
+  if(n == 0) {
+    JSValue ctor = global_get(ctx, "Uint8Array");
+
+    ret = JS_CallConstructor(ctx, ctor, 0, NULL);
+    JS_FreeValue(ctx, ctor);
+    return ret;
+  }
+
+  if(!(seg = byte_queue_front(ctx, q, n)))
+    return JS_EXCEPTION;
+
+  ret = byte_queue_view(ctx, seg, n);
+
+  if(consume && !JS_IsException(ret))
+    byte_queue_consume(ctx, q, n);
+
+  return ret;
+}
+
+/* Offset of the first occurrence of needle at or after from, or -1 (-2 on
+   exception). The first byte is found with memchr() per segment; the rest
+   is compared from there, across segment boundaries if need be. */
+static int64_t
+byte_queue_index_of(JSContext* ctx, LWSByteQueue* q, const uint8_t* needle, size_t nlen, size_t from) {
+  size_t base = 0;
+
+  if(nlen == 0)
+    return from <= q->length ? (int64_t)from : -1;
+
+  for(uint32_t i = 0; i < q->count; base += byte_queue_segment(q, i++)->len) {
+    ByteQueueSegment* seg = byte_queue_segment(q, i);
+    const uint8_t *data, *p;
+    size_t start;
+
+    if(base + seg->len <= from)
+      continue;
+
+    if(!(data = byte_queue_segment_data(ctx, seg)))
+      return -2;
+
+    for(start = from > base ? from - base : 0; (p = memchr(data + start, needle[0], seg->len - start)); start = p - data + 1) {
+      size_t pos = p - data + 1, matched = 1;
+      uint32_t j = i;
+
+      if(base + (p - data) + nlen > q->length)
+        return -1;
+
+      /* Compare the rest, moving on to the following segments. */
+      while(matched < nlen) {
+        ByteQueueSegment* s = byte_queue_segment(q, j);
+        const uint8_t* d;
+        size_t cmp;
+
+        if(pos == s->len) {
+          j++;
+          pos = 0;
+          continue;
+        }
+
+        if(!(d = j == i ? data : byte_queue_segment_data(ctx, s)))
+          return -2;
+
+        cmp = MIN(s->len - pos, nlen - matched);
+
+        if(memcmp(d + pos, needle + matched, cmp))
+          break;
+
+        matched += cmp;
+        pos += cmp;
+      }
+
+      if(matched == nlen)
+        return base + (p - data);
+    }
+  }
+
+  return -1;
+}
+
+static JSValue
+lwsjs_byte_queue_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  LWSByteQueue* q;
+
+  if(!(q = js_mallocz(ctx, sizeof(LWSByteQueue))))
+    return JS_EXCEPTION;
+
+  /* using new_target to get the prototype is necessary when the class is extended. */
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    proto = JS_DupValue(ctx, lwsjs_byte_queue_proto);
+
+  JSValue obj = JS_NewObjectProtoClass(ctx, proto, lwsjs_byte_queue_class_id);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj)) {
+    js_free(ctx, q);
+    return JS_EXCEPTION;
+  }
+
+  JS_SetOpaque(obj, q);
+  return obj;
+}
+
+/* A byte count argument: all that's queued when it's missing, -1 when
+   there's less than that. */
+static int64_t
+byte_queue_count(JSContext* ctx, LWSByteQueue* q, int argc, JSValueConst argv[]) {
+  int64_t n;
+
+  if(argc < 1 || JS_IsUndefined(argv[0]))
+    return q->length;
+
+  if(JS_ToInt64(ctx, &n, argv[0]))
+    return -2;
+
+  if(n < 0)
+    n = 0;
+
+  return (uint64_t)n > q->length ? -1 : n;
+}
+
+/* A delimiter/needle argument: a byte value, a string or a buffer. The
+   string, if any, goes to *str for the caller to free. */
+static const uint8_t*
+byte_queue_needle(JSContext* ctx, JSValueConst value, uint8_t* byte, size_t* len, const char** str) {
+  const uint8_t* ptr;
+
+  *str = NULL;
+
+  if(JS_IsNumber(value)) {
+    int32_t b;
+
+    JS_ToInt32(ctx, &b, value);
+    *byte = b;
+    *len = 1;
+    return byte;
+  }
+
+  if(JS_IsString(value))
+    return (const uint8_t*)(*str = JS_ToCStringLen(ctx, len, value));
+
+  if(!(ptr = get_buffer(ctx, 1, &value, len)))
+    JS_ThrowTypeError(ctx, "LWSByteQueue: expected a byte, string, ArrayBuffer or TypedArray");
+
+  return ptr;
+}
+
+static JSValue
+lwsjs_byte_queue_methods(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  LWSByteQueue* q;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(q = lwsjs_byte_queue_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case METHOD_PUSH: {
+      for(int i = 0; i < argc; i++) {
+        size_t offset = 0, len = 0, size;
+        JSValue buffer;
+        int r;
+
+        if(JS_IsString(argv[i])) {
+          const char* s;
+
+          if(!(s = JS_ToCStringLen(ctx, &len, argv[i])))
+            return JS_EXCEPTION;
+
+          buffer = JS_NewArrayBufferCopy(ctx, (const uint8_t*)s, len);
+          JS_FreeCString(ctx, s);
+        } else {
+          buffer = get_typedarray_buffer(ctx, argv[i], &offset, &len);
+
+          if(!JS_GetArrayBuffer(ctx, &size, buffer)) {
+            JS_FreeValue(ctx, buffer);
+            return JS_ThrowTypeError(ctx, "LWSByteQueue.push: argument %d must be a string, ArrayBuffer or TypedArray", i + 1);
+          }
+
+          len = MIN(len, size - MIN(offset, size));
+        }
+
+        if(JS_IsException(buffer))
+          return JS_EXCEPTION;
+
+        r = byte_queue_push(ctx, q, buffer, offset, len);
+        JS_FreeValue(ctx, buffer);
+
+        if(r)
+          return JS_EXCEPTION;
+      }
+
+      ret = JS_NewInt64(ctx, q->length);
+      break;
+    }
+
+    case METHOD_READ:
+    case METHOD_PEEK: {
+      int64_t n;
+
+      if((n = byte_queue_count(ctx, q, argc, argv)) == -2)
+        return JS_EXCEPTION;
+
+      ret = n < 0 ? JS_NULL : byte_queue_get(ctx, q, n, magic == METHOD_READ);
+      break;
+    }
+
+    case METHOD_SKIP: {
+      int64_t n = 0;
+
+      if(JS_ToInt64(ctx, &n, argv[0]))
+        return JS_EXCEPTION;
+
+      n = MAX(0, MIN(n, (int64_t)q->length));
+      byte_queue_consume(ctx, q, n);
+      ret = JS_NewInt64(ctx, n);
+      break;
+    }
+
+    case METHOD_INDEX_OF:
+    case METHOD_READ_UNTIL: {
+      const uint8_t* needle;
+      const char* str;
+      uint8_t byte;
+      size_t len;
+      int64_t from = 0, index;
+
+      if(magic == METHOD_INDEX_OF && argc > 1 && JS_ToInt64(ctx, &from, argv[1]))
+        return JS_EXCEPTION;
+
+      if(!(needle = byte_queue_needle(ctx, argv[0], &byte, &len, &str)))
+        return JS_EXCEPTION;
+
+      index = byte_queue_index_of(ctx, q, needle, len, MAX(from, 0));
+
+      if(str)
+        JS_FreeCString(ctx, str);
+
+      if(index == -2)
+        return JS_EXCEPTION;
+
+      if(magic == METHOD_INDEX_OF)
+        ret = JS_NewInt64(ctx, index);
+      else
+        ret = index < 0 ? JS_NULL : byte_queue_get(ctx, q, index + len, TRUE);
+
+      break;
+    }
+
+    case METHOD_CLEAR: {
+      byte_queue_consume(ctx, q, q->length);
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static JSValue
+lwsjs_byte_queue_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  LWSByteQueue* q;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(q = lwsjs_byte_queue_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case PROP_LENGTH: {
+      ret = JS_NewInt64(ctx, q->length);
+      break;
+    }
+
+    case PROP_SEGMENTS: {
+      ret = JS_NewUint32(ctx, q->count);
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static void
+lwsjs_byte_queue_finalizer(JSRuntime* rt, JSValue val) {
+  LWSByteQueue* q;
+
+  if((q = JS_GetOpaque(val, lwsjs_byte_queue_class_id))) {
+    for(uint32_t i = 0; i < q->count; i++)
+      JS_FreeValueRT(rt, byte_queue_segment(q, i)->buffer);
+
+    js_free_rt(rt, q->segs);
+    js_free_rt(rt, q);
+  }
+}
+
+static void
+lwsjs_byte_queue_mark(JSRuntime* rt, JSValueConst val, JS_MarkFunc* mark_func) {
+  LWSByteQueue* q;
+
+  if((q = JS_GetOpaque(val, lwsjs_byte_queue_class_id)))
+    for(uint32_t i = 0; i < q->count; i++)
+      JS_MarkValue(rt, byte_queue_segment(q, i)->buffer, mark_func);
+}
+
+static const JSClassDef lws_byte_queue_class = {
+    "LWSByteQueue",
+    .finalizer = lwsjs_byte_queue_finalizer,
+    .gc_mark = lwsjs_byte_queue_mark,
+};
+
+static const JSCFunctionListEntry lws_byte_queue_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("push", 1, lwsjs_byte_queue_methods, METHOD_PUSH),
+    JS_CFUNC_MAGIC_DEF("read", 0, lwsjs_byte_queue_methods, METHOD_READ),
+    JS_CFUNC_MAGIC_DEF("peek", 0, lwsjs_byte_queue_methods, METHOD_PEEK),
+    JS_CFUNC_MAGIC_DEF("skip", 1, lwsjs_byte_queue_methods, METHOD_SKIP),
+    JS_CFUNC_MAGIC_DEF("indexOf", 1, lwsjs_byte_queue_methods, METHOD_INDEX_OF),
+    JS_CFUNC_MAGIC_DEF("readUntil", 1, lwsjs_byte_queue_methods, METHOD_READ_UNTIL),
+    JS_CFUNC_MAGIC_DEF("clear", 0, lwsjs_byte_queue_methods, METHOD_CLEAR),
+    JS_CGETSET_MAGIC_DEF("length", lwsjs_byte_queue_get, 0, PROP_LENGTH),
+    JS_CGETSET_MAGIC_DEF("segments", lwsjs_byte_queue_get, 0, PROP_SEGMENTS),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "LWSByteQueue", JS_PROP_CONFIGURABLE),
+};
+
+int
+lwsjs_byte_queue_init(JSContext* ctx, JSModuleDef* m) {
+  JS_NewClassID(&lwsjs_byte_queue_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), lwsjs_byte_queue_class_id, &lws_byte_queue_class);
+
+  lwsjs_byte_queue_proto = JS_NewObjectProto(ctx, JS_NULL);
+  JS_SetPropertyFunctionList(ctx, lwsjs_byte_queue_proto, lws_byte_queue_proto_funcs, countof(lws_byte_queue_proto_funcs));
+
+  lwsjs_byte_queue_ctor = JS_NewCFunction2(ctx, lwsjs_byte_queue_constructor, "LWSByteQueue", 0, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, lwsjs_byte_queue_ctor, lwsjs_byte_queue_proto);
+
+  if(m) {
+    JS_SetModuleExport(ctx, m, "LWSByteQueue", lwsjs_byte_queue_ctor);
+  }
+
+  return 0;
+}
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <strings.h>
 #include "lws-socket.h"
+#include "lws-rxpool.h"
 #include "lws-context.h"
 #include "lws-vhost.h"
 #include "lws-sockaddr46.h"
@@ -19,25 +20,130 @@
 #ifdef USE_EPOLL
 #include "lws-epoll.h"
 #endif
+#ifdef USE_IO_URING
+#include "lws-uring.h"
+#endif
 #include "lws-mount.h"
 #include "lws-protocol.h"
 
+/* struct lws_context_per_thread, for the sul lists in service_sul_next(). */
+#include "libwebsockets/lib/core/private-lib-core.h"
+
 static void callback_patch_system_vhost(struct lws_context*);
 
 void service_tick_schedule(LWSContext* lws, int delay_ms);
+void service_tick_cancel(LWSContext* lws);
+
+/* Defaults for the `service_budget` / `service_budget_us` options: how
+   many forced-service rounds one wakeup may run, and for how long, before
+   lwsjs_service_forced() gives the event loop its turn back. */
+#define SERVICE_BUDGET_DEFAULT 64
+#define SERVICE_BUDGET_US_DEFAULT 10000
+
+/* Delay the tick is rescheduled at when the budget runs out. Not 0:
+   quickjs-libc's os poll runs an expired timer *instead of* polling fds
+   that round, so a timer that keeps re-expiring would starve every
+   socket just like the unbounded loop did. */
+#define SERVICE_YIELD_MS 1
+
+/* Default cap on how many bytes of spare wsi.write() chunks an LWSContext
+   keeps around for reuse (the `write_pool_max` option) - see
+   WriteChunkPool, lws-socket.c. */
+#define WRITE_POOL_MAX_DEFAULT (1024 * 1024)
+
+/* Defaults of the `rx_pool_max` (bytes) and `rx_pool_size` (spare buffers
+   per size class) options - see RxBufferPool, lws-rxpool.c. */
+#define RX_POOL_MAX_DEFAULT (1024 * 1024)
+#define RX_POOL_SIZE_DEFAULT 64
 
 /*
- * Base interval (ms) for the periodic forced-service tick below. The
- * forced-service check in pollfd_handler() above only runs when some fd
- * belonging to this context happens to fire - but lws can leave a wsi
- * needing service (e.g. a scheduled retry/timeout, or an internal state
- * that couldn't be resolved from within a single lws_service_fd() call)
- * with no new socket activity ever occurring to trigger that check again.
- * This periodic tick is the safety net: it re-checks regardless of fd
- * activity, same as lws's own poll()/libuv/libev loops do internally.
+ * Earliest pending lws_sorted_usec_list_t (sul) deadline across this
+ * context's service threads, as an absolute lws_now_usecs() time, or 0 if
+ * nothing is scheduled. Everything time-driven in lws - wsi timeouts
+ * (lws_set_timeout()), connect/retry backoff, validity pings, its own
+ * periodic checks, ctx.schedule() - is a sul, so this is exactly when the
+ * context next needs service that no fd activity will announce.
+ *
+ * With `service`, ripe suls are run first (__lws_sul_service_ripe(), what
+ * lws's own poll loop does every round); without, the lists are only
+ * peeked at, which is safe from anywhere - including right after a JS
+ * call into lws, where running a sul's callback re-entrantly would not be.
  */
-#define SERVICE_TICK_MS 250
+static lws_usec_t
+service_sul_next(LWSContext* lws, BOOL service) {
+  lws_usec_t now = lws_now_usecs(), next = 0;
+  int n, tsi, count;
+
+  if(!lws->ctx)
+    return 0;
+
+  for(tsi = 0, count = lws_get_count_threads(lws->ctx); tsi < count; tsi++) {
+    struct lws_context_per_thread* pt = &lws->ctx->pt[tsi];
+
+    if(service) {
+      lws_usec_t us;
+
+      lws_pt_lock(pt, __func__);
+      us = __lws_sul_service_ripe(pt->pt_sul_owner, LWS_COUNT_PT_SUL_OWNERS, now);
+      lws_pt_unlock(pt);
+
+      if(us && (!next || now + us < next))
+        next = now + us;
+
+      continue;
+    }
+
+    for(n = 0; n < LWS_COUNT_PT_SUL_OWNERS; n++) {
+      struct lws_dll2* d;
+
+      if((d = lws_dll2_get_head(&pt->pt_sul_owner[n]))) {
+        lws_sorted_usec_list_t* sul = lws_container_of(d, lws_sorted_usec_list_t, list);
+
+        if(!next || sul->us < next)
+          next = sul->us;
+      }
+    }
+  }
+
+  return next;
+}
+
+/*
+ * Makes sure the service tick fires no later than `at` (absolute, as from
+ * service_sul_next()). A tick already due by then is left alone, so on the
+ * hot path - every wakeup - this is a comparison and no JS call. `at` == 0
+ * (nothing scheduled) arms nothing: an idle context has no timer at all,
+ * and a tick still pending from earlier just finds nothing to do.
+ */
+static void
+service_tick_arm(LWSContext* lws, lws_usec_t at) {
+  lws_usec_t now;
+  int64_t ms;
+
+  if(!at || !lws->ctx)
+    return;
+
+  if(!JS_IsUndefined(lws->service_timer_id) && lws->service_tick_at <= at)
+    return;
+
+  now = lws_now_usecs();
+  ms = at > now ? (at - now + LWS_US_PER_MS - 1) / LWS_US_PER_MS : 0;
+
+  service_tick_cancel(lws);
+  service_tick_schedule(lws, ms < SERVICE_YIELD_MS ? SERVICE_YIELD_MS : ms > INT32_MAX ? INT32_MAX : (int)ms);
+}
 
+void
+lwsjs_service_arm(LWSContext* lws) {
+  service_tick_arm(lws, service_sul_next(lws, FALSE));
+}
+
+/*
+ * The service tick: runs forced service and ripe suls when lws next needs
+ * them and no fd is going to fire for it (see service_sul_next()), then
+ * re-arms itself for the following deadline - or not at all, if there is
+ * none.
+ */
 static JSValue
 service_tick(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int magic, void* opaque) {
   LWSContext* lws = opaque;
@@ -52,26 +158,110 @@ service_tick(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv
   if(!lws->ctx)
     return JS_UNDEFINED;
 
-  if(lws_service_adjust_timeout(lws->ctx, SERVICE_TICK_MS, 0) == 0) {
+  lws->service_ticks++;
+
+  if(!lwsjs_service_forced(lws))
+    service_tick_arm(lws, service_sul_next(lws, TRUE));
+
+  return JS_UNDEFINED;
+}
+
+/*
+ * Forced service (see pollfd_handler(), lws-protocol.c), bounded: at most
+ * lws->service_budget rounds and lws->service_budget_us microseconds per
+ * wakeup (0 = no limit on that one). A wsi that never stops needing
+ * forced service (BUGS: deferred-close-hangs-on-established-client-http)
+ * or just a very busy one would otherwise keep the process in this loop,
+ * and every timer and every other connection waits. When the budget runs
+ * out the service tick is pulled forward to SERVICE_YIELD_MS, so the rest
+ * is picked up right after the event loop's next round. Returns TRUE if
+ * it did that.
+ *
+ * Otherwise, whatever was serviced may have scheduled new suls (a wsi
+ * timeout, a retry), so the tick is re-armed for the earliest one.
+ */
+BOOL
+lwsjs_service_forced(LWSContext* lws) {
+  lws_usec_t start = lws->service_budget_us ? lws_now_usecs() : 0;
+  uint32_t n = 0;
+
+  while(lws->ctx && lws_service_adjust_timeout(lws->ctx, 1, 0) == 0) {
+    if((lws->service_budget && n >= lws->service_budget) || (lws->service_budget_us && lws_now_usecs() - start >= lws->service_budget_us)) {
+      lws->service_exhausted++;
+      service_tick_cancel(lws);
+      service_tick_schedule(lws, SERVICE_YIELD_MS);
+      return TRUE;
+    }
+
     lws_service_tsi(lws->ctx, -1, 0);
-    service_tick_schedule(lws, 1);
-  } else {
-    service_tick_schedule(lws, SERVICE_TICK_MS);
+    lws->service_rounds++;
+    n++;
   }
 
-  return JS_UNDEFINED;
+  lwsjs_service_arm(lws);
+  return FALSE;
+}
+
+/*
+ * The Date header value for the current second (RFC 7231 IMF-fixdate),
+ * HTTP_DATE_LEN characters. Formatted here at most once a second per
+ * context, however many responses carry it. Names are spelled out rather
+ * than left to strftime(), whose %a/%b follow the locale.
+ */
+const char*
+lwsjs_context_date(LWSContext* lws) {
+  static const char days[7][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+  static const char months[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  time_t now = time(NULL);
+
+  if(now != lws->date_time) {
+    struct tm tm;
+
+    gmtime_r(&now, &tm);
+    snprintf(lws->date,
+             sizeof(lws->date),
+             "%s, %02d %s %04d %02d:%02d:%02d GMT",
+             days[tm.tm_wday],
+             tm.tm_mday,
+             months[tm.tm_mon],
+             tm.tm_year + 1900,
+             tm.tm_hour,
+             tm.tm_min,
+             tm.tm_sec);
+
+    lws->date_time = now;
+
+    if(lws->js) {
+      JS_FreeValue(lws->js, lws->date_value);
+      lws->date_value = JS_UNDEFINED;
+    }
+  }
+
+  return lws->date;
+}
+
+/* os.setTimeout / os.clearTimeout, looked up once per context - same idea
+   as iohandler_function(). Returns a borrowed reference. */
+static JSValueConst
+service_os_timeout(LWSContext* lws, BOOL clear) {
+  if(JS_IsUndefined(lws->os_timeout[clear])) {
+    JSValue glob = JS_GetGlobalObject(lws->js);
+    JSValue os = JS_GetPropertyStr(lws->js, glob, "os");
+    JS_FreeValue(lws->js, glob);
+    lws->os_timeout[clear] = JS_GetPropertyStr(lws->js, os, clear ? "clearTimeout" : "setTimeout");
+    JS_FreeValue(lws->js, os);
+  }
+
+  return lws->os_timeout[clear];
 }
 
 void
 service_tick_schedule(LWSContext* lws, int delay_ms) {
-  JSValue glob = JS_GetGlobalObject(lws->js);
-  JSValue os = JS_GetPropertyStr(lws->js, glob, "os");
-  JS_FreeValue(lws->js, glob);
-  JSValue fn = JS_GetPropertyStr(lws->js, os, "setTimeout");
-  JS_FreeValue(lws->js, os);
+  /* The closure only carries `lws`, so one per context does. */
+  if(JS_IsUndefined(lws->service_tick_fn))
+    lws->service_tick_fn = js_function_cclosure(lws->js, (CClosureFunc*)service_tick, 0, 0, lws, NULL);
 
-  JSValue cb = js_function_cclosure(lws->js, (CClosureFunc*)service_tick, 0, 0, lws, NULL);
-  JSValue args[2] = {cb, JS_NewInt32(lws->js, delay_ms)};
+  JSValue args[2] = {lws->service_tick_fn, JS_NewInt32(lws->js, delay_ms)};
 
   /* os.setTimeout() returns an opaque "OSTimer" JS object in this
      quickjs-libc, not a plain numeric id (unlike, say, Node's timer
@@ -79,10 +269,8 @@ service_tick_schedule(LWSContext* lws, int delay_ms) {
      stray, never-checked "toPrimitive" TypeError, since the object has
      no valueOf/toString. Keep the object itself; it goes back into
      os.clearTimeout() unchanged in service_tick_cancel(). */
-  lws->service_timer_id = JS_Call(lws->js, fn, JS_NULL, 2, args);
-
-  JS_FreeValue(lws->js, cb);
-  JS_FreeValue(lws->js, fn);
+  lws->service_timer_id = JS_Call(lws->js, service_os_timeout(lws, FALSE), JS_NULL, 2, args);
+  lws->service_tick_at = lws_now_usecs() + (lws_usec_t)delay_ms * LWS_US_PER_MS;
 }
 
 void
@@ -90,16 +278,8 @@ service_tick_cancel(LWSContext* lws) {
   if(JS_IsUndefined(lws->service_timer_id) || !lws->js)
     return;
 
-  JSValue glob = JS_GetGlobalObject(lws->js);
-  JSValue os = JS_GetPropertyStr(lws->js, glob, "os");
-  JS_FreeValue(lws->js, glob);
-  JSValue fn = JS_GetPropertyStr(lws->js, os, "clearTimeout");
-  JS_FreeValue(lws->js, os);
-
-  JSValue ret = JS_Call(lws->js, fn, JS_NULL, 1, &lws->service_timer_id);
-
+  JSValue ret = JS_Call(lws->js, service_os_timeout(lws, TRUE), JS_NULL, 1, &lws->service_timer_id);
   JS_FreeValue(lws->js, ret);
-  JS_FreeValue(lws->js, fn);
 
   JS_FreeValue(lws->js, lws->service_timer_id);
   lws->service_timer_id = JS_UNDEFINED;
@@ -664,27 +844,77 @@ lwsjs_context_creation_info_free(JSRuntime* rt, struct lws_context_creation_info
     js_free_rt(rt, (char*)ci->listen_accept_protocol);
 }
 
+/* The `poll_backend` creation option: "io_uring" (the default, where
+   built with USE_IO_URING), "epoll" (the default otherwise, where built
+   with USE_EPOLL) or "os". Asking for a backend this build doesn't have
+   falls back to the default rather than failing the whole context. */
+static LWSPollBackend
+poll_backend_fromobj(JSContext* ctx, JSValueConst obj) {
+#if defined(USE_IO_URING)
+  LWSPollBackend ret = POLL_BACKEND_IO_URING;
+#elif defined(USE_EPOLL)
+  LWSPollBackend ret = POLL_BACKEND_EPOLL;
+#else
+  LWSPollBackend ret = POLL_BACKEND_OS;
+#endif
+  char* str;
+
+  if(!JS_IsObject(obj) || !(str = to_stringfree(ctx, js_get_property(ctx, obj, "poll_backend"))))
+    return ret;
+
+  if(!strcasecmp(str, "os"))
+    ret = POLL_BACKEND_OS;
+#ifdef USE_EPOLL
+  else if(!strcasecmp(str, "epoll"))
+    ret = POLL_BACKEND_EPOLL;
+#endif
+#ifdef USE_IO_URING
+  else if(!strcasecmp(str, "io_uring"))
+    ret = POLL_BACKEND_IO_URING;
+#endif
+  else
+    lwsl_warn("LWSContext: poll_backend '%s' not available, using the default", str);
+
+  js_free(ctx, str);
+  return ret;
+}
+
 static LWSContext*
 context_new(JSContext* ctx) {
   LWSContext* lws;
 
   if((lws = js_mallocz(ctx, sizeof(LWSContext)))) {
-    init_list_head(&lws->handlers);
     init_list_head(&lws->timers);
 
     /* js_mallocz() zero-fills, which isn't guaranteed to be JS_UNDEFINED's
        actual bit pattern - set it explicitly rather than relying on that. */
     lws->service_timer_id = JS_UNDEFINED;
+    lws->service_tick_fn = JS_UNDEFINED;
+    lws->os_timeout[0] = lws->os_timeout[1] = JS_UNDEFINED;
+    lws->os_handlers[0] = lws->os_handlers[1] = JS_UNDEFINED;
+    lws->date_value = JS_UNDEFINED;
   }
 
   return lws;
 }
 
+static const char*
+poll_backend_name(LWSPollBackend backend) {
+  switch(backend) {
+    case POLL_BACKEND_EPOLL: return "epoll";
+    case POLL_BACKEND_IO_URING: return "io_uring";
+    default: return "os";
+  }
+}
+
 static void
 context_free(JSRuntime* rt, LWSContext* lws) {
 #ifdef USE_EPOLL
   lws_epoll_destroy(lws);
 #endif
+#ifdef USE_IO_URING
+  lws_uring_destroy(lws);
+#endif
 
   if(lws->js) {
     if(lws->ctx)
@@ -692,6 +922,11 @@ context_free(JSRuntime* rt, LWSContext* lws) {
 
     service_tick_cancel(lws);
     timers_cleanup(lws);
+    iohandler_free(lws);
+    JS_FreeValue(lws->js, lws->service_tick_fn);
+    JS_FreeValue(lws->js, lws->os_timeout[0]);
+    JS_FreeValue(lws->js, lws->os_timeout[1]);
+    JS_FreeValue(lws->js, lws->date_value);
     JS_FreeContext(lws->js);
     lws->js = NULL;
   }
@@ -706,6 +941,13 @@ context_free(JSRuntime* rt, LWSContext* lws) {
     lws->ctx = NULL;
   }
 
+  write_pool_free(lws->write_pool);
+  lws->write_pool = NULL;
+  rx_pool_free(lws->rx_pool);
+  lws->rx_pool = NULL;
+  header_atoms_free(rt, lws->header_atoms);
+  lws->header_atoms = NULL;
+
   lwsjs_context_creation_info_free(rt, &lws->info);
 
   js_free_rt(rt, lws);
@@ -763,6 +1005,8 @@ lwsjs_client_connect(JSContext* ctx, JSValueConst this_val, int argc, JSValueCon
   sock->uri = uri;
 
   lws_client_connect_via_info(&info);
+  /* Connect timeouts and retries are suls - see service_sul_next(). */
+  lwsjs_service_arm(lws);
 
   client_connect_info_free(JS_GetRuntime(ctx), &info);
   JS_FreeValue(ctx, obj);
@@ -794,11 +1038,38 @@ lwsjs_context_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSV
   if(JS_IsObject(argv[0]))
     lwsjs_context_creation_info_fromobj(ctx, argv[0], &lws->info);
 
+  lws->poll_backend = poll_backend_fromobj(ctx, argv[0]);
+  lws->date_header = JS_IsObject(argv[0]) && to_boolfree(ctx, js_get_property(ctx, argv[0], "date_header"));
+#ifdef USE_EPOLL
+  lws->epoll_batch = JS_IsObject(argv[0]) ? to_uint32free_default(ctx, js_get_property(ctx, argv[0], "epoll_batch"), EPOLL_BATCH_DEFAULT) : EPOLL_BATCH_DEFAULT;
+  lws->epoll_edge = JS_IsObject(argv[0]) && to_boolfree(ctx, js_get_property(ctx, argv[0], "epoll_edge_triggered"));
+  lws->epoll_exclusive = JS_IsObject(argv[0]) && to_boolfree(ctx, js_get_property(ctx, argv[0], "epoll_exclusive"));
+#endif
+#ifdef USE_IO_URING
+  lws->uring_entries = JS_IsObject(argv[0]) ? to_uint32free_default(ctx, js_get_property(ctx, argv[0], "uring_entries"), URING_ENTRIES_DEFAULT) : URING_ENTRIES_DEFAULT;
+#endif
+  lws->service_budget = JS_IsObject(argv[0]) ? to_uint32free_default(ctx, js_get_property(ctx, argv[0], "service_budget"), SERVICE_BUDGET_DEFAULT) : SERVICE_BUDGET_DEFAULT;
+  lws->service_budget_us = JS_IsObject(argv[0]) ? to_uint32free_default(ctx, js_get_property(ctx, argv[0], "service_budget_us"), SERVICE_BUDGET_US_DEFAULT) : SERVICE_BUDGET_US_DEFAULT;
+  lws->write_pool = write_pool_new(JS_IsObject(argv[0]) ? to_uint32free_default(ctx, js_get_property(ctx, argv[0], "write_pool_max"), WRITE_POOL_MAX_DEFAULT) : WRITE_POOL_MAX_DEFAULT);
+  lws->rx_pool = rx_pool_new(JS_GetRuntime(ctx),
+                             JS_IsObject(argv[0]) ? to_uint32free_default(ctx, js_get_property(ctx, argv[0], "rx_pool_max"), RX_POOL_MAX_DEFAULT) : RX_POOL_MAX_DEFAULT,
+                             JS_IsObject(argv[0]) ? to_uint32free_default(ctx, js_get_property(ctx, argv[0], "rx_pool_size"), RX_POOL_SIZE_DEFAULT) : RX_POOL_SIZE_DEFAULT);
+
   JS_SetOpaque(obj, lws);
 
   lws->js = JS_DupContext(ctx);
   lws->info.user = obj_ptr(ctx, obj);
 
+#ifdef USE_IO_URING
+  /* Decided up front rather than on the first pollfd like epoll: io_uring
+     may be compiled in yet refused at runtime (kernel.io_uring_disabled,
+     container seccomp profiles), and then this context is epoll's. */
+  if(lws->poll_backend == POLL_BACKEND_IO_URING && lws_uring_init(lws)) {
+    lwsl_notice("LWSContext: io_uring unavailable, falling back to epoll");
+    lws->poll_backend = POLL_BACKEND_EPOLL;
+  }
+#endif
+
   if(!js_has_property(ctx, argv[0], "port"))
     lws->info.port = CONTEXT_PORT_NO_LISTEN;
 
@@ -811,7 +1082,7 @@ lwsjs_context_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSV
     lwsjs_register_pipe_fds(lws);
 
   if(lws->ctx)
-    service_tick_schedule(lws, SERVICE_TICK_MS);
+    lwsjs_service_arm(lws);
 
   JS_DefinePropertyValueStr(ctx, obj, "info", JS_DupValue(ctx, argv[0]), JS_PROP_CONFIGURABLE);
 
@@ -1032,6 +1303,7 @@ lwsjs_context_methods(JSContext* ctx, JSValueConst this_val, int argc, JSValueCo
       list_add(&t->link, &lws->timers);
 
       lws_sul_schedule(lws->ctx, 0, &t->sul, lwsjs_timer_fire, (lws_usec_t)to_int64(ctx, argv[1]) * LWS_US_PER_MS);
+      lwsjs_service_arm(lws);
 
       ret = JS_NewObject(ctx);
       JSValue cancel_fn = js_function_cclosure(ctx, lwsjs_timer_cancel, 0, 0, t, NULL);
@@ -1140,6 +1412,17 @@ enum {
   PROP_EUID,
   PROP_EGID,
   PROP_PROTOCOLS,
+  PROP_WRITE_POOL,
+  PROP_RX_POOL,
+  PROP_POLL_BACKEND,
+  PROP_SERVICE_STATS,
+  PROP_DATE,
+#ifdef USE_EPOLL
+  PROP_EPOLL,
+#endif
+#ifdef USE_IO_URING
+  PROP_URING,
+#endif
 };
 
 static JSValue
@@ -1190,6 +1473,56 @@ lwsjs_context_get(JSContext* ctx, JSValueConst this_val, int magic) {
 
       break;
     }
+
+    case PROP_WRITE_POOL: {
+      ret = write_pool_stats(ctx, lws->write_pool);
+      break;
+    }
+
+    case PROP_RX_POOL: {
+      ret = rx_pool_stats(ctx, lws->rx_pool);
+      break;
+    }
+
+    case PROP_POLL_BACKEND: {
+      ret = JS_NewString(ctx, poll_backend_name(lws->poll_backend));
+      break;
+    }
+
+    case PROP_DATE: {
+      lwsjs_context_date(lws);
+
+      /* One string per second, not one per read. */
+      if(JS_IsUndefined(lws->date_value))
+        lws->date_value = JS_NewStringLen(ctx, lws->date, HTTP_DATE_LEN);
+
+      ret = JS_DupValue(ctx, lws->date_value);
+      break;
+    }
+
+    case PROP_SERVICE_STATS: {
+      ret = JS_NewObject(ctx);
+      JS_SetPropertyStr(ctx, ret, "rounds", JS_NewInt64(ctx, (int64_t)lws->service_rounds));
+      JS_SetPropertyStr(ctx, ret, "exhausted", JS_NewInt64(ctx, (int64_t)lws->service_exhausted));
+      JS_SetPropertyStr(ctx, ret, "budget", JS_NewUint32(ctx, lws->service_budget));
+      JS_SetPropertyStr(ctx, ret, "budgetUs", JS_NewUint32(ctx, lws->service_budget_us));
+      JS_SetPropertyStr(ctx, ret, "ticks", JS_NewInt64(ctx, (int64_t)lws->service_ticks));
+      JS_SetPropertyStr(ctx, ret, "nextTick", JS_IsUndefined(lws->service_timer_id) ? JS_NULL : JS_NewFloat64(ctx, (double)(lws->service_tick_at - lws_now_usecs()) / LWS_US_PER_MS));
+      break;
+    }
+
+#ifdef USE_EPOLL
+    case PROP_EPOLL: {
+      ret = lws_epoll_stats(ctx, lws);
+      break;
+    }
+#endif
+#ifdef USE_IO_URING
+    case PROP_URING: {
+      ret = lws_uring_stats(ctx, lws);
+      break;
+    }
+#endif
   }
 
   return ret;
@@ -1232,6 +1565,17 @@ static const JSCFunctionListEntry lws_context_proto_funcs[] = {
     JS_CGETSET_MAGIC_DEF("euid", lwsjs_context_get, 0, PROP_EUID),
     JS_CGETSET_MAGIC_DEF("egid", lwsjs_context_get, 0, PROP_EGID),
     JS_CGETSET_MAGIC_DEF("protocols", lwsjs_context_get, 0, PROP_PROTOCOLS),
+    JS_CGETSET_MAGIC_DEF("writePool", lwsjs_context_get, 0, PROP_WRITE_POOL),
+    JS_CGETSET_MAGIC_DEF("rxPool", lwsjs_context_get, 0, PROP_RX_POOL),
+    JS_CGETSET_MAGIC_DEF("pollBackend", lwsjs_context_get, 0, PROP_POLL_BACKEND),
+    JS_CGETSET_MAGIC_DEF("serviceStats", lwsjs_context_get, 0, PROP_SERVICE_STATS),
+    JS_CGETSET_MAGIC_DEF("date", lwsjs_context_get, 0, PROP_DATE),
+#ifdef USE_EPOLL
+    JS_CGETSET_MAGIC_DEF("epollStats", lwsjs_context_get, 0, PROP_EPOLL),
+#endif
+#ifdef USE_IO_URING
+    JS_CGETSET_MAGIC_DEF("uringStats", lwsjs_context_get, 0, PROP_URING),
+#endif
     JS_PROP_STRING_DEF("[Symbol.toStringTag]", "LWSContext", JS_PROP_CONFIGURABLE),
 };
 
@@ -4,28 +4,92 @@
 #include <quickjs.h>
 #include <list.h>
 #include <libwebsockets.h>
+#include <time.h>
+
+/* strlen("Sun, 06 Nov 1994 08:49:37 GMT") */
+#define HTTP_DATE_LEN 29
 
 #ifdef USE_EPOLL
 typedef struct LWSEpoll LWSEpoll;
 #endif
+#ifdef USE_IO_URING
+typedef struct LWSUring LWSUring;
+#endif
+
+/* How lws's pollfds get into the QuickJS event loop - see
+   doc/native/event-loop.md. Chosen per context by the `poll_backend`
+   creation option. */
+typedef enum {
+  POLL_BACKEND_OS = 0, /* one os.setReadHandler/setWriteHandler per fd */
+  POLL_BACKEND_EPOLL,  /* one epoll(7) instance (lws-epoll.c), USE_EPOLL builds */
+  POLL_BACKEND_IO_URING, /* io_uring polls + one eventfd (lws-uring.c), USE_IO_URING builds */
+} LWSPollBackend;
+
+/* Per-fd state of the `os` backend and of everything else registered with
+   quickjs-libc (iohandler.h), indexed by fd. */
+typedef struct {
+  uint8_t handlers; /* IOHANDLER_READ/IOHANDLER_WRITE currently registered */
+  short events;     /* lws's POLLIN/POLLOUT interest, read by pollfd_handler() */
+  /* pollfd_handler() closures for reading and writing, made the first
+     time each is needed and reused for as long as the context lives
+     (across fd reuse too - they only carry the context and the fd), so
+     a poll-mode change never allocates. JS_UNDEFINED until then. */
+  JSValue pollfd[2];
+} LWSFdSlot;
 
 typedef struct LWSContext {
   struct lws_context* ctx;
   struct lws_context_creation_info info;
   JSContext* js;
-  struct list_head handlers;
+  LWSFdSlot* fds;
+  int nfds;
+  JSValue os_handlers[2]; /* os.setReadHandler, os.setWriteHandler */
   /* Live ctx.schedule() timers (lws-context.c: LWSTimer), so .cancel()
      can safely no-op on a stale handle (already fired or already
-     cancelled) instead of dereferencing a freed pointer - same list+lookup
-     idiom as `handlers`/iohandler_find() above. */
+     cancelled) instead of dereferencing a freed pointer. */
   struct list_head timers;
   /* Holds whatever os.setTimeout() returned - an opaque JS "OSTimer"
      object in this quickjs-libc, not a plain numeric id - so it must be
      passed back to os.clearTimeout() as-is, never coerced to a number.
      JS_UNDEFINED means no service tick is currently scheduled. */
   JSValue service_timer_id;
+  lws_usec_t service_tick_at; /* when service_timer_id fires */
+  uint64_t service_ticks;
+  JSValue service_tick_fn;    /* the service_tick() closure, made once */
+  JSValue os_timeout[2];      /* os.setTimeout, os.clearTimeout */
+  /* Recycled wsi.write() queue chunks for every socket of this context,
+     capped at the `write_pool_max` creation option - see WriteChunkPool,
+     lws-socket.c. */
+  struct WriteChunkPool* write_pool;
+  /* Recycled backing stores of the ArrayBuffers RX data is copied into,
+     capped by the `rx_pool_max`/`rx_pool_size` creation options - see
+     RxBufferPool, lws-rxpool.c. */
+  struct RxBufferPool* rx_pool;
+  /* Header-name atoms wsi.headers and friends are built with, interned on
+     first use - see HeaderAtoms, lws-socket.c. */
+  struct HeaderAtoms* header_atoms;
+  LWSPollBackend poll_backend;
+  /* The current second as an RFC 7231 IMF-fixdate, and the same as a JS
+     string once ctx.date asked for it - formatted again only when the
+     second changes, see lwsjs_context_date(). date_header is the
+     `date_header` option: respond() (lws-socket.c) adds it as Date. */
+  time_t date_time;
+  char date[HTTP_DATE_LEN + 1];
+  JSValue date_value;
+  BOOL date_header;
+  /* Forced-service budget per wakeup (`service_budget`, `service_budget_us`
+     options) and what ctx.serviceStats reports about it - see
+     lwsjs_service_forced(), lws-context.c. */
+  uint32_t service_budget, service_budget_us;
+  uint64_t service_rounds, service_exhausted;
 #ifdef USE_EPOLL
   LWSEpoll* epoll;
+  int epoll_batch; /* max events per epoll_wait() */
+  BOOL epoll_edge, epoll_exclusive;
+#endif
+#ifdef USE_IO_URING
+  LWSUring* uring;
+  int uring_entries; /* SQ ring size */
 #endif
 } LWSContext;
 
@@ -33,11 +97,27 @@ typedef struct LWSHandlers {
   JSContext* ctx;
   void* obj;
   JSValue callback, callbacks[LWS_CALLBACK_USER + 1];
+  /* `zero_copy_rx` protocol option: binary RX data is handed to JS as an
+     ArrayBuffer aliasing lws's rx buffer and detached once the callback
+     returns, instead of being copied. */
+  BOOL zero_copy_rx;
+  /* `reassemble` protocol option: fragmented WS messages are collected
+     natively (LWSSocket.rx_msg) and delivered once, whole, on the final
+     fragment; ones past `max_message_size` bytes close with 1009. */
+  BOOL reassemble;
+  uint32_t max_message_size;
+  /* `router` protocol option: an LWSRouter whose routes with a static
+     response (setResponse()) get it sent for GET/HEAD straight from
+     LWS_CALLBACK_HTTP, without any JS callback. */
+  JSValue router;
 } LWSHandlers;
 
 extern JSClassID lwsjs_context_class_id;
 
 int lwsjs_context_init(JSContext*, JSModuleDef*);
+BOOL lwsjs_service_forced(LWSContext*);
+void lwsjs_service_arm(LWSContext*);
+const char* lwsjs_context_date(LWSContext*);
 void lwsjs_context_creation_info_fromobj(JSContext*, JSValueConst, struct lws_context_creation_info*);
 void lwsjs_context_creation_info_free(JSRuntime*, struct lws_context_creation_info*);
 
@@ -4,67 +4,361 @@
 #include "js-utils.h"
 
 #include <sys/epoll.h>
+#include <sys/socket.h>
 #include <poll.h>
+#include <stdlib.h>
 #include <unistd.h>
 
+/* Per-fd state, kept in an array indexed by the fd itself (fds are small,
+   dense integers, and lws has its own fd-indexed table anyway) - so
+   mapping an epoll_wait() result back to its interest mask is one array
+   access, not a search over every registered fd. The entry is looked up
+   at dispatch time by fd rather than handed over as epoll_event.data.ptr:
+   servicing one event can close (and DEL) another fd whose event is still
+   further along in the same batch, and a stale pointer there would be a
+   use-after-free, whereas a cleared table slot is simply skipped. */
 typedef struct {
-  struct list_head link;
-  int fd;
   int events; /* POLLIN/POLLOUT interest, as registered by lws */
+  int ready;  /* edge-triggered mode: POLLIN/POLLOUT/POLLHUP seen, not yet serviced */
+  unsigned registered : 1, exclusive : 1, pending : 1;
 } LWSEpollFd;
 
 struct LWSEpoll {
   int epfd;
   LWSContext* lws;
-  struct list_head fds;
+  LWSEpollFd* fds;
+  int nfds;
+  struct epoll_event* events;
+  int max_events;
+  BOOL edge, exclusive, draining;
+  /* Edge-triggered mode: fds serviced during this drain whose readiness
+     is unknown afterwards - see epoll_settle(). */
+  int *pending, npending, pending_size;
+  struct pollfd* pollfds;
+  /* Edge-triggered mode: the epoll_settle_call() closure, made once, and
+     whether a job to run it is queued - see epoll_settle_later(). Its
+     opaque is settle_cell, which lws_epoll_destroy() clears, since a
+     queued job can outlive the context. */
+  JSValue settle_fn;
+  LWSEpoll** settle_cell;
+  BOOL settle_queued;
+  /* epoll_ctl() accounting: total, plus the count over the last complete
+     one-second window (ctl_window_* is the one in progress). */
+  uint64_t ctl_calls;
+  uint32_t ctl_window_count, ctl_per_second;
+  lws_usec_t ctl_window_start;
 };
 
+/* How many poll() rounds epoll_settle() runs before leaving what's left
+   to the next wakeup - bounds how long one wakeup can keep servicing a
+   peer that never stops sending. */
+#define EPOLL_SETTLE_PASSES 16
+
+static LWSEpollFd*
+epoll_fd_get(LWSEpoll* ep, int fd) {
+  if(fd < 0 || fd >= ep->nfds || !ep->fds[fd].registered)
+    return NULL;
+
+  return &ep->fds[fd];
+}
+
 static LWSEpollFd*
-epoll_fd_find(LWSEpoll* ep, int fd) {
-  struct list_head* el;
+epoll_fd_slot(LWSEpoll* ep, int fd) {
+  if(fd < 0)
+    return NULL;
+
+  if(fd >= ep->nfds) {
+    int n = ep->nfds ? ep->nfds : 64;
+    LWSEpollFd* fds;
+
+    while(n <= fd)
+      n *= 2;
+
+    if(!(fds = js_realloc(ep->lws->js, ep->fds, n * sizeof(LWSEpollFd))))
+      return NULL;
+
+    memset(fds + ep->nfds, 0, (n - ep->nfds) * sizeof(LWSEpollFd));
+    ep->fds = fds;
+    ep->nfds = n;
+  }
+
+  return &ep->fds[fd];
+}
+
+static void
+epoll_ctl_window(LWSEpoll* ep, lws_usec_t now) {
+  if(now - ep->ctl_window_start >= LWS_US_PER_SEC) {
+    /* A window that ended more than a second ago saw no calls at all. */
+    ep->ctl_per_second = now - ep->ctl_window_start < 2 * LWS_US_PER_SEC ? ep->ctl_window_count : 0;
+    ep->ctl_window_start = now;
+    ep->ctl_window_count = 0;
+  }
+}
+
+static int
+epoll_ctl_counted(LWSEpoll* ep, int op, int fd, struct epoll_event* ev) {
+  epoll_ctl_window(ep, lws_now_usecs());
+  ep->ctl_window_count++;
+  ep->ctl_calls++;
+
+  return epoll_ctl(ep->epfd, op, fd, ev);
+}
+
+static uint32_t
+epoll_ctl_events(LWSEpoll* ep, LWSEpollFd* e, int events) {
+  uint32_t ev = 0;
+
+  /* Edge-triggered registrations always cover both directions: interest
+     changes are then tracked in e->events alone, with no syscall. */
+  if(ep->edge)
+    return EPOLLIN | EPOLLOUT | EPOLLET | (e->exclusive ? EPOLLEXCLUSIVE : 0);
+
+  if(events & POLLIN)
+    ev |= EPOLLIN;
+  if(events & POLLOUT)
+    ev |= EPOLLOUT;
+
+  return ev | (e->exclusive ? EPOLLEXCLUSIVE : 0);
+}
+
+/* Re-registers fd with its current interest - only ever done when that
+   interest changed (and in edge-triggered mode, where the registered mask
+   itself never does, as the fallback that has the kernel raise the edge
+   of a direction that may be ready when it can't be polled for in
+   epoll_settle()). EPOLLEXCLUSIVE registrations can't be
+   EPOLL_CTL_MOD'ed (EINVAL), so those are removed and re-added. */
+static void
+epoll_rearm(LWSEpoll* ep, int fd, LWSEpollFd* e) {
+  struct epoll_event ev = {.events = epoll_ctl_events(ep, e, e->events), .data.fd = fd};
+
+  if(e->exclusive) {
+    epoll_ctl_counted(ep, EPOLL_CTL_DEL, fd, NULL);
+    epoll_ctl_counted(ep, EPOLL_CTL_ADD, fd, &ev);
+  } else {
+    epoll_ctl_counted(ep, EPOLL_CTL_MOD, fd, &ev);
+  }
+}
+
+/* Queues fd for epoll_settle(). FALSE if the list couldn't grow - the
+   caller has to make sure the fd's readiness isn't lost some other way. */
+static BOOL
+epoll_pending_add(LWSEpoll* ep, int fd, LWSEpollFd* e) {
+  if(e->pending)
+    return TRUE;
+
+  if(ep->npending == ep->pending_size) {
+    int n = ep->pending_size ? ep->pending_size * 2 : 64;
+    int* pending;
+    struct pollfd* pollfds;
+
+    if(!(pending = js_realloc(ep->lws->js, ep->pending, n * sizeof(int))))
+      return FALSE;
+
+    ep->pending = pending;
+
+    if(!(pollfds = js_realloc(ep->lws->js, ep->pollfds, n * sizeof(struct pollfd))))
+      return FALSE;
+
+    ep->pollfds = pollfds;
+    ep->pending_size = n;
+  }
+
+  e->pending = TRUE;
+  ep->pending[ep->npending++] = fd;
+  return TRUE;
+}
+
+static int
+epoll_revents(uint32_t events) {
+  int revents = 0;
+
+  if(events & EPOLLIN)
+    revents |= POLLIN;
+  if(events & EPOLLOUT)
+    revents |= POLLOUT;
+  if(events & (EPOLLERR | EPOLLHUP))
+    revents |= POLLHUP;
+
+  return revents;
+}
+
+static void
+epoll_service(LWSEpoll* ep, int fd, int events, int revents) {
+  struct lws_pollfd pfd = {
+      .fd = fd,
+      .events = events,
+      .revents = revents,
+  };
+
+  lws_service_fd(ep->lws->ctx, &pfd);
+}
+
+/* Edge-triggered mode: service whatever of fd's recorded readiness lws is
+   currently interested in. After that, whether the fd is *still* ready is
+   unknown - lws reads at most one buffer per POLLIN, and may or may not
+   have filled the socket's send buffer on POLLOUT - and no new edge will
+   come while it stays ready, so it's queued for epoll_settle() to ask the
+   kernel. Should the queue be out of memory, the event is still serviced
+   right here, and the fd re-armed after so the kernel raises the edge
+   again if it is still ready. */
+static void
+epoll_dispatch(LWSEpoll* ep, int fd, LWSEpollFd* e) {
+  int fire = e->ready & (e->events | POLLHUP);
+  BOOL queued;
+
+  if(!fire)
+    return;
+
+  e->ready &= ~fire;
+  queued = epoll_pending_add(ep, fd, e);
+  epoll_service(ep, fd, e->events, fire);
+
+  if(!queued && (e = epoll_fd_get(ep, fd)))
+    epoll_rearm(ep, fd, e);
+}
+
+/* Edge-triggered mode: one poll() over every fd left ambiguous by
+   epoll_dispatch() (rather than one syscall per fd), servicing those that
+   turn out to still be ready, until none are or EPOLL_SETTLE_PASSES runs
+   out. Whatever is left then stays on the pending list for the next drain,
+   woken through lws's own cancel pipe (registered here like any other fd)
+   - a single write for all of them, rather than an EPOLL_CTL_MOD per fd
+   whose interest never changed. */
+static void
+epoll_settle(LWSEpoll* ep) {
+  for(int pass = 0; ep->npending > 0; pass++) {
+    int i, n = 0, count = ep->npending;
+
+    if(pass == EPOLL_SETTLE_PASSES) {
+      lws_cancel_service(ep->lws->ctx);
+      return;
+    }
+
+    for(i = 0; i < count; i++) {
+      int fd = ep->pending[i];
+      LWSEpollFd* e;
 
-  list_for_each(el, &ep->fds) {
-    LWSEpollFd* e = list_entry(el, LWSEpollFd, link);
+      if(fd < ep->nfds)
+        ep->fds[fd].pending = FALSE;
 
-    if(e->fd == fd)
-      return e;
+      if(!(e = epoll_fd_get(ep, fd)))
+        continue;
+
+      if(e->events & (POLLIN | POLLOUT))
+        ep->pollfds[n++] = (struct pollfd){.fd = fd, .events = e->events & (POLLIN | POLLOUT)};
+    }
+
+    ep->npending = 0;
+
+    if(n == 0 || poll(ep->pollfds, n, 0) <= 0)
+      break;
+
+    for(i = 0; i < n; i++) {
+      LWSEpollFd* e;
+
+      if(!ep->pollfds[i].revents || !(e = epoll_fd_get(ep, ep->pollfds[i].fd)))
+        continue;
+
+      e->ready |= ep->pollfds[i].revents & (POLLIN | POLLOUT | POLLHUP | POLLERR);
+
+      if(e->ready & POLLERR)
+        e->ready = (e->ready & ~POLLERR) | POLLHUP;
+
+      epoll_dispatch(ep, ep->pollfds[i].fd, e);
+    }
+  }
+}
+
+/* Edge-triggered mode: the job epoll_settle_later() queues. */
+static JSValue
+epoll_settle_call(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int magic, void* opaque) {
+  LWSEpoll* ep = *(LWSEpoll**)opaque;
+
+  if(ep) {
+    ep->settle_queued = FALSE;
+    ep->draining = TRUE;
+    epoll_settle(ep);
+    ep->draining = FALSE;
+    lwsjs_service_forced(ep->lws);
   }
 
-  return NULL;
+  return JS_UNDEFINED;
+}
+
+static JSValue
+epoll_settle_job(JSContext* ctx, int argc, JSValueConst* argv) {
+  return JS_Call(ctx, argv[0], JS_UNDEFINED, 0, NULL);
+}
+
+/* Edge-triggered mode: runs epoll_settle() as a job, once the JS that
+   changed lws's interest outside a drain has returned - one poll() for
+   every fd that gained a direction in the meantime, rather than an
+   EPOLL_CTL_MOD each. FALSE if it couldn't be queued. */
+static BOOL
+epoll_settle_later(LWSEpoll* ep) {
+  if(ep->settle_queued)
+    return TRUE;
+
+  if(JS_IsUndefined(ep->settle_fn)) {
+    if(!(ep->settle_cell = malloc(sizeof(LWSEpoll*))))
+      return FALSE;
+
+    *ep->settle_cell = ep;
+    ep->settle_fn = js_function_cclosure(ep->lws->js, epoll_settle_call, 0, 0, ep->settle_cell, free);
+
+    if(JS_IsException(ep->settle_fn)) {
+      free(ep->settle_cell);
+      ep->settle_cell = NULL;
+      ep->settle_fn = JS_UNDEFINED;
+      return FALSE;
+    }
+  }
+
+  if(JS_EnqueueJob(ep->lws->js, epoll_settle_job, 1, &ep->settle_fn))
+    return FALSE;
+
+  ep->settle_queued = TRUE;
+  return TRUE;
 }
 
 static void
 epoll_drain(LWSEpoll* ep) {
-  struct epoll_event events[32];
   int i, n;
 
+  ep->draining = TRUE;
+
   for(;;) {
-    n = epoll_wait(ep->epfd, events, countof(events), 0);
+    n = epoll_wait(ep->epfd, ep->events, ep->max_events, 0);
 
     if(n <= 0)
       break;
 
     for(i = 0; i < n; i++) {
-      LWSEpollFd* e = epoll_fd_find(ep, events[i].data.fd);
-      struct lws_pollfd pfd = {
-          .fd = events[i].data.fd,
-          .events = e ? e->events : 0,
-          .revents = 0,
-      };
-
-      if(events[i].events & EPOLLIN)
-        pfd.revents |= POLLIN;
-      if(events[i].events & EPOLLOUT)
-        pfd.revents |= POLLOUT;
-      if(events[i].events & (EPOLLERR | EPOLLHUP))
-        pfd.revents |= POLLHUP;
-
-      lws_service_fd(ep->lws->ctx, &pfd);
+      int fd = ep->events[i].data.fd;
+      LWSEpollFd* e;
+
+      if(!(e = epoll_fd_get(ep, fd)))
+        continue;
+
+      if(ep->edge) {
+        e->ready |= epoll_revents(ep->events[i].events);
+        epoll_dispatch(ep, fd, e);
+      } else {
+        epoll_service(ep, fd, e->events, epoll_revents(ep->events[i].events));
+      }
     }
 
-    if(n < (int)countof(events))
+    if(n < ep->max_events)
       break;
   }
+
+  if(ep->edge)
+    epoll_settle(ep);
+
+  ep->draining = FALSE;
+
+  /* Same as pollfd_handler(), once for the whole batch. */
+  lwsjs_service_forced(ep->lws);
 }
 
 static JSValue
@@ -76,17 +370,28 @@ epoll_readable(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* ar
 static LWSEpoll*
 epoll_new(LWSContext* lws) {
   LWSEpoll* ep;
+  int max_events = lws->epoll_batch > 0 ? lws->epoll_batch : EPOLL_BATCH_DEFAULT;
 
   if(!(ep = js_mallocz(lws->js, sizeof(LWSEpoll))))
     return NULL;
 
+  if(!(ep->events = js_malloc(lws->js, max_events * sizeof(struct epoll_event)))) {
+    js_free(lws->js, ep);
+    return NULL;
+  }
+
   if((ep->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    js_free(lws->js, ep->events);
     js_free(lws->js, ep);
     return NULL;
   }
 
   ep->lws = lws;
-  init_list_head(&ep->fds);
+  ep->max_events = max_events;
+  ep->edge = lws->epoll_edge;
+  ep->exclusive = lws->epoll_exclusive;
+  ep->ctl_window_start = lws_now_usecs();
+  ep->settle_fn = JS_UNDEFINED;
 
   JSValue fn = js_function_cclosure(lws->js, epoll_readable, 0, 0, ep, NULL);
   iohandler_set(lws, ep->epfd, fn, FALSE);
@@ -95,6 +400,14 @@ epoll_new(LWSContext* lws) {
   return ep;
 }
 
+static BOOL
+epoll_is_listener(int fd) {
+  int val = 0;
+  socklen_t len = sizeof(val);
+
+  return getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &val, &len) == 0 && val;
+}
+
 void
 lws_epoll_ctl(LWSContext* lws, int fd, int events) {
   LWSEpoll* ep;
@@ -104,21 +417,43 @@ lws_epoll_ctl(LWSContext* lws, int fd, int events) {
   if(!(ep = lws->epoll) && !(ep = lws->epoll = epoll_new(lws)))
     return;
 
-  if(events & POLLIN)
-    ev.events |= EPOLLIN;
-  if(events & POLLOUT)
-    ev.events |= EPOLLOUT;
-  ev.data.fd = fd;
+  if(!(e = epoll_fd_slot(ep, fd)))
+    return;
 
-  if((e = epoll_fd_find(ep, fd))) {
+  if(!e->registered) {
+    e->registered = TRUE;
+    e->exclusive = ep->exclusive && epoll_is_listener(fd);
+    e->ready = 0;
     e->events = events;
-    epoll_ctl(ep->epfd, EPOLL_CTL_MOD, fd, &ev);
-  } else if((e = js_mallocz(lws->js, sizeof(LWSEpollFd)))) {
-    e->fd = fd;
+
+    ev.events = epoll_ctl_events(ep, e, events);
+    ev.data.fd = fd;
+    epoll_ctl_counted(ep, EPOLL_CTL_ADD, fd, &ev);
+    return;
+  }
+
+  if(ep->edge) {
+    int added = events & ~e->events & (POLLIN | POLLOUT);
+
     e->events = events;
-    list_add(&e->link, &ep->fds);
-    epoll_ctl(ep->epfd, EPOLL_CTL_ADD, fd, &ev);
+
+    /* Newly wanted direction: if it's already ready no edge will announce
+       it, so find out. That's just one more fd for epoll_settle()'s
+       poll() - the one ending this drain, or outside one, a job run once
+       the current JS returns. Only if neither can take it is the
+       registration re-armed, which makes the kernel raise the edge now if
+       the fd is ready. */
+    if(added && !(epoll_pending_add(ep, fd, e) && (ep->draining || epoll_settle_later(ep))))
+      epoll_rearm(ep, fd, e);
+
+    return;
   }
+
+  if(events == e->events)
+    return;
+
+  e->events = events;
+  epoll_rearm(ep, fd, e);
 }
 
 void
@@ -129,31 +464,52 @@ lws_epoll_del(LWSContext* lws, int fd) {
   if(!(ep = lws->epoll))
     return;
 
-  if((e = epoll_fd_find(ep, fd))) {
-    epoll_ctl(ep->epfd, EPOLL_CTL_DEL, fd, NULL);
-    list_del(&e->link);
-    js_free(lws->js, e);
+  if((e = epoll_fd_get(ep, fd))) {
+    epoll_ctl_counted(ep, EPOLL_CTL_DEL, fd, NULL);
+    e->registered = FALSE;
+    e->events = e->ready = 0;
   }
 }
 
+JSValue
+lws_epoll_stats(JSContext* ctx, LWSContext* lws) {
+  LWSEpoll* ep;
+  JSValue ret;
+
+  if(lws->poll_backend != POLL_BACKEND_EPOLL)
+    return JS_NULL;
+
+  ret = JS_NewObject(ctx);
+
+  if((ep = lws->epoll))
+    epoll_ctl_window(ep, lws_now_usecs());
+
+  JS_SetPropertyStr(ctx, ret, "ctlCalls", JS_NewInt64(ctx, ep ? (int64_t)ep->ctl_calls : 0));
+  JS_SetPropertyStr(ctx, ret, "ctlPerSecond", JS_NewInt64(ctx, ep ? ep->ctl_per_second : 0));
+  JS_SetPropertyStr(ctx, ret, "edgeTriggered", JS_NewBool(ctx, lws->epoll_edge));
+  JS_SetPropertyStr(ctx, ret, "exclusive", JS_NewBool(ctx, lws->epoll_exclusive));
+  JS_SetPropertyStr(ctx, ret, "batch", JS_NewInt32(ctx, ep ? ep->max_events : lws->epoll_batch));
+  return ret;
+}
+
 void
 lws_epoll_destroy(LWSContext* lws) {
   LWSEpoll* ep;
-  struct list_head *el, *next;
 
   if(!(ep = lws->epoll))
     return;
 
   iohandler_set(lws, ep->epfd, JS_NULL, FALSE);
 
-  list_for_each_safe(el, next, &ep->fds) {
-    LWSEpollFd* e = list_entry(el, LWSEpollFd, link);
-
-    list_del(&e->link);
-    js_free(lws->js, e);
-  }
+  if(ep->settle_cell)
+    *ep->settle_cell = NULL;
 
+  JS_FreeValue(lws->js, ep->settle_fn);
   close(ep->epfd);
+  js_free(lws->js, ep->fds);
+  js_free(lws->js, ep->events);
+  js_free(lws->js, ep->pending);
+  js_free(lws->js, ep->pollfds);
   js_free(lws->js, ep);
   lws->epoll = NULL;
 }
@@ -5,6 +5,9 @@
 
 #include "lws-context.h"
 
+/* epoll_wait() batch size when the `epoll_batch` option isn't given. */
+#define EPOLL_BATCH_DEFAULT 64
+
 /* Add or modify epoll interest for fd (POLLIN/POLLOUT bitmask). Lazily
    creates the LWSContext's epoll instance and its single quickjs-libc
    read-handler registration on first use. */
@@ -13,6 +16,10 @@ void lws_epoll_ctl(LWSContext*, int fd, int events);
 /* Drop fd from the epoll instance. */
 void lws_epoll_del(LWSContext*, int fd);
 
+/* { ctlCalls, ctlPerSecond, edgeTriggered, exclusive, batch } for
+   ctx.epoll, or null if the context doesn't use this backend. */
+JSValue lws_epoll_stats(JSContext*, LWSContext*);
+
 /* Tear down the epoll instance: close epfd and unregister its read handler. */
 void lws_epoll_destroy(LWSContext*);
 
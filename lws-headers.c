@@ -0,0 +1,241 @@
+#include "js-utils.h"
+#include "lws.h"
+#include "lws-socket.h"
+#include <cutils.h>
+#include <list.h>
+#include <ctype.h>
+
+JSClassID lwsjs_headers_class_id;
+static JSValue lwsjs_headers_proto, lwsjs_headers_ctor;
+
+/* A read-only view of one HTTP transaction's request headers. While the
+   transaction is live it reads straight from lws's header table through
+   the socket (socket_header(), lws-socket.c) and copies nothing; before
+   lws takes the table back, lwsjs_headers_detach() swaps that for a
+   snapshot object of its own, so one kept around afterwards still has
+   them - and never sees the next request on a keep-alive connection. */
+typedef struct {
+  struct list_head link; /* on sock->live_headers while attached */
+  LWSSocket* sock;       /* NULL once detached */
+  JSValue map;           /* the snapshot once detached, JS_UNDEFINED before */
+} LWSHeaders;
+
+enum {
+  METHOD_GET = 0,
+  METHOD_HAS,
+  METHOD_TO_OBJECT,
+};
+
+enum {
+  PROP_LIVE = 0,
+};
+
+static inline LWSHeaders*
+lwsjs_headers_data2(JSContext* ctx, JSValueConst value) {
+  return JS_GetOpaque2(ctx, value, lwsjs_headers_class_id);
+}
+
+static void
+headers_unlink(LWSHeaders* h, JSRuntime* rt) {
+  if(h->sock) {
+    list_del(&h->link);
+    socket_free(h->sock, rt);
+    h->sock = 0;
+  }
+}
+
+/* Hands every LWSHeaders still attached to s a snapshot of its own: a
+   copy of the header table (if copy and it's still there) or of what
+   wsi.headers has, else an empty one. */
+void
+lwsjs_headers_detach(JSContext* ctx, LWSSocket* s, BOOL copy) {
+  struct list_head *el, *next;
+  JSValue map = JS_UNDEFINED;
+
+  list_for_each_safe(el, next, &s->live_headers) {
+    LWSHeaders* h = list_entry(el, LWSHeaders, link);
+
+    /* One copy, shared by all of them - they never write to it. */
+    if(JS_IsUndefined(map))
+      map = copy || JS_IsObject(s->headers) ? socket_headers_copy(ctx, s) : JS_NewObjectProto(ctx, JS_NULL);
+
+    h->map = JS_DupValue(ctx, map);
+    headers_unlink(h, JS_GetRuntime(ctx));
+  }
+
+  JS_FreeValue(ctx, map);
+}
+
+static JSValue
+lwsjs_headers_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  LWSHeaders* h;
+  LWSSocket* sock;
+
+  if(!(sock = lwsjs_socket_data(argv[0])))
+    return JS_ThrowTypeError(ctx, "argument 1 must be an LWSSocket");
+
+  if(!(h = js_mallocz(ctx, sizeof(LWSHeaders))))
+    return JS_EXCEPTION;
+
+  /* using new_target to get the prototype is necessary when the class is extended. */
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    proto = JS_DupValue(ctx, lwsjs_headers_proto);
+
+  JSValue obj = JS_NewObjectProtoClass(ctx, proto, lwsjs_headers_class_id);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj)) {
+    js_free(ctx, h);
+    return JS_EXCEPTION;
+  }
+
+  /* A socket whose wsi is gone has nothing live to read. */
+  if(sock->wsi) {
+    h->sock = socket_dup(sock);
+    h->map = JS_UNDEFINED;
+    list_add_tail(&h->link, &sock->live_headers);
+  } else {
+    h->map = socket_headers_copy(ctx, sock);
+  }
+
+  JS_SetOpaque(obj, h);
+  return obj;
+}
+
+static JSValue
+lwsjs_headers_methods(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  LWSHeaders* h;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(h = lwsjs_headers_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case METHOD_GET:
+    case METHOD_HAS: {
+      const char* name;
+      size_t len;
+
+      if(!(name = JS_ToCStringLen(ctx, &len, argv[0])))
+        return JS_EXCEPTION;
+
+      if(h->sock) {
+        ret = socket_header(ctx, h->sock, name, len);
+      } else {
+        char key[len + 1];
+
+        for(size_t i = 0; i < len; i++)
+          key[i] = tolower((unsigned char)name[i]);
+
+        key[len] = '\0';
+
+        if(JS_IsUndefined(ret = JS_GetPropertyStr(ctx, h->map, key)))
+          ret = JS_NULL;
+      }
+
+      JS_FreeCString(ctx, name);
+
+      if(magic == METHOD_HAS) {
+        BOOL found = !JS_IsNull(ret) && !JS_IsException(ret);
+
+        JS_FreeValue(ctx, ret);
+        ret = JS_NewBool(ctx, found);
+      }
+
+      break;
+    }
+
+    case METHOD_TO_OBJECT: {
+      if(h->sock) {
+        ret = socket_headers_copy(ctx, h->sock);
+      } else {
+        JSPropertyEnum* tab;
+        uint32_t len;
+
+        ret = JS_NewObjectProto(ctx, JS_NULL);
+
+        if(!JS_GetOwnPropertyNames(ctx, &tab, &len, h->map, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY)) {
+          for(uint32_t i = 0; i < len; i++) {
+            JS_SetProperty(ctx, ret, tab[i].atom, JS_GetProperty(ctx, h->map, tab[i].atom));
+            JS_FreeAtom(ctx, tab[i].atom);
+          }
+
+          js_free(ctx, tab);
+        }
+      }
+
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static JSValue
+lwsjs_headers_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  LWSHeaders* h;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(h = lwsjs_headers_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case PROP_LIVE: {
+      ret = JS_NewBool(ctx, h->sock != NULL);
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static void
+lwsjs_headers_finalizer(JSRuntime* rt, JSValue val) {
+  LWSHeaders* h;
+
+  if((h = JS_GetOpaque(val, lwsjs_headers_class_id))) {
+    headers_unlink(h, rt);
+    JS_FreeValueRT(rt, h->map);
+    js_free_rt(rt, h);
+  }
+}
+
+static void
+lwsjs_headers_mark(JSRuntime* rt, JSValueConst val, JS_MarkFunc* mark_func) {
+  LWSHeaders* h;
+
+  if((h = JS_GetOpaque(val, lwsjs_headers_class_id)))
+    JS_MarkValue(rt, h->map, mark_func);
+}
+
+static const JSClassDef lws_headers_class = {
+    "LWSHeaders",
+    .finalizer = lwsjs_headers_finalizer,
+    .gc_mark = lwsjs_headers_mark,
+};
+
+static const JSCFunctionListEntry lws_headers_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("get", 1, lwsjs_headers_methods, METHOD_GET),
+    JS_CFUNC_MAGIC_DEF("has", 1, lwsjs_headers_methods, METHOD_HAS),
+    JS_CFUNC_MAGIC_DEF("toObject", 0, lwsjs_headers_methods, METHOD_TO_OBJECT),
+    JS_CGETSET_MAGIC_DEF("live", lwsjs_headers_get, 0, PROP_LIVE),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "LWSHeaders", JS_PROP_CONFIGURABLE),
+};
+
+int
+lwsjs_headers_init(JSContext* ctx, JSModuleDef* m) {
+  JS_NewClassID(&lwsjs_headers_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), lwsjs_headers_class_id, &lws_headers_class);
+
+  lwsjs_headers_proto = JS_NewObjectProto(ctx, JS_NULL);
+  JS_SetPropertyFunctionList(ctx, lwsjs_headers_proto, lws_headers_proto_funcs, countof(lws_headers_proto_funcs));
+
+  lwsjs_headers_ctor = JS_NewCFunction2(ctx, lwsjs_headers_constructor, "LWSHeaders", 1, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, lwsjs_headers_ctor, lwsjs_headers_proto);
+
+  if(m) {
+    JS_SetModuleExport(ctx, m, "LWSHeaders", lwsjs_headers_ctor);
+  }
+
+  return 0;
+}
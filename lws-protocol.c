@@ -1,6 +1,7 @@
 #include "lws-protocol.h"
 #include "lws-socket.h"
 #include "lws-context.h"
+#include "lws-rxpool.h"
 #include "lws-sockaddr46.h"
 #include "lws-tls.h"
 #include "js-utils.h"
@@ -11,6 +12,9 @@
 #ifdef USE_EPOLL
 #include "lws-epoll.h"
 #endif
+#ifdef USE_IO_URING
+#include "lws-uring.h"
+#endif
 
 /* libwebsockets/lib/core-net/vhost.c - not part of any public lws header,
    see lwsjs_register_pipe_fds()'s doc comment below for why it's needed */
@@ -50,21 +54,25 @@ int lws_context_get_pipe_fd(struct lws_context*, int tsi);
 #endif
 
 typedef struct {
-  int fd, events;
+  int fd;
   BOOL write;
-  struct lws_context* lws;
+  LWSContext* lc;
 } LWSPollfdClosure;
 
 static JSValue
 pollfd_handler(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int magic, void* opaque) {
   LWSPollfdClosure* pc = opaque;
+  struct lws_context* lws = pc->lc->ctx;
   struct lws_pollfd pf = {
       .fd = pc->fd,
-      .events = pc->events,
+      .events = pc->fd < pc->lc->nfds ? pc->lc->fds[pc->fd].events : 0,
       .revents = pc->write ? POLLOUT : POLLIN,
   };
 
-  lws_service_fd(pc->lws, &pf);
+  if(!lws)
+    return JS_UNDEFINED;
+
+  lws_service_fd(lws, &pf);
 
   /*
    * A serviced wsi may still have buffered data left to parse (e.g. a
@@ -75,14 +83,69 @@ pollfd_handler(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* ar
    * handled internally, but external-poll integrations (this one) must
    * drive it explicitly, or such a wsi silently waits forever for a
    * poll() event that will never come - see lws_service_adjust_timeout()
-   * in lws-service.h.
+   * in lws-service.h. Bounded per wakeup by the context's service
+   * budget.
    */
-  while(lws_service_adjust_timeout(pc->lws, 1, 0) == 0)
-    lws_service_tsi(pc->lws, -1, 0);
+  lwsjs_service_forced(pc->lc);
 
   return JS_UNDEFINED;
 }
 
+/* fd's cached pollfd_handler() closure for one direction (borrowed). */
+static JSValueConst
+pollfd_closure(LWSContext* lc, LWSFdSlot* slot, int fd, BOOL write) {
+  if(JS_IsUndefined(slot->pollfd[write])) {
+    LWSPollfdClosure* pc;
+
+    if(!(pc = malloc(sizeof(LWSPollfdClosure))))
+      return JS_UNDEFINED;
+
+    pc->fd = fd;
+    pc->write = write;
+    pc->lc = lc;
+
+    slot->pollfd[write] = js_function_cclosure(lc->js, pollfd_handler, 0, 0, pc, free);
+  }
+
+  return slot->pollfd[write];
+}
+
+/* `os` backend: bring fd's quickjs-libc registrations in line with lws's
+   interest - a read handler while it wants POLLIN, a write handler while
+   it wants POLLOUT - touching only the direction(s) that actually
+   changed. */
+static int
+pollfd_update(LWSContext* lc, int fd, int events) {
+  LWSFdSlot* slot;
+
+  if(!events) {
+    if(fd >= 0 && fd < lc->nfds)
+      lc->fds[fd].events = 0;
+
+    iohandler_clear(lc, fd);
+    return 0;
+  }
+
+  if(!(slot = iohandler_slot(lc, fd)))
+    return -1;
+
+  slot->events = events;
+
+  for(int write = 0; write < 2; write++) {
+    BOOL want = !!(events & (write ? POLLOUT : POLLIN));
+    BOOL have = !!(slot->handlers & (write ? IOHANDLER_WRITE : IOHANDLER_READ));
+
+    if(want == have)
+      continue;
+
+    /* iohandler_set() may grow lc->fds, moving slot. */
+    iohandler_set(lc, fd, want ? pollfd_closure(lc, slot, fd, write) : JS_NULL, write);
+    slot = &lc->fds[fd];
+  }
+
+  return 0;
+}
+
 static JSValue
 callback_c(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic, void* closure) {
   const struct lws_protocols* proto = closure;
@@ -313,6 +376,7 @@ lwsjs_protocol_from(JSContext* ctx, JSValueConst obj, struct lws_protocols* pro)
   handlers->ctx = ctx;
   handlers->callback = value;
   handlers->obj = obj_ptr(ctx, obj);
+  handlers->router = JS_UNDEFINED;
 
   pro->callback = lwsjs_callback_protocol;
   pro->user = handlers;
@@ -330,6 +394,13 @@ lwsjs_protocol_from(JSContext* ctx, JSValueConst obj, struct lws_protocols* pro)
   value = is_array ? JS_GetPropertyUint32(ctx, obj, 4) : js_get_property(ctx, obj, "tx_packet_size");
   pro->tx_packet_size = to_uint32free(ctx, value);
 
+  if(!is_array) {
+    handlers->zero_copy_rx = to_boolfree(ctx, js_get_property(ctx, obj, "zero_copy_rx"));
+    handlers->reassemble = to_boolfree(ctx, js_get_property(ctx, obj, "reassemble"));
+    handlers->max_message_size = to_uint32free_default(ctx, js_get_property(ctx, obj, "max_message_size"), MAX_MESSAGE_SIZE_DEFAULT);
+    handlers->router = JS_GetPropertyStr(ctx, obj, "router");
+  }
+
   return 0;
 }
 
@@ -339,6 +410,7 @@ lwsjs_protocol_free(JSRuntime* rt, struct lws_protocols* pro) {
 
   if(handlers) {
     JS_FreeValueRT(rt, handlers->callback);
+    JS_FreeValueRT(rt, handlers->router);
 
     if(handlers->obj)
       obj_free(rt, handlers->obj);
@@ -498,10 +570,7 @@ lwsjs_callback_js(struct lws* wsi, enum lws_callback_reasons reason, void* user,
 
 int
 lwsjs_callback_pollfd(struct lws* wsi, enum lws_callback_reasons reason, void* user, void* in, size_t len) {
-  struct lws_protocols const* pro = wsi ? lws_get_protocol(wsi) : NULL;
-  LWSHandlers* handlers = pro ? pro->user : NULL;
   LWSContext* lws = lwsjs_wsi_context(wsi);
-  JSContext* ctx = handlers && handlers->ctx ? handlers->ctx : lwsjs_context_jsctx(lws);
 
   switch(reason) {
     case LWS_CALLBACK_LOCK_POLL:
@@ -513,11 +582,20 @@ lwsjs_callback_pollfd(struct lws* wsi, enum lws_callback_reasons reason, void* u
       struct lws_pollargs* x = in;
 
 #ifdef USE_EPOLL
-      lws_epoll_del(lws, x->fd);
-#else
-      iohandler_set(lws, x->fd, JS_NULL, 0);
-      iohandler_set(lws, x->fd, JS_NULL, 1);
+      if(lws && lws->poll_backend == POLL_BACKEND_EPOLL) {
+        lws_epoll_del(lws, x->fd);
+        return 0;
+      }
+#endif
+#ifdef USE_IO_URING
+      if(lws && lws->poll_backend == POLL_BACKEND_IO_URING) {
+        lws_uring_del(lws, x->fd);
+        return 0;
+      }
 #endif
+      if(lws)
+        pollfd_update(lws, x->fd, 0);
+
       return 0;
     }
 
@@ -529,29 +607,19 @@ lwsjs_callback_pollfd(struct lws* wsi, enum lws_callback_reasons reason, void* u
         return 0;
 
 #ifdef USE_EPOLL
-      lws_epoll_ctl(lws, x->fd, x->events);
-#else
-      BOOL write = !!(x->events & POLLOUT);
-      LWSPollfdClosure* pc;
-
-      if(!(pc = malloc(sizeof(LWSPollfdClosure))))
-        return -1;
-
-      pc->fd = x->fd;
-      pc->events = x->events;
-      pc->write = write;
-      pc->lws = lws_get_context(wsi);
-
-      JSValue fn = js_function_cclosure(ctx, pollfd_handler, 0, 0, pc, free);
-
-      if(reason == LWS_CALLBACK_CHANGE_MODE_POLL_FD)
-        iohandler_set(lws, x->fd, JS_NULL, !write);
-
-      iohandler_set(lws, x->fd, fn, write);
-
-      JS_FreeValue(ctx, fn);
+      if(lws && lws->poll_backend == POLL_BACKEND_EPOLL) {
+        lws_epoll_ctl(lws, x->fd, x->events);
+        return 0;
+      }
 #endif
-      return 0;
+#ifdef USE_IO_URING
+      if(lws && lws->poll_backend == POLL_BACKEND_IO_URING) {
+        lws_uring_ctl(lws, x->fd, x->events);
+        return 0;
+      }
+#endif
+
+      return lws ? pollfd_update(lws, x->fd, x->events) : -1;
     }
 
     default: break;
@@ -589,24 +657,19 @@ lwsjs_register_pipe_fds(LWSContext* lws) {
       continue;
 
 #ifdef USE_EPOLL
-    lws_epoll_ctl(lws, fd, POLLIN);
-#else
-    {
-      LWSPollfdClosure* pc;
-
-      if(!(pc = malloc(sizeof(LWSPollfdClosure))))
-        continue;
-
-      pc->fd = fd;
-      pc->events = POLLIN;
-      pc->write = FALSE;
-      pc->lws = lws->ctx;
-
-      JSValue fn = js_function_cclosure(lws->js, pollfd_handler, 0, 0, pc, free);
-      iohandler_set(lws, fd, fn, FALSE);
-      JS_FreeValue(lws->js, fn);
+    if(lws->poll_backend == POLL_BACKEND_EPOLL) {
+      lws_epoll_ctl(lws, fd, POLLIN);
+      continue;
     }
 #endif
+#ifdef USE_IO_URING
+    if(lws->poll_backend == POLL_BACKEND_IO_URING) {
+      lws_uring_ctl(lws, fd, POLLIN);
+      continue;
+    }
+#endif
+
+    pollfd_update(lws, fd, POLLIN);
   }
 }
 
@@ -627,13 +690,70 @@ lwsjs_unregister_pipe_fds(LWSContext* lws) {
       continue;
 
 #ifdef USE_EPOLL
-    lws_epoll_del(lws, fd);
-#else
-    iohandler_set(lws, fd, JS_NULL, FALSE);
+    if(lws->poll_backend == POLL_BACKEND_EPOLL) {
+      lws_epoll_del(lws, fd);
+      continue;
+    }
+#endif
+#ifdef USE_IO_URING
+    if(lws->poll_backend == POLL_BACKEND_IO_URING) {
+      lws_uring_del(lws, fd);
+      continue;
+    }
 #endif
+    pollfd_update(lws, fd, 0);
   }
 }
 
+/* Reassembles fragmented WS messages for protocols with the `reassemble`
+   option. Fragments before the final one are only appended to the
+   socket's message buffer, with no JS call at all (returns 1); the final
+   one swaps in/len for the whole message and sets *complete. Returns -1
+   when the message outgrows max_message_size: the peer is told 1009
+   (Message Too Big), stashed like a local .close() would
+   (lwsjs_socket_close(), lws-socket.c) so onClosed() reports it too. */
+static int
+rx_reassemble(JSContext* ctx, struct lws* wsi, LWSSocket* s, LWSHandlers* handlers, void** in, size_t* len, BOOL* complete) {
+  static const char reason[] = "message too big";
+  size_t max = handlers->max_message_size;
+
+  if(lws_is_first_fragment(wsi) && lws_is_final_fragment(wsi)) {
+    if(!max || *len <= max)
+      return 0;
+  } else if(!socket_rx_append(ctx, s, *in, *len, max)) {
+    if(!lws_is_final_fragment(wsi))
+      return 1;
+
+    *in = s->rx_msg;
+    *len = s->rx_msg_len;
+    *complete = TRUE;
+    return 0;
+  }
+
+  s->close_code = LWS_CLOSE_STATUS_MESSAGE_TOO_LARGE;
+  s->close_code_set = TRUE;
+
+  if(s->close_reason)
+    js_free(ctx, s->close_reason);
+
+  if((s->close_reason = js_malloc(ctx, sizeof(reason) - 1)))
+    memcpy(s->close_reason, reason, sizeof(reason) - 1);
+
+  s->close_reason_len = s->close_reason ? sizeof(reason) - 1 : 0;
+
+  lws_close_reason(wsi, LWS_CLOSE_STATUS_MESSAGE_TOO_LARGE, (uint8_t*)reason, sizeof(reason) - 1);
+  return -1;
+}
+
+/* A copy of len bytes of RX data at in, for JS to keep - its backing store
+   recycled through the context's RxBufferPool. */
+static JSValue
+rx_buffer(JSContext* ctx, struct lws* wsi, const void* in, size_t len) {
+  LWSContext* lc = lwsjs_wsi_context(wsi);
+
+  return rx_pool_buffer(ctx, lc ? lc->rx_pool : NULL, in, len);
+}
+
 int
 lwsjs_callback_protocol(struct lws* wsi, enum lws_callback_reasons reason, void* user, void* in, size_t len) {
   if(is_loadcerts_reason(reason))
@@ -737,6 +857,13 @@ lwsjs_callback_protocol(struct lws* wsi, enum lws_callback_reasons reason, void*
      so this is the right point to reset them back to "not yet derived"
      before the population logic below runs. */
   if(reason == LWS_CALLBACK_HTTP && s) {
+    /* The header table now holds the new request's headers. An LWSHeaders
+       from the previous transaction that is still attached (it ended
+       somewhere other than a queued LWS_WRITE_HTTP_FINAL) keeps what
+       wsi.headers had of it, if anything - never these. */
+    if(!list_empty(&s->live_headers))
+      lwsjs_headers_detach(ctx, s, FALSE);
+
     if(s->uri) {
       js_free(ctx, s->uri);
       s->uri = 0;
@@ -770,9 +897,20 @@ lwsjs_callback_protocol(struct lws* wsi, enum lws_callback_reasons reason, void*
     if(s)
       s->type = SOCKET_WS;
 
+  /* wsi.headers is only built when JS asks for it (PROP_HEADERS,
+     lws-socket.c), while lws still holds the header table - most handlers
+     read a couple of headers through wsi.header(), if any. The two WS
+     handshake reasons are the exception: lws drops the header table once
+     the upgrade is through, and WS handlers routinely look at the
+     handshake headers long after that (cookies, origin), so those get the
+     object up front, once per connection. */
   if(is_headers_reason(reason) || reason == LWS_CALLBACK_HTTP) {
-    if(s && is_nullish(s->headers))
-      s->headers = lwsjs_socket_headers(ctx, s->wsi, &s->proto);
+    if(s && is_nullish(s->headers)) {
+      if(reason == LWS_CALLBACK_FILTER_PROTOCOL_CONNECTION || reason == LWS_CALLBACK_CLIENT_FILTER_PRE_ESTABLISH)
+        s->headers = lwsjs_socket_headers(ctx, s->wsi, &s->proto);
+      else if(!s->proto)
+        lwsjs_socket_proto(ctx, s->wsi, &s->proto);
+    }
 
     if(s && (s->uri == 0 || s->method == -1)) {
       char* uri = 0;
@@ -786,6 +924,60 @@ lwsjs_callback_protocol(struct lws* wsi, enum lws_callback_reasons reason, void*
     }
   }
 
+  /* The `router` protocol option: a GET or HEAD whose route has a static
+     response is answered right here - the protocol's JS callback never
+     hears of it. The router's timeout stands in for what that callback
+     would have armed (serve()'s server.timeout()); nothing else of it
+     runs. */
+  if(reason == LWS_CALLBACK_HTTP && s && s->uri && handlers && (s->method == LWSHUMETH_GET || s->method == LWSHUMETH_HEAD)) {
+    JSValue response = lwsjs_router_response(handlers->router, s->uri, strlen(s->uri));
+
+    if(!JS_IsUndefined(response)) {
+      uint32_t secs;
+
+      if((secs = lwsjs_router_timeout(handlers->router))) {
+        lws_set_timeout(wsi, PENDING_TIMEOUT_USER_OK, secs);
+
+        if(lws)
+          lwsjs_service_arm(lws);
+      }
+
+      if(socket_respond_static(s, response, s->method == LWSHUMETH_HEAD))
+        ret = -1;
+
+      cb = NULL;
+    }
+  }
+
+  BOOL reassembled = FALSE;
+
+  if(s && handlers && handlers->reassemble && (reason == LWS_CALLBACK_RECEIVE || reason == LWS_CALLBACK_CLIENT_RECEIVE)) {
+    int r = rx_reassemble(ctx, wsi, s, handlers, &in, &len, &reassembled);
+
+    if(r > 0)
+      goto end;
+
+    if(r < 0) {
+      ret = -1;
+      cb = NULL;
+    }
+  }
+
+  /* wsi.splice(): RX goes to the other socket's write queue, JS never
+     sees it. After rx_reassemble() above, so a WS message is passed on
+     whole. */
+  if(s && s->splice_to && in && (reason == LWS_CALLBACK_RAW_RX || reason == LWS_CALLBACK_RECEIVE || reason == LWS_CALLBACK_CLIENT_RECEIVE)) {
+    if(socket_splice_rx(s, in, len, reason != LWS_CALLBACK_RAW_RX && !lws_frame_is_binary(wsi), JS_GetRuntime(ctx)))
+      ret = -1;
+
+    cb = NULL;
+  }
+
+  /* Either end of a splice closing ends it - and closes the other end, as
+     pipeTo() would. The JS close handler still runs below. */
+  if(s && (s->splice_to || s->splice_from) && is_closed_reason(reason))
+    socket_unsplice(s, JS_GetRuntime(ctx));
+
   if(cb && !is_nullish(*cb)) {
     int i = 1, buffer_index = -1;
     JSValue argv[5] = {
@@ -961,7 +1153,11 @@ lwsjs_callback_protocol(struct lws* wsi, enum lws_callback_reasons reason, void*
         case LWS_CALLBACK_RAW_RX: {
           const struct lws_udp* udp;
 
-          argv[i++] = in ? JS_NewArrayBufferCopy(ctx, in, len) : JS_NULL;
+          if(in && handlers->zero_copy_rx)
+            argv[buffer_index = i++] = JS_NewArrayBuffer(ctx, (uint8_t*)in, len, 0, 0, FALSE);
+          else
+            argv[i++] = in ? rx_buffer(ctx, wsi, in, len) : JS_NULL;
+
           argv[i++] = JS_NewInt64(ctx, len);
 
           /* A UDP listener wsi fields datagrams from many different peers on
@@ -983,10 +1179,25 @@ lwsjs_callback_protocol(struct lws* wsi, enum lws_callback_reasons reason, void*
 #endif
 
         default: {
-          if(in && (len > 0) && reason != LWS_CALLBACK_FILTER_HTTP_CONNECTION && reason != LWS_CALLBACK_CLIENT_CONNECTION_ERROR) {
+          if(reassembled) {
+            argv[i++] = socket_rx_take(ctx, s, lws_frame_is_binary(wsi));
+            argv[i++] = JS_NewInt64(ctx, len);
+          } else if(in && (len > 0) && reason != LWS_CALLBACK_FILTER_HTTP_CONNECTION && reason != LWS_CALLBACK_CLIENT_CONNECTION_ERROR) {
             BOOL is_ws = reason == LWS_CALLBACK_CLIENT_RECEIVE || reason == LWS_CALLBACK_RECEIVE;
 
-            argv[i++] = in ? ((!is_ws || lws_frame_is_binary(wsi))) ? JS_NewArrayBufferCopy(ctx, in, len) : JS_NewStringLen(ctx, in, len) : JS_NULL;
+            /* With zero_copy_rx the buffer aliases lws's rx buffer (pt_serv_buf
+               for raw/http, the wsi's rx_ubuf for ws), which is only valid
+               until we return - it gets detached below along with the other
+               buffer_index case, so JS that wants to keep the bytes has to
+               .slice() them. WS text still becomes a string, which is a copy
+               either way. */
+            if(is_ws && !lws_frame_is_binary(wsi))
+              argv[i++] = JS_NewStringLen(ctx, in, len);
+            else if(handlers->zero_copy_rx)
+              argv[buffer_index = i++] = JS_NewArrayBuffer(ctx, (uint8_t*)in, len, 0, 0, FALSE);
+            else
+              argv[i++] = rx_buffer(ctx, wsi, in, len);
+
             argv[i++] = JS_NewInt64(ctx, len);
 
             /* lws_is_first_fragment()/lws_is_final_fragment() are receive-side
@@ -1062,6 +1273,13 @@ lwsjs_callback_protocol(struct lws* wsi, enum lws_callback_reasons reason, void*
     ret = to_int32free(ctx, result);
   }
 
+  /* Nobody took the reassembled message (no handler for this reason). */
+  if(reassembled && s->rx_msg) {
+    js_free(ctx, s->rx_msg);
+    s->rx_msg = NULL;
+    s->rx_msg_len = s->rx_msg_size = 0;
+  }
+
   if(s && s->closed)
     ret = -1;
 
@@ -5,6 +5,10 @@
 #include <libwebsockets.h>
 #include "lws-context.h"
 
+/* Largest WS message a `reassemble` protocol accepts when it doesn't set
+   `max_message_size` itself. */
+#define MAX_MESSAGE_SIZE_DEFAULT (16 * 1024 * 1024)
+
 int lwsjs_callback_find(const char*);
 const char* lwsjs_callback_name(enum lws_callback_reasons);
 JSValue lwsjs_protocol_obj(JSContext*, const struct lws_protocols*);
@@ -0,0 +1,277 @@
+#include "js-utils.h"
+#include "lws.h"
+#include "router.h"
+#include "lws-socket.h"
+#include <cutils.h>
+
+JSClassID lwsjs_router_class_id;
+static JSValue lwsjs_router_proto, lwsjs_router_ctor;
+
+/* Path router over compilePath()-style patterns (lib/lws/app.js): the
+   radix tree in router.h, which App/Router and serve()'s routes match
+   against instead of trying one regex per route. It only knows patterns
+   by index - what a match leads to (a Layer, a route entry) stays in a JS
+   array next to it - apart from a static response (setResponse()), which
+   a protocol with this as its `router` sends without calling JS at all
+   (lwsjs_router_response() below, lwsjs_callback_protocol()). */
+typedef struct {
+  Router tree;
+  JSValue* responses; /* by route index, JS_UNDEFINED where there's none */
+  uint32_t nresponses;
+  uint32_t timeout; /* seconds of idle timeout set before a static response, 0 = none */
+} LWSRouter;
+
+enum {
+  METHOD_ADD = 0,
+  METHOD_MATCH,
+  METHOD_SET_RESPONSE,
+};
+
+enum {
+  PROP_SIZE = 0,
+  PROP_TIMEOUT,
+};
+
+static inline LWSRouter*
+lwsjs_router_data2(JSContext* ctx, JSValueConst value) {
+  return JS_GetOpaque2(ctx, value, lwsjs_router_class_id);
+}
+
+static JSValue
+lwsjs_router_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  LWSRouter* r;
+
+  if(!(r = js_mallocz(ctx, sizeof(LWSRouter))))
+    return JS_EXCEPTION;
+
+  /* using new_target to get the prototype is necessary when the class is extended. */
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    proto = JS_DupValue(ctx, lwsjs_router_proto);
+
+  JSValue obj = JS_NewObjectProtoClass(ctx, proto, lwsjs_router_class_id);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj)) {
+    js_free(ctx, r);
+    return JS_EXCEPTION;
+  }
+
+  JS_SetOpaque(obj, r);
+  return obj;
+}
+
+static JSValue
+lwsjs_router_methods(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  LWSRouter* r;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(r = lwsjs_router_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case METHOD_ADD: {
+      BOOL end = argc > 1 && !JS_IsUndefined(argv[1]) ? JS_ToBool(ctx, argv[1]) : TRUE;
+      const char* pattern;
+      size_t len;
+      int64_t index;
+
+      if(!(pattern = JS_ToCStringLen(ctx, &len, argv[0])))
+        return JS_EXCEPTION;
+
+      index = router_add(&r->tree, pattern, len, end);
+      JS_FreeCString(ctx, pattern);
+
+      if(index < 0)
+        return JS_ThrowRangeError(ctx, "cannot add route (out of memory, or more than %d :params)", ROUTER_MAX_PARAMS);
+
+      ret = JS_NewInt64(ctx, index);
+      break;
+    }
+
+    case METHOD_MATCH: {
+      RouterSpan caps[ROUTER_MAX_PARAMS];
+      uint32_t from = 0, index, ncaps;
+      const char* path;
+      size_t len;
+
+      if(argc > 1 && JS_ToUint32(ctx, &from, argv[1]))
+        return JS_EXCEPTION;
+
+      if(!(path = JS_ToCStringLen(ctx, &len, argv[0])))
+        return JS_EXCEPTION;
+
+      /* [index, ...params]: one array, rather than an object holding one. */
+      if((index = router_match(&r->tree, path, len, from, caps, &ncaps)) == ROUTER_NONE) {
+        ret = JS_NULL;
+      } else {
+        ret = JS_NewArray(ctx);
+        JS_SetPropertyUint32(ctx, ret, 0, JS_NewUint32(ctx, index));
+
+        for(uint32_t i = 0; i < ncaps; i++)
+          JS_SetPropertyUint32(ctx, ret, i + 1, JS_NewStringLen(ctx, caps[i].ptr, caps[i].len));
+      }
+
+      JS_FreeCString(ctx, path);
+      break;
+    }
+
+    case METHOD_SET_RESPONSE: {
+      uint32_t index;
+
+      if(JS_ToUint32(ctx, &index, argv[0]))
+        return JS_EXCEPTION;
+
+      if(index >= r->tree.count)
+        return JS_ThrowRangeError(ctx, "no route %u", index);
+
+      if(!is_nullish(argv[1]) && !JS_GetOpaque(argv[1], lwsjs_static_response_class_id))
+        return JS_ThrowTypeError(ctx, "argument 2 must be an LWSStaticResponse or null");
+
+      if(index >= r->nresponses) {
+        JSValue* responses;
+
+        if(!(responses = js_realloc(ctx, r->responses, r->tree.count * sizeof(JSValue))))
+          return JS_EXCEPTION;
+
+        while(r->nresponses < r->tree.count)
+          responses[r->nresponses++] = JS_UNDEFINED;
+
+        r->responses = responses;
+      }
+
+      JS_FreeValue(ctx, r->responses[index]);
+      r->responses[index] = is_nullish(argv[1]) ? JS_UNDEFINED : JS_DupValue(ctx, argv[1]);
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static JSValue
+lwsjs_router_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  LWSRouter* r;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(r = lwsjs_router_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case PROP_SIZE: {
+      ret = JS_NewUint32(ctx, r->tree.count);
+      break;
+    }
+
+    case PROP_TIMEOUT: {
+      ret = JS_NewUint32(ctx, r->timeout);
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static JSValue
+lwsjs_router_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
+  LWSRouter* r;
+  int32_t secs;
+
+  if(!(r = lwsjs_router_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case PROP_TIMEOUT: {
+      if(JS_ToInt32(ctx, &secs, value))
+        return JS_EXCEPTION;
+
+      r->timeout = secs > 0 ? secs : 0;
+      break;
+    }
+  }
+
+  return JS_UNDEFINED;
+}
+
+/* The static response of the route matching path (the lowest-indexed
+   one, like match()), or JS_UNDEFINED - also when router isn't an
+   LWSRouter at all. Not a new reference. */
+JSValue
+lwsjs_router_response(JSValueConst router, const char* path, size_t len) {
+  RouterSpan caps[ROUTER_MAX_PARAMS];
+  uint32_t index, ncaps;
+  LWSRouter* r;
+
+  if(!(r = JS_GetOpaque(router, lwsjs_router_class_id)) || !r->nresponses)
+    return JS_UNDEFINED;
+
+  if((index = router_match(&r->tree, path, len, 0, caps, &ncaps)) >= r->nresponses)
+    return JS_UNDEFINED;
+
+  return r->responses[index];
+}
+
+/* The idle timeout (seconds, 0 = none) to arm on a connection before
+   sending it one of router's static responses - what serve()'s
+   server.timeout() applies to every request that reaches JS. */
+uint32_t
+lwsjs_router_timeout(JSValueConst router) {
+  LWSRouter* r;
+
+  return (r = JS_GetOpaque(router, lwsjs_router_class_id)) ? r->timeout : 0;
+}
+
+static void
+lwsjs_router_finalizer(JSRuntime* rt, JSValue val) {
+  LWSRouter* r;
+
+  if((r = JS_GetOpaque(val, lwsjs_router_class_id))) {
+    for(uint32_t i = 0; i < r->nresponses; i++)
+      JS_FreeValueRT(rt, r->responses[i]);
+
+    js_free_rt(rt, r->responses);
+    router_free(&r->tree);
+    js_free_rt(rt, r);
+  }
+}
+
+static void
+lwsjs_router_mark(JSRuntime* rt, JSValueConst val, JS_MarkFunc* mark_func) {
+  LWSRouter* r;
+
+  if((r = JS_GetOpaque(val, lwsjs_router_class_id)))
+    for(uint32_t i = 0; i < r->nresponses; i++)
+      JS_MarkValue(rt, r->responses[i], mark_func);
+}
+
+static const JSClassDef lws_router_class = {
+    "LWSRouter",
+    .finalizer = lwsjs_router_finalizer,
+    .gc_mark = lwsjs_router_mark,
+};
+
+static const JSCFunctionListEntry lws_router_proto_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("add", 1, lwsjs_router_methods, METHOD_ADD),
+    JS_CFUNC_MAGIC_DEF("match", 1, lwsjs_router_methods, METHOD_MATCH),
+    JS_CFUNC_MAGIC_DEF("setResponse", 2, lwsjs_router_methods, METHOD_SET_RESPONSE),
+    JS_CGETSET_MAGIC_DEF("size", lwsjs_router_get, 0, PROP_SIZE),
+    JS_CGETSET_MAGIC_DEF("timeout", lwsjs_router_get, lwsjs_router_set, PROP_TIMEOUT),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "LWSRouter", JS_PROP_CONFIGURABLE),
+};
+
+int
+lwsjs_router_init(JSContext* ctx, JSModuleDef* m) {
+  JS_NewClassID(&lwsjs_router_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), lwsjs_router_class_id, &lws_router_class);
+
+  lwsjs_router_proto = JS_NewObjectProto(ctx, JS_NULL);
+  JS_SetPropertyFunctionList(ctx, lwsjs_router_proto, lws_router_proto_funcs, countof(lws_router_proto_funcs));
+
+  lwsjs_router_ctor = JS_NewCFunction2(ctx, lwsjs_router_constructor, "LWSRouter", 0, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, lwsjs_router_ctor, lwsjs_router_proto);
+
+  if(m) {
+    JS_SetModuleExport(ctx, m, "LWSRouter", lwsjs_router_ctor);
+  }
+
+  return 0;
+}
@@ -0,0 +1,149 @@
+#include "lws-rxpool.h"
+#include <string.h>
+
+/* Backing-store capacities of the RxBufferPool size classes. lws hands RX
+   data over in chunks of at most the protocol's rx_buffer_size (or the
+   context's pt_serv_buf_size for raw/http), so nearly everything lands in
+   the middle classes; anything past the last one is copied into an
+   exact-size ArrayBuffer the usual way and never pooled. The smallest
+   class keeps a short message from pinning a whole kilobyte. */
+static const size_t rx_pool_sizes[RX_POOL_CLASSES] = {256, 1024, 4096, 16384, 65536};
+
+/* Header in front of every pooled backing store. The ArrayBuffer only sees
+   the bytes after it, and gets them back in rx_pool_release() as ptr. */
+typedef union RxBlock {
+  struct {
+    union RxBlock* next;
+    int cls;
+  } h;
+  max_align_t align;
+} RxBlock;
+
+/* Freelists of spare backing stores, one per size class. Reference
+   counted like WriteChunkPool (lws-socket.c): the LWSContext holds one
+   reference and every live pooled ArrayBuffer another, since JS can keep
+   RX buffers around long after the context that received them has been
+   destroyed - they still have to find their way back here when the GC
+   finally collects them. Backing stores, spare or not, come from rt's
+   allocator, so the GC sees them in its malloc accounting just like the
+   bytes of an ArrayBuffer it had allocated itself. */
+struct RxBufferPool {
+  int ref_count;
+  JSRuntime* rt;
+  RxBlock* free[RX_POOL_CLASSES];
+  uint32_t spare[RX_POOL_CLASSES], max_spare;
+  size_t retained, max_retained;
+  uint64_t hits, misses, outstanding;
+};
+
+RxBufferPool*
+rx_pool_new(JSRuntime* rt, size_t max_retained, uint32_t max_spare) {
+  RxBufferPool* pool;
+
+  if((pool = js_mallocz_rt(rt, sizeof(*pool)))) {
+    pool->ref_count = 1;
+    pool->rt = rt;
+    pool->max_retained = max_retained;
+    pool->max_spare = max_spare;
+  }
+
+  return pool;
+}
+
+void
+rx_pool_free(RxBufferPool* pool) {
+  if(pool && --pool->ref_count == 0) {
+    for(int i = 0; i < RX_POOL_CLASSES; i++)
+      while(pool->free[i]) {
+        RxBlock* blk = pool->free[i];
+
+        pool->free[i] = blk->h.next;
+        js_free_rt(pool->rt, blk);
+      }
+
+    js_free_rt(pool->rt, pool);
+  }
+}
+
+JSValue
+rx_pool_stats(JSContext* ctx, RxBufferPool* pool) {
+  JSValue ret = JS_NewObject(ctx);
+
+  JS_SetPropertyStr(ctx, ret, "hits", JS_NewInt64(ctx, pool ? pool->hits : 0));
+  JS_SetPropertyStr(ctx, ret, "misses", JS_NewInt64(ctx, pool ? pool->misses : 0));
+  JS_SetPropertyStr(ctx, ret, "outstanding", JS_NewInt64(ctx, pool ? pool->outstanding : 0));
+  JS_SetPropertyStr(ctx, ret, "retained", JS_NewInt64(ctx, pool ? pool->retained : 0));
+  JS_SetPropertyStr(ctx, ret, "maxRetained", JS_NewInt64(ctx, pool ? pool->max_retained : 0));
+  JS_SetPropertyStr(ctx, ret, "maxSpare", JS_NewUint32(ctx, pool ? pool->max_spare : 0));
+  return ret;
+}
+
+static int
+rx_pool_class(size_t len) {
+  for(int i = 0; i < RX_POOL_CLASSES; i++)
+    if(len <= rx_pool_sizes[i])
+      return i;
+
+  return -1;
+}
+
+/* JSFreeArrayBufferDataFunc of pooled ArrayBuffers: the backing store goes
+   back on its freelist if both caps allow, and the buffer's pool reference
+   is dropped. */
+static void
+rx_pool_release(JSRuntime* rt, void* opaque, void* ptr) {
+  RxBufferPool* pool = opaque;
+  RxBlock* blk = (RxBlock*)ptr - 1;
+  int cls = blk->h.cls;
+  size_t size = sizeof(RxBlock) + rx_pool_sizes[cls];
+
+  pool->outstanding--;
+
+  /* Once the context is gone (ref_count is only held by buffers now)
+     nothing will ever take blocks off the freelists again. */
+  if(pool->ref_count > 1 && pool->spare[cls] < pool->max_spare && pool->retained + size <= pool->max_retained) {
+    blk->h.next = pool->free[cls];
+    pool->free[cls] = blk;
+    pool->spare[cls]++;
+    pool->retained += size;
+  } else {
+    js_free_rt(rt, blk);
+  }
+
+  rx_pool_free(pool);
+}
+
+JSValue
+rx_pool_buffer(JSContext* ctx, RxBufferPool* pool, const void* data, size_t len) {
+  RxBlock* blk;
+  JSValue ret;
+  int cls;
+
+  if(!pool || pool->max_retained == 0 || (cls = rx_pool_class(len)) < 0)
+    return JS_NewArrayBufferCopy(ctx, data, len);
+
+  if((blk = pool->free[cls])) {
+    pool->free[cls] = blk->h.next;
+    pool->spare[cls]--;
+    pool->retained -= sizeof(RxBlock) + rx_pool_sizes[cls];
+    pool->hits++;
+  } else {
+    pool->misses++;
+
+    if(!(blk = js_malloc(ctx, sizeof(RxBlock) + rx_pool_sizes[cls])))
+      return JS_EXCEPTION;
+  }
+
+  blk->h.cls = cls;
+  memcpy(blk + 1, data, len);
+
+  ++pool->ref_count;
+  pool->outstanding++;
+
+  ret = JS_NewArrayBuffer(ctx, (uint8_t*)(blk + 1), len, rx_pool_release, pool, FALSE);
+
+  if(JS_IsException(ret))
+    rx_pool_release(JS_GetRuntime(ctx), pool, blk + 1);
+
+  return ret;
+}
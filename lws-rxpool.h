@@ -0,0 +1,25 @@
+#ifndef QJS_LWS_RXPOOL_H
+#define QJS_LWS_RXPOOL_H
+
+#include <quickjs.h>
+#include <stddef.h>
+
+/* Size classes of the per-LWSContext RX buffer freelist (lws-rxpool.c). */
+#define RX_POOL_CLASSES 5
+
+typedef struct RxBufferPool RxBufferPool;
+
+/* max_retained caps the bytes of spare backing stores kept for reuse (0
+   disables pooling), max_spare how many of them each size class holds.
+   Every backing store is allocated from rt, which every buffer the pool
+   hands out must belong to. */
+RxBufferPool* rx_pool_new(JSRuntime* rt, size_t max_retained, uint32_t max_spare);
+void rx_pool_free(RxBufferPool*);
+JSValue rx_pool_stats(JSContext*, RxBufferPool*);
+
+/* An ArrayBuffer holding a copy of len bytes at data - a drop-in for
+   JS_NewArrayBufferCopy() whose backing store comes from (and, once the
+   ArrayBuffer is collected, goes back to) pool. pool may be NULL. */
+JSValue rx_pool_buffer(JSContext*, RxBufferPool*, const void* data, size_t len);
+
+#endif /* defined QJS_LWS_RXPOOL_H */
@@ -4,8 +4,12 @@
 #include "lws-sockaddr46.h"
 #include "lws.h"
 #include "js-utils.h"
+#include "idtable.h"
 #include <assert.h>
 #include <sys/socket.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 #include "libwebsockets/lib/core/private-lib-core.h"
 
@@ -14,10 +18,26 @@ static JSValue lwsjs_socket_proto, lwsjs_socket_ctor;
 
 static struct list_head socket_list;
 static uint32_t socket_id;
+/* id -> LWSSocket for every socket on socket_list, so LWSSocket.get(id)
+   doesn't have to walk the list. */
+static IdTable socket_index;
 
 /* Per-write queue entry. The payload sits at buf + LWS_PRE so libwebsockets
-   has room to fill the WebSocket frame header in place. pos is how many
-   payload bytes have already been handed to lws_write(). */
+   has room to fill the WebSocket frame header in place; buf itself follows
+   the struct in the same allocation, sized by size class cls (see
+   WriteChunkPool below; -1 = exact-size, not poolable). pos is how many
+   payload bytes have already been handed to lws_write().
+
+   A "pinned" chunk (see write_chunk_pin()) has no buf of its own: it holds a
+   reference to the caller's ArrayBuffer instead, and the payload lives at
+   offset inside it. That only works because the view the caller passed
+   started at least LWS_PRE bytes into a buffer from LWSSocket.allocBuffer()
+   (see alloc_buffer_owned()), so there's headroom for lws to write the
+   frame header into right in front of the payload - but those bytes still
+   belong to the caller (a .subarray() further into the buffer has real
+   data there), so they're saved to scratch before each lws_write() and put
+   back right after. lws itself is done with them by then: a write it
+   couldn't send in full is copied to its own buflist. */
 typedef struct {
   struct list_head link;
   uint8_t* buf;
@@ -25,35 +45,278 @@ typedef struct {
   enum lws_write_protocol proto;
   lws_sockaddr46 addr;
   BOOL has_addr;
+  int cls;
+  JSContext* ctx;
+  JSValue buffer;
+  size_t offset;
+  uint8_t scratch[LWS_PRE];
 } WriteChunk;
 
+/* Payload capacities of the WriteChunkPool size classes. A copied chunk is
+   one allocation - the WriteChunk itself followed by LWS_PRE + capacity
+   bytes of buf - so a recycled one needs no malloc() at all. Anything bigger
+   than the last class (which is HTTP_WRITE_CHUNK_MAX, below) is allocated
+   at its exact size and never pooled: those are rare, and keeping e.g. a
+   1 MB body around on the off chance another one comes along isn't worth
+   the memory. */
+static const size_t write_pool_sizes[WRITE_POOL_CLASSES] = {256, 4096, 16384};
+
+/* Freelists of spare chunks, one per size class, shared by every socket
+   of one LWSContext. Reference counted rather than owned outright by the
+   LWSContext: a socket's JS wrapper can outlive the context (and with it,
+   still have chunks queued that it returns here when finalized), so each
+   socket that has written anything holds its own reference - see
+   lwsjs_socket_write(). */
+struct WriteChunkPool {
+  int ref_count;
+  struct list_head free[WRITE_POOL_CLASSES];
+  size_t retained, max_retained;
+  uint64_t hits, misses;
+  /* LWS_PRE + HTTP_WRITE_CHUNK_MAX bytes write_queue_coalesce() merges
+     small chunks into, allocated on first use. Per pool, so per context:
+     it's only live for one lws_write(), and a context's sockets are all
+     serviced on the one thread. */
+  uint8_t* coalesce_buf;
+};
+
+WriteChunkPool*
+write_pool_new(size_t max_retained) {
+  WriteChunkPool* pool;
+
+  if((pool = malloc(sizeof(*pool)))) {
+    pool->ref_count = 1;
+
+    for(int i = 0; i < WRITE_POOL_CLASSES; i++)
+      init_list_head(&pool->free[i]);
+
+    pool->retained = 0;
+    pool->max_retained = max_retained;
+    pool->hits = pool->misses = 0;
+    pool->coalesce_buf = NULL;
+  }
+
+  return pool;
+}
+
+WriteChunkPool*
+write_pool_dup(WriteChunkPool* pool) {
+  if(pool)
+    ++pool->ref_count;
+
+  return pool;
+}
+
+void
+write_pool_free(WriteChunkPool* pool) {
+  if(pool && --pool->ref_count == 0) {
+    for(int i = 0; i < WRITE_POOL_CLASSES; i++)
+      while(!list_empty(&pool->free[i])) {
+        WriteChunk* wc = list_entry(pool->free[i].next, WriteChunk, link);
+
+        list_del(&wc->link);
+        free(wc);
+      }
+
+    free(pool->coalesce_buf);
+    free(pool);
+  }
+}
+
+JSValue
+write_pool_stats(JSContext* ctx, WriteChunkPool* pool) {
+  JSValue ret = JS_NewObject(ctx);
+
+  JS_SetPropertyStr(ctx, ret, "hits", JS_NewInt64(ctx, pool ? pool->hits : 0));
+  JS_SetPropertyStr(ctx, ret, "misses", JS_NewInt64(ctx, pool ? pool->misses : 0));
+  JS_SetPropertyStr(ctx, ret, "retained", JS_NewInt64(ctx, pool ? pool->retained : 0));
+  JS_SetPropertyStr(ctx, ret, "maxRetained", JS_NewInt64(ctx, pool ? pool->max_retained : 0));
+  return ret;
+}
+
+static int
+write_pool_class(size_t len) {
+  for(int i = 0; i < WRITE_POOL_CLASSES; i++)
+    if(len <= write_pool_sizes[i])
+      return i;
+
+  return -1;
+}
+
 static WriteChunk*
-write_chunk_new(const void* data, size_t len, enum lws_write_protocol proto) {
-  WriteChunk* wc = malloc(sizeof(*wc));
+write_chunk_new(WriteChunkPool* pool, const void* data, size_t len, enum lws_write_protocol proto) {
+  int cls = write_pool_class(len);
+  WriteChunk* wc = NULL;
 
-  if(!wc)
+  if(pool && cls >= 0) {
+    if(!list_empty(&pool->free[cls])) {
+      wc = list_entry(pool->free[cls].next, WriteChunk, link);
+      list_del(&wc->link);
+      pool->retained -= sizeof(WriteChunk) + LWS_PRE + write_pool_sizes[cls];
+      pool->hits++;
+    } else {
+      pool->misses++;
+    }
+  }
+
+  if(!wc && !(wc = malloc(sizeof(*wc) + LWS_PRE + (cls >= 0 ? write_pool_sizes[cls] : len))))
     return NULL;
 
-  wc->buf = malloc(LWS_PRE + len);
+  wc->buf = (uint8_t*)(wc + 1);
 
-  if(!wc->buf) {
-    free(wc);
-    return NULL;
+  if(data && len)
+    memcpy(wc->buf + LWS_PRE, data, len);
+
+  wc->len = len;
+  wc->pos = 0;
+  wc->proto = proto;
+  wc->has_addr = FALSE;
+  wc->cls = cls;
+  wc->ctx = NULL;
+  wc->buffer = JS_UNDEFINED;
+  wc->offset = 0;
+  return wc;
+}
+
+/* The memory of every live LWSSocket.allocBuffer() ArrayBuffer, by
+   address: added when allocBuffer() makes one, removed by its free
+   function (alloc_buffer_free()). Open addressing with linear probing,
+   like IdTable (idtable.h), NULL marking a free slot and
+   ALLOC_BUFFER_GONE a removed one; rebuilt once live entries plus
+   tombstones pass 3/4 of the slots. */
+static struct {
+  const uint8_t** slots;
+  uint32_t size, count, used;
+} alloc_buffers;
+
+#define ALLOC_BUFFER_GONE ((const uint8_t*)1)
+
+static const uint8_t**
+alloc_buffers_slot(const uint8_t* base) {
+  uint32_t i = (uint32_t)(((uintptr_t)base >> 4) * 2654435769u) & (alloc_buffers.size - 1);
+
+  while(alloc_buffers.slots[i] && alloc_buffers.slots[i] != base)
+    i = (i + 1) & (alloc_buffers.size - 1);
+
+  return &alloc_buffers.slots[i];
+}
+
+static int
+alloc_buffers_add(const uint8_t* base) {
+  if(!alloc_buffers.slots || (alloc_buffers.used + 1) * 4 > alloc_buffers.size * 3) {
+    const uint8_t** old = alloc_buffers.slots;
+    uint32_t old_size = alloc_buffers.size, size = old_size ? old_size : 64;
+
+    while((alloc_buffers.count + 1) * 2 > size)
+      size *= 2;
+
+    if(!(alloc_buffers.slots = calloc(size, sizeof(*alloc_buffers.slots)))) {
+      alloc_buffers.slots = old;
+      return -1;
+    }
+
+    alloc_buffers.size = size;
+    alloc_buffers.used = alloc_buffers.count;
+
+    for(uint32_t i = 0; i < old_size; i++)
+      if(old[i] && old[i] != ALLOC_BUFFER_GONE)
+        *alloc_buffers_slot(old[i]) = old[i];
+
+    free(old);
   }
 
-  if(len)
-    memcpy(wc->buf + LWS_PRE, data, len);
+  *alloc_buffers_slot(base) = base;
+  alloc_buffers.used++;
+  alloc_buffers.count++;
+  return 0;
+}
+
+static void
+alloc_buffers_remove(const uint8_t* base) {
+  const uint8_t** slot;
+
+  if(alloc_buffers.slots && *(slot = alloc_buffers_slot(base))) {
+    *slot = ALLOC_BUFFER_GONE;
+    alloc_buffers.count--;
+  }
+}
+
+static void
+alloc_buffer_free(JSRuntime* rt, void* opaque, void* ptr) {
+  alloc_buffers_remove(ptr);
+  js_free_rt(rt, ptr);
+}
+
+/* Whether the size bytes at base are an allocBuffer() ArrayBuffer, whose
+   views wsi.write() may send by reference. Any other view is copied, even
+   one with LWS_PRE bytes of headroom: the caller never agreed to have its
+   memory aliased until the write is out, nor to have the bytes in front of
+   it used for the frame header. */
+static BOOL
+alloc_buffer_owned(const uint8_t* base, size_t size) {
+  return size >= LWS_PRE && alloc_buffers.slots && *alloc_buffers_slot(base) == base;
+}
+
+/* Zero-copy counterpart of write_chunk_new(): references len bytes at
+   offset inside the ArrayBuffer buffer instead of copying them. The caller
+   guarantees offset >= LWS_PRE, and that the buffer is one of ours - an
+   allocBuffer() one (alloc_buffer_owned()), or a compiled response body. */
+static WriteChunk*
+write_chunk_pin(JSContext* ctx, JSValueConst buffer, size_t offset, size_t len, enum lws_write_protocol proto) {
+  WriteChunk* wc = malloc(sizeof(*wc));
+
+  if(!wc)
+    return NULL;
 
+  wc->buf = NULL;
   wc->len = len;
   wc->pos = 0;
   wc->proto = proto;
   wc->has_addr = FALSE;
+  wc->cls = -1;
+  wc->ctx = ctx;
+  wc->buffer = JS_DupValue(ctx, buffer);
+  wc->offset = offset;
   return wc;
 }
 
+/* Payload start (i.e. what goes to lws_write(), with LWS_PRE writable bytes
+   in front of it). For a pinned chunk the ArrayBuffer is looked up again
+   every time rather than trusting a pointer taken at write() time - the
+   reference keeps it from being collected, but not from being detached
+   (e.g. .transfer()) while the chunk is still queued. NULL then. */
+static uint8_t*
+write_chunk_data(WriteChunk* wc) {
+  uint8_t* ptr;
+  size_t size;
+
+  if(wc->buf)
+    return wc->buf + LWS_PRE;
+
+  if(!(ptr = JS_GetArrayBuffer(wc->ctx, &size, wc->buffer))) {
+    JS_FreeValue(wc->ctx, JS_GetException(wc->ctx));
+    return NULL;
+  }
+
+  return wc->offset + wc->len <= size ? ptr + wc->offset : NULL;
+}
+
+/* Back onto pool's freelist if it has a size class and the pool is still
+   under its max_retained cap, otherwise really freed. */
 static void
-write_chunk_free(WriteChunk* wc) {
-  free(wc->buf);
+write_chunk_free(WriteChunkPool* pool, WriteChunk* wc) {
+  if(!wc->buf)
+    JS_FreeValueRT(JS_GetRuntime(wc->ctx), wc->buffer);
+
+  if(pool && wc->cls >= 0) {
+    size_t size = sizeof(WriteChunk) + LWS_PRE + write_pool_sizes[wc->cls];
+
+    if(pool->retained + size <= pool->max_retained) {
+      list_add(&wc->link, &pool->free[wc->cls]);
+      pool->retained += size;
+      return;
+    }
+  }
+
   free(wc);
 }
 
@@ -63,7 +326,7 @@ socket_write_queue_clear(LWSSocket* s) {
     WriteChunk* wc = list_entry(s->write_queue.next, WriteChunk, link);
 
     list_del(&wc->link);
-    write_chunk_free(wc);
+    write_chunk_free(s->write_pool, wc);
   }
 
   s->write_buffered = 0;
@@ -97,6 +360,191 @@ socket_write_queue_clear(LWSSocket* s) {
    check). */
 #define HTTP_WRITE_CHUNK_MAX 16384
 
+/* Gathers the unsent part of the head chunk wc (head, head_len bytes) and
+   as many of the chunks queued right behind it as fit into the write
+   pool's coalesce_buf, whose payload is returned in *out, so a response
+   built from many small wsi.write() calls goes out as one lws_write() -
+   one syscall, one TLS record - instead of one per call.
+   Only plain HTTP/raw body writes are merged: a WS message is its own
+   frame, and an LWS_WRITE_HTTP_FINAL chunk ends the transaction, so
+   nothing after it may ride along (though it can be the last piece
+   itself, in which case *wp becomes FINAL). Returns how many bytes of
+   the following chunks were appended and sets *chunks to how many of them
+   there were - a zero-length end() chunk adds no bytes but still counts,
+   since this write is then the one that carries its FINAL. */
+static size_t
+write_queue_coalesce(LWSSocket* s, WriteChunk* wc, const uint8_t* head, size_t head_len, enum lws_write_protocol* wp, size_t* chunks, uint8_t** out) {
+  size_t total = head_len;
+  struct list_head* el;
+  uint8_t* buf;
+
+  *chunks = 0;
+
+  if(wc->proto != LWS_WRITE_HTTP || wc->link.next == &s->write_queue || !s->write_pool)
+    return 0;
+
+  if(!(buf = s->write_pool->coalesce_buf) && !(buf = s->write_pool->coalesce_buf = malloc(LWS_PRE + HTTP_WRITE_CHUNK_MAX)))
+    return 0;
+
+  for(el = wc->link.next; el != &s->write_queue; el = el->next) {
+    WriteChunk* next = list_entry(el, WriteChunk, link);
+    const uint8_t* data;
+
+    if(next->proto != LWS_WRITE_HTTP && next->proto != LWS_WRITE_HTTP_FINAL)
+      break;
+
+    if(total + next->len > HTTP_WRITE_CHUNK_MAX || !(data = write_chunk_data(next)))
+      break;
+
+    if(*chunks == 0)
+      memcpy(buf + LWS_PRE, head, head_len);
+
+    memcpy(buf + LWS_PRE + total, data, next->len);
+    total += next->len;
+    *wp = next->proto;
+    ++*chunks;
+
+    if(next->proto == LWS_WRITE_HTTP_FINAL)
+      break;
+  }
+
+  if(*chunks)
+    *out = buf + LWS_PRE;
+
+  return total - head_len;
+}
+
+/* lws_http_transaction_completed(), but first gives the LWSHeaders still
+   reading from the wsi's header table a copy of their own: lws hands the
+   table back to its pool right there. */
+static int
+socket_transaction_completed(LWSSocket* s) {
+  LWSContext* lc;
+
+  if(!list_empty(&s->live_headers) && (lc = lwsjs_wsi_context(s->wsi)))
+    lwsjs_headers_detach(lc->js, s, TRUE);
+
+  return lws_http_transaction_completed(s->wsi);
+}
+
+/* Accounts n bytes of a coalesced lws_write() of the first count queued
+   chunks against them, head first, releasing every chunk that is now fully
+   sent - a zero-length one included, once the bytes before it are. */
+static void
+write_queue_consume(LWSSocket* s, size_t n, size_t count) {
+  while(count-- > 0 && !list_empty(&s->write_queue)) {
+    WriteChunk* wc = list_entry(s->write_queue.next, WriteChunk, link);
+    size_t take = MIN(n, wc->len - wc->pos);
+
+    wc->pos += take;
+    s->write_buffered -= take;
+    n -= take;
+
+    if(wc->pos < wc->len)
+      break;
+
+    if(wc->proto == LWS_WRITE_HTTP_FINAL && socket_transaction_completed(s))
+      s->completed = TRUE;
+
+    list_del(&wc->link);
+    write_chunk_free(s->write_pool, wc);
+  }
+}
+
+/* Appends one fragment of a WS message to s->rx_msg, growing it
+   geometrically so an n-byte message costs O(n) copying in total rather
+   than the O(n^2) of concatenating fragments in JS. Returns -1 if that
+   would take the message past max bytes (0 = no limit) or allocation
+   fails; the partial message is dropped then. */
+int
+socket_rx_append(JSContext* ctx, LWSSocket* s, const void* data, size_t len, size_t max) {
+  size_t need = s->rx_msg_len + len;
+
+  if(max && need > max)
+    goto fail;
+
+  if(need > s->rx_msg_size) {
+    size_t size = s->rx_msg_size ? s->rx_msg_size : 4096;
+    uint8_t* msg;
+
+    while(size < need)
+      size *= 2;
+
+    if(max && size > max)
+      size = max;
+
+    if(!(msg = js_realloc(ctx, s->rx_msg, size)))
+      goto fail;
+
+    s->rx_msg = msg;
+    s->rx_msg_size = size;
+  }
+
+  if(len)
+    memcpy(s->rx_msg + s->rx_msg_len, data, len);
+
+  s->rx_msg_len = need;
+  return 0;
+
+fail:
+  js_free(ctx, s->rx_msg);
+  s->rx_msg = NULL;
+  s->rx_msg_len = s->rx_msg_size = 0;
+  return -1;
+}
+
+static void
+socket_rx_free(JSRuntime* rt, void* opaque, void* ptr) {
+  js_free_rt(rt, ptr);
+}
+
+/* Hands the reassembled message over to JS and resets s->rx_msg for the
+   next one. A binary message becomes an ArrayBuffer that takes ownership of
+   the buffer as-is (no copy); text is decoded into a string. */
+JSValue
+socket_rx_take(JSContext* ctx, LWSSocket* s, BOOL binary) {
+  JSValue ret;
+
+  if(binary) {
+    ret = JS_NewArrayBuffer(ctx, s->rx_msg, s->rx_msg_len, socket_rx_free, NULL, FALSE);
+
+    if(JS_IsException(ret))
+      js_free(ctx, s->rx_msg);
+  } else {
+    ret = JS_NewStringLen(ctx, (const char*)s->rx_msg, s->rx_msg_len);
+    js_free(ctx, s->rx_msg);
+  }
+
+  s->rx_msg = NULL;
+  s->rx_msg_len = s->rx_msg_size = 0;
+  return ret;
+}
+
+/* Closes s from wherever we are, including from inside one of its own
+   callbacks - lws does it on its next service pass. A WS peer gets a
+   normal-closure close frame. */
+static void
+socket_close_async(LWSSocket* s) {
+  if(lwsi_role_ws(s->wsi))
+    lws_close_reason(s->wsi, LWS_CLOSE_STATUS_NORMAL, NULL, 0);
+
+  lws_wsi_close(s->wsi, LWS_TO_KILL_ASYNC);
+}
+
+/* s is a splice destination that has just written some of its queue out:
+   the source's RX, if socket_splice_rx() paused it, resumes once no more
+   than half the high-water mark is left queued - resuming right below it
+   would flip flow control on and off with every chunk. */
+static void
+socket_splice_drained(LWSSocket* s) {
+  LWSSocket* src = s->splice_from;
+
+  if(src->rx_paused && src->wsi && s->write_buffered <= src->splice_hwm / 2) {
+    src->rx_paused = FALSE;
+    lws_rx_flow_control(src->wsi, 1);
+  }
+}
+
 /* Drain as many queued chunks as libwebsockets is willing to accept. If any
    remain (partial write, or lws is currently holding a partial internally),
    re-arm the writeable callback so we get called back to try again. */
@@ -110,7 +558,7 @@ socket_flush(LWSSocket* s) {
       break;
 
     WriteChunk* wc = list_entry(s->write_queue.next, WriteChunk, link);
-    size_t remaining = wc->len - wc->pos;
+    size_t remaining = wc->len - wc->pos, merged = 0, chunks = 0;
     enum lws_write_protocol wp = wc->proto;
 
     /* See the "HTTP body writes have no such per-message-boundary concept"
@@ -138,11 +586,41 @@ socket_flush(LWSSocket* s) {
     }
 
     int n;
+    uint8_t *data, *ptr;
+
+    if(!(data = write_chunk_data(wc))) {
+      /* Pinned buffer was detached under us - nothing left to send. */
+      s->write_buffered -= wc->len - wc->pos;
+      list_del(&wc->link);
+      write_chunk_free(s->write_pool, wc);
+      continue;
+    }
+
+    ptr = data + wc->pos;
+
+    /* Every UDP write is its own datagram, so never merge those, and
+       nothing may ride along behind a head chunk this call only sends part
+       of. */
+    if(!is_ws_message && !lws_wsi_is_udp(s->wsi) && remaining == wc->len - wc->pos) {
+      merged = write_queue_coalesce(s, wc, ptr, remaining, &wp, &chunks, &ptr);
+
+      if(chunks)
+        remaining += merged;
+    }
+
     char preview[remaining + 1];
 
-    log_preview(preview, sizeof(preview), wc->buf + LWS_PRE + wc->pos, remaining);
+    log_preview(preview, sizeof(preview), ptr, remaining);
 
-    if((n = lws_write(s->wsi, wc->buf + LWS_PRE + wc->pos, remaining, wp)) < 0) {
+    if(!wc->buf && !chunks)
+      memcpy(wc->scratch, ptr - LWS_PRE, LWS_PRE);
+
+    n = lws_write(s->wsi, ptr, remaining, wp);
+
+    if(!wc->buf && !chunks)
+      memcpy(ptr - LWS_PRE, wc->scratch, LWS_PRE);
+
+    if(n < 0) {
       /* Connection is dead — drop everything so we don't keep re-arming. */
       socket_write_queue_clear(s);
       return;
@@ -171,6 +649,15 @@ socket_flush(LWSSocket* s) {
                     preview,
                     (size_t)n > sizeof(preview) - 1 ? "..." : "");
 
+    if(chunks) {
+      write_queue_consume(s, (size_t)n, chunks + 1);
+
+      if(n == 0)
+        break;
+
+      continue;
+    }
+
     /* A single lws_write() call for a WS text/binary message IS the whole
        message: if the OS can't take it all immediately, lws buffers the
        remainder itself and flushes it autonomously (see the "Truncated
@@ -187,11 +674,11 @@ socket_flush(LWSSocket* s) {
     s->write_buffered -= is_ws_message ? remaining : (size_t)n;
 
     if(wc->pos >= wc->len) {
-      if(wc->proto == LWS_WRITE_HTTP_FINAL && lws_http_transaction_completed(s->wsi))
+      if(wc->proto == LWS_WRITE_HTTP_FINAL && socket_transaction_completed(s))
         s->completed = TRUE;
 
       list_del(&wc->link);
-      write_chunk_free(wc);
+      write_chunk_free(s->write_pool, wc);
       continue;
     }
 
@@ -200,8 +687,16 @@ socket_flush(LWSSocket* s) {
       break;
   }
 
-  if(!list_empty(&s->write_queue))
+  if(!list_empty(&s->write_queue) || (s->close_drained && lws_partial_buffered(s->wsi))) {
     lws_callback_on_writable(s->wsi);
+  } else if(s->close_drained) {
+    /* close_drained stays set: until lws gets round to the close, the wsi
+       is still about and must not be spliced into. */
+    socket_close_async(s);
+  }
+
+  if(s->splice_from)
+    socket_splice_drained(s);
 }
 
 static const enum lws_token_indexes lwsjs_method_tokens[] = {
@@ -278,17 +773,24 @@ socket_alloc(JSContext* ctx) {
   assert(socket_list.next);
   assert(socket_list.prev);
 
+  sock->id = ++socket_id;
+
+  if(idtable_put(&socket_index, sock->id, sock)) {
+    js_free(ctx, sock);
+    return 0;
+  }
+
   list_add(&sock->link, &socket_list);
 
   sock->ref_count = 1;
   sock->headers = JS_UNDEFINED;
   sock->write_handler = JS_UNDEFINED;
-  sock->id = ++socket_id;
   sock->method = -1;
   sock->dispatching = FALSE;
   sock->dispatch_reason = -1;
 
   init_list_head(&sock->write_queue);
+  init_list_head(&sock->live_headers);
 
   return sock;
 }
@@ -317,21 +819,6 @@ socket_getid(struct lws* wsi) {
   return -1;
 }
 
-static LWSSocket*
-socket_find(struct lws* wsi) {
-  struct list_head* n;
-
-  list_for_each(n, &socket_list) {
-    LWSSocket* sock;
-
-    if((sock = list_entry(n, LWSSocket, link)))
-      if((uintptr_t)sock != (uintptr_t)-1 && sock->wsi == wsi)
-        return sock;
-  }
-
-  return 0;
-}
-
 LWSSocket*
 socket_get(struct lws* wsi) {
   void* obj;
@@ -344,19 +831,10 @@ socket_get(struct lws* wsi) {
 
 static LWSSocket*
 socket_get_by_id(int id) {
-  struct list_head* n;
-
-  list_for_each(n, &socket_list) {
-    LWSSocket* sock = list_entry(n, LWSSocket, link);
-
-    if(sock->id == id)
-      return sock;
-  }
-
-  return 0;
+  return idtable_get(&socket_index, (uint32_t)id);
 }
 
-static void
+void
 socket_free(LWSSocket* sock, JSRuntime* rt) {
   DEBUG("free LWSSocket: %p (ref_count = %d)", sock, sock->ref_count);
 
@@ -372,6 +850,14 @@ socket_free(LWSSocket* sock, JSRuntime* rt) {
     if(sock->write_queue.next)
       socket_write_queue_clear(sock);
 
+    write_pool_free(sock->write_pool);
+    sock->write_pool = 0;
+
+    if(sock->rx_msg) {
+      js_free_rt(rt, sock->rx_msg);
+      sock->rx_msg = 0;
+    }
+
     if(sock->uri) {
       js_free_rt(rt, sock->uri);
       sock->uri = 0;
@@ -406,8 +892,10 @@ socket_delete(LWSSocket* sock, JSRuntime* rt) {
   assert(socket_list.next);
   assert(socket_list.prev);
 
-  if(sock->link.next)
+  if(sock->link.next) {
     list_del(&sock->link);
+    idtable_remove(&socket_index, sock->id);
+  }
 
   DEBUG("delete LWSSocket: %p (wsi = %p, n = %d, ref_count = %d)", sock, sock->wsi, list_size(&socket_list), sock->ref_count);
 
@@ -484,6 +972,13 @@ lwsjs_socket_destroy(JSContext* ctx, struct lws* wsi) {
 
   if((sock = socket_get(wsi))) {
     assert(sock->wsi);
+
+    if(!list_empty(&sock->live_headers))
+      lwsjs_headers_detach(ctx, sock, TRUE);
+
+    if(sock->splice_to || sock->splice_from)
+      socket_unsplice(sock, JS_GetRuntime(ctx));
+
     sock->wsi = 0;
 
     socket_delete(sock, JS_GetRuntime(ctx));
@@ -521,96 +1016,344 @@ lwsjs_socket_get_or_create(JSContext* ctx, struct lws* wsi) {
   return ret;
 }
 
-typedef struct {
-  JSValue obj;
-  JSContext* ctx;
-  struct lws* wsi;
-} CustomHeaders;
+/* What building a headers object needs to know about every lws token,
+   worked out once by header_names_init() at module init: the length of
+   its lowercased name, and whether it is one of the HTTP/2 pseudo-headers
+   (":authority", ...), which have nothing before the colon and are only
+   flagged. len is 0 for the request-line tokens (is_uri()) and
+   WSI_TOKEN_HTTP, which never become properties. Indexed by
+   lws_token_indexes. Nothing here depends on a JSRuntime, so one table
+   serves them all. */
+static struct {
+  uint8_t len;
+  BOOL pseudo;
+} header_names[WSI_TOKEN_COUNT];
+
+/* Name -> token index, open-addressed on a hash of the lowercased name:
+   slot holds token + 1, 0 = empty. */
+#define HEADER_INDEX_SIZE 256
+static uint8_t header_index[HEADER_INDEX_SIZE];
+
+/* Atoms of recently seen custom (non-token) header names, most recently
+   used first - a busy server sees the same handful of X-* headers on
+   nearly every request. Names longer than name[] aren't cached. */
+#define CUSTOM_ATOMS 32
+
+/* The header-name atoms themselves, so that building a headers object is
+   a plain lws_hdr_copy() + property set per header - no
+   lws_token_to_string()/find_charset()/atom creation and freeing on every
+   request. Atoms belong to a JSRuntime, and a Worker or a second runtime
+   in the process has its own, so these hang off the LWSContext (interned
+   by header_atoms() on first use, released by header_atoms_free() when
+   the context is freed) rather than being process-wide. */
+struct HeaderAtoms {
+  JSAtom names[WSI_TOKEN_COUNT];
+  struct {
+    char name[48];
+    uint8_t len;
+    JSAtom atom;
+  } custom[CUSTOM_ATOMS];
+  int custom_count;
+};
 
-static void
-set_property(JSContext* ctx, JSValueConst obj, const char* name, int nlen, const char* value, int vlen) {
-  JSAtom prop = JS_NewAtomLen(ctx, name, nlen);
+static uint32_t
+header_hash(const char* name, size_t len) {
+  uint32_t h = 2166136261u;
 
-  JS_SetProperty(ctx, obj, prop, JS_NewStringLen(ctx, value, vlen));
-  JS_FreeAtom(ctx, prop);
+  for(size_t i = 0; i < len; i++)
+    h = (h ^ (uint8_t)tolower((unsigned char)name[i])) * 16777619u;
+
+  return h;
 }
 
 static void
-custom_headers_callback(const char* name, int nlen, void* opaque) {
-  CustomHeaders* ch = opaque;
-  int namelen = nlen, len = lws_hdr_custom_length(ch->wsi, name, nlen);
-  char buf[len + 1];
-  int i = 0, j, r = lws_hdr_custom_copy(ch->wsi, buf, len + 1, name, nlen);
+header_names_init(void) {
+  static BOOL done;
 
-  while((j = findb_charset(&name[i], nlen - i, ": ", 2)) < (nlen - i - 1)) {
-    int k = i + j;
+  if(done)
+    return;
 
-    while(name[k] == ':' || name[k] == ' ')
-      ++k;
+  done = TRUE;
 
-    int n = findb_charset(&name[k], nlen - k, "\r\n", 2);
-    int end = k + n;
+  for(int i = WSI_TOKEN_GET_URI; i < WSI_TOKEN_COUNT; i++) {
+    const char* name;
+    size_t len;
 
-    while(name[end] == '\r' || name[end] == '\n')
-      ++end;
+    if(is_uri(i) || i == WSI_TOKEN_HTTP || !(name = (const char*)lws_token_to_string(i)))
+      continue;
 
-    if(n < (nlen - k))
-      set_property(ch->ctx, ch->obj, &name[i], j, &name[k], n);
+    if((len = find_charset(name, ": ", 2)) == 0) {
+      header_names[i].pseudo = TRUE;
+      continue;
+    }
 
-    i = end;
+    header_names[i].len = len;
 
-    if(n >= (nlen - k))
-      break;
-  }
+    uint32_t h = header_hash(name, len);
+
+    while(header_index[h & (HEADER_INDEX_SIZE - 1)])
+      h++;
 
-  set_property(ch->ctx, ch->obj, &name[i], findb_charset(&name[i], nlen - i, ": ", 2), buf, r);
+    header_index[h & (HEADER_INDEX_SIZE - 1)] = i + 1;
+  }
 }
 
-JSValue
-lwsjs_socket_headers(JSContext* ctx, struct lws* wsi, char** pproto) {
-  JSValue ret = JS_NewObjectProto(ctx, JS_NULL);
+/* A new atom for token i's lowercased name. */
+static JSAtom
+header_name_atom(JSContext* ctx, int i) {
+  const char* name = (const char*)lws_token_to_string(i);
+  size_t len = header_names[i].len;
+  char lower[len];
 
-  for(int i = WSI_TOKEN_GET_URI; i < WSI_TOKEN_COUNT; i++) {
-    if(is_uri(i))
-      continue;
+  for(size_t j = 0; j < len; j++)
+    lower[j] = tolower((unsigned char)name[j]);
 
-    if(i == WSI_TOKEN_HTTP)
-      continue;
+  return JS_NewAtomLen(ctx, lower, len);
+}
 
+/* The atoms of the LWSContext wsi belongs to, interned the first time
+   they are needed. NULL if there is no context (or no memory): callers
+   then make each atom as they go. */
+static HeaderAtoms*
+header_atoms(JSContext* ctx, struct lws* wsi) {
+  LWSContext* lc;
+  HeaderAtoms* ha;
+
+  if(!(lc = lwsjs_wsi_context(wsi)))
+    return NULL;
+
+  if(!(ha = lc->header_atoms) && (ha = lc->header_atoms = js_mallocz(ctx, sizeof(HeaderAtoms))))
+    for(int i = WSI_TOKEN_GET_URI; i < WSI_TOKEN_COUNT; i++)
+      if(header_names[i].len)
+        ha->names[i] = header_name_atom(ctx, i);
+
+  return ha;
+}
+
+void
+header_atoms_free(JSRuntime* rt, HeaderAtoms* ha) {
+  if(!ha)
+    return;
+
+  for(int i = 0; i < WSI_TOKEN_COUNT; i++)
+    if(ha->names[i] != JS_ATOM_NULL)
+      JS_FreeAtomRT(rt, ha->names[i]);
+
+  for(int i = 0; i < ha->custom_count; i++)
+    JS_FreeAtomRT(rt, ha->custom[i].atom);
+
+  js_free_rt(rt, ha);
+}
+
+/* Atom for a custom header name (already lowercase - lws lowercases names
+   as it parses them), from ha's cache when there is one. Returns a new
+   reference either way, so callers free it like any other. */
+static JSAtom
+custom_atom(JSContext* ctx, HeaderAtoms* ha, const char* name, size_t len) {
+  int i;
+  JSAtom atom;
+
+  if(!ha || len > sizeof(ha->custom[0].name))
+    return JS_NewAtomLen(ctx, name, len);
+
+  for(i = 0; i < ha->custom_count; i++)
+    if(ha->custom[i].len == len && !memcmp(ha->custom[i].name, name, len))
+      break;
+
+  if(i < ha->custom_count) {
+    atom = ha->custom[i].atom;
+  } else {
+    atom = JS_NewAtomLen(ctx, name, len);
+
+    if(ha->custom_count < CUSTOM_ATOMS)
+      i = ha->custom_count++;
+    else
+      JS_FreeAtom(ctx, ha->custom[--i].atom);
+  }
+
+  /* Move to the front. */
+  memmove(&ha->custom[1], &ha->custom[0], i * sizeof(ha->custom[0]));
+  memcpy(ha->custom[0].name, name, len);
+  ha->custom[0].len = len;
+  ha->custom[0].atom = atom;
+
+  return JS_DupAtom(ctx, atom);
+}
+
+typedef struct {
+  JSValue obj;
+  JSContext* ctx;
+  struct lws* wsi;
+  HeaderAtoms* atoms;
+} CustomHeaders;
+
+static void
+set_property(JSContext* ctx, HeaderAtoms* ha, JSValueConst obj, const char* name, int nlen, const char* value, int vlen) {
+  JSAtom prop = custom_atom(ctx, ha, name, nlen);
+
+  JS_SetProperty(ctx, obj, prop, JS_NewStringLen(ctx, value, vlen));
+  JS_FreeAtom(ctx, prop);
+}
+
+static void
+custom_headers_callback(const char* name, int nlen, void* opaque) {
+  CustomHeaders* ch = opaque;
+  int namelen = nlen, len = lws_hdr_custom_length(ch->wsi, name, nlen);
+  char buf[len + 1];
+  int i = 0, j, r = lws_hdr_custom_copy(ch->wsi, buf, len + 1, name, nlen);
+
+  while((j = findb_charset(&name[i], nlen - i, ": ", 2)) < (nlen - i - 1)) {
+    int k = i + j;
+
+    while(name[k] == ':' || name[k] == ' ')
+      ++k;
+
+    int n = findb_charset(&name[k], nlen - k, "\r\n", 2);
+    int end = k + n;
+
+    while(name[end] == '\r' || name[end] == '\n')
+      ++end;
+
+    if(n < (nlen - k))
+      set_property(ch->ctx, ch->atoms, ch->obj, &name[i], j, &name[k], n);
+
+    i = end;
+
+    if(n >= (nlen - k))
+      break;
+  }
+
+  set_property(ch->ctx, ch->atoms, ch->obj, &name[i], findb_charset(&name[i], nlen - i, ": ", 2), buf, r);
+}
+
+JSValue
+lwsjs_socket_headers(JSContext* ctx, struct lws* wsi, char** pproto) {
+  JSValue ret = JS_NewObjectProto(ctx, JS_NULL);
+  HeaderAtoms* ha = header_atoms(ctx, wsi);
+
+  for(int i = WSI_TOKEN_GET_URI; i < WSI_TOKEN_COUNT; i++) {
     size_t len;
 
-    if((len = lws_hdr_total_length(wsi, i)) <= 0)
+    if(!header_names[i].len && !header_names[i].pseudo)
       continue;
 
-    const char* name;
-
-    if(!(name = (const char*)lws_token_to_string(i)))
+    if((len = lws_hdr_total_length(wsi, i)) <= 0)
       continue;
 
-    size_t namelen = find_charset(name, ": ", 2);
-    JSAtom prop = JS_NewAtomLen(ctx, name, namelen);
     char buf[len + 1];
     int r = lws_hdr_copy(wsi, buf, len + 1, i);
 
-    if(namelen == 0) {
+    if(header_names[i].pseudo) {
+      if(!pproto)
+        continue;
+
       if(*pproto)
         js_free(ctx, *pproto);
 
       *pproto = js_strndup(ctx, buf, r);
+    } else if(ha) {
+      JS_SetProperty(ctx, ret, ha->names[i], JS_NewStringLen(ctx, buf, r));
     } else {
+      JSAtom prop = header_name_atom(ctx, i);
+
       JS_SetProperty(ctx, ret, prop, JS_NewStringLen(ctx, buf, r));
+      JS_FreeAtom(ctx, prop);
     }
-
-    JS_FreeAtom(ctx, prop);
   }
 
-  CustomHeaders ch = {ret, ctx, wsi};
+  CustomHeaders ch = {ret, ctx, wsi, ha};
 
   lws_hdr_custom_name_foreach(wsi, custom_headers_callback, &ch);
 
   return ret;
 }
 
+/* Just the *pproto half of lwsjs_socket_headers(): the value of the
+   HTTP/2 pseudo-headers (":authority", ":scheme", ...). Cheap enough to
+   run on every transaction, unlike building the whole object - see
+   socket_headers_live(). */
+void
+lwsjs_socket_proto(JSContext* ctx, struct lws* wsi, char** pproto) {
+  for(int i = WSI_TOKEN_GET_URI; i < WSI_TOKEN_COUNT; i++) {
+    size_t len;
+
+    if(!header_names[i].pseudo || (len = lws_hdr_total_length(wsi, i)) <= 0)
+      continue;
+
+    char buf[len + 1];
+    int r = lws_hdr_copy(wsi, buf, len + 1, i);
+
+    if(*pproto)
+      js_free(ctx, *pproto);
+
+    *pproto = js_strndup(ctx, buf, r);
+  }
+}
+
+/* Whether lws still has the wsi's header table ("ah") attached. Only then do
+   lws_hdr_copy() and friends return anything: lws hands the ah back to its
+   pool when an HTTP transaction completes (or a WS upgrade finishes).
+   Until then wsi.headers/wsi.header() read straight from it and nothing is
+   copied up front. */
+static BOOL
+socket_headers_live(LWSSocket* s) {
+  return s->wsi && s->wsi->http.ah;
+}
+
+/* Token index of the header called name (len bytes, any case), or -1 for
+   anything lws doesn't know by name. */
+static int
+header_token(const char* name, size_t len) {
+  uint32_t h = header_hash(name, len);
+  int ti;
+
+  while((ti = header_index[h & (HEADER_INDEX_SIZE - 1)])) {
+    const char* tok = (const char*)lws_token_to_string(--ti);
+
+    if(header_names[ti].len == len && !strncasecmp(tok, name, len))
+      return ti;
+
+    h++;
+  }
+
+  return -1;
+}
+
+/* One header's value, looked up in the wsi's live header table (known
+   token or custom header), as a string; JS_NULL if it isn't there. */
+static JSValue
+socket_header_copy(JSContext* ctx, struct lws* wsi, const char* name, size_t len) {
+  int ti, n, r;
+
+  if((ti = header_token(name, len)) >= 0) {
+    if((n = lws_hdr_total_length(wsi, ti)) <= 0)
+      return JS_NULL;
+
+    char buf[n + 1];
+
+    r = lws_hdr_copy(wsi, buf, n + 1, ti);
+    return r < 0 ? JS_NULL : JS_NewStringLen(ctx, buf, r);
+  }
+
+  /* lws lowercases custom header names as it parses them, and keeps the
+     trailing colon. */
+  char key[len + 2];
+
+  for(size_t i = 0; i < len; i++)
+    key[i] = tolower((unsigned char)name[i]);
+
+  key[len] = ':';
+  key[len + 1] = '\0';
+
+  if((n = lws_hdr_custom_length(wsi, key, len + 1)) <= 0)
+    return JS_NULL;
+
+  char buf[n + 1];
+
+  r = lws_hdr_custom_copy(wsi, buf, n + 1, key, len + 1);
+  return r < 0 ? JS_NULL : JS_NewStringLen(ctx, buf, r);
+}
+
 static LWSSocket*
 lwsjs_socket_method_data(JSContext* ctx, JSValueConst this_val, const char* method) {
   LWSSocket* s;
@@ -626,95 +1369,710 @@ lwsjs_socket_method_data(JSContext* ctx, JSValueConst this_val, const char* meth
   return s;
 }
 
-static JSValue
-lwsjs_socket_want_write(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  LWSSocket* s;
-  JSValue ret = JS_UNDEFINED;
+/* One request/response header by name, case-insensitively, or JS_NULL.
+   Doesn't build the wsi.headers object - reads from it if that was already
+   built, from lws's header table otherwise. */
+JSValue
+socket_header(JSContext* ctx, LWSSocket* s, const char* name, size_t len) {
+  JSValue ret = JS_NULL;
+
+  if(JS_IsObject(s->headers)) {
+    char key[len + 1];
+
+    for(size_t i = 0; i < len; i++)
+      key[i] = tolower((unsigned char)name[i]);
+
+    key[len] = '\0';
+
+    if(JS_IsUndefined(ret = JS_GetPropertyStr(ctx, s->headers, key)))
+      ret = JS_NULL;
+  } else if(socket_headers_live(s)) {
+    ret = socket_header_copy(ctx, s->wsi, name, len);
+  }
+
+  return ret;
+}
+
+/* All of them, as a fresh object (same sources as socket_header()); empty
+   once neither is there any more. */
+JSValue
+socket_headers_copy(JSContext* ctx, LWSSocket* s) {
+  JSValue ret;
+
+  if(JS_IsObject(s->headers)) {
+    JSPropertyEnum* tab;
+    uint32_t len;
+
+    ret = JS_NewObjectProto(ctx, JS_NULL);
+
+    if(!JS_GetOwnPropertyNames(ctx, &tab, &len, s->headers, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY)) {
+      for(uint32_t i = 0; i < len; i++) {
+        JS_SetProperty(ctx, ret, tab[i].atom, JS_GetProperty(ctx, s->headers, tab[i].atom));
+        JS_FreeAtom(ctx, tab[i].atom);
+      }
+
+      js_free(ctx, tab);
+    }
+  } else if(socket_headers_live(s)) {
+    ret = lwsjs_socket_headers(ctx, s->wsi, NULL);
+  } else {
+    ret = JS_NewObjectProto(ctx, JS_NULL);
+  }
+
+  return ret;
+}
+
+/* wsi.header(name) */
+static JSValue
+lwsjs_socket_header(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  LWSSocket* s;
+  const char* name;
+  size_t len;
+  JSValue ret;
+
+  if(!(s = lwsjs_socket_data2(ctx, this_val)))
+    return JS_EXCEPTION;
+
+  if(!(name = JS_ToCStringLen(ctx, &len, argv[0])))
+    return JS_EXCEPTION;
+
+  ret = socket_header(ctx, s, name, len);
+
+  JS_FreeCString(ctx, name);
+  return ret;
+}
+
+static JSValue
+lwsjs_socket_want_write(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  LWSSocket* s;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(s = lwsjs_socket_method_data(ctx, this_val, __func__)))
+    return JS_EXCEPTION;
+
+  if(!s->want_write) {
+    lws_callback_on_writable(s->wsi);
+
+    s->want_write = TRUE;
+    ret = JS_NewBool(ctx, TRUE);
+
+    if(argc > 0) {
+      JS_FreeValue(ctx, s->write_handler);
+      s->write_handler = JS_DupValue(ctx, argv[0]);
+    }
+  }
+
+  return ret;
+}
+
+/* The context's WriteChunkPool, looked up (and a reference taken) the
+   first time this socket writes anything - see WriteChunkPool. */
+static WriteChunkPool*
+socket_write_pool(LWSSocket* s) {
+  if(!s->write_pool) {
+    LWSContext* lc;
+
+    if((lc = lwsjs_wsi_context(s->wsi)))
+      s->write_pool = write_pool_dup(lc->write_pool);
+  }
+
+  return s->write_pool;
+}
+
+static void
+socket_enqueue(LWSSocket* s, WriteChunk* wc) {
+  size_t len = wc->len;
+
+  list_add_tail(&wc->link, &s->write_queue);
+  s->write_buffered += len;
+
+  socket_flush(s);
+
+  DEBUG_WSI(s->wsi, "queued %zu bytes, %zu buffered, partial=%d", len, s->write_buffered, lws_partial_buffered(s->wsi));
+}
+
+/* Ends src's splice into src->splice_to, dropping the references the two
+   hold on each other. src's RX goes back to JS. */
+static void
+socket_splice_detach(LWSSocket* src, JSRuntime* rt) {
+  LWSSocket* dst = src->splice_to;
+
+  src->splice_to = NULL;
+  dst->splice_from = NULL;
+
+  if(src->rx_paused) {
+    src->rx_paused = FALSE;
+
+    if(src->wsi)
+      lws_rx_flow_control(src->wsi, 1);
+  }
+
+  socket_free(dst, rt);
+  socket_free(src, rt);
+}
+
+/* Closes s once it has written out what it has queued - see socket_flush(). */
+static void
+socket_close_drained(LWSSocket* s) {
+  if(s->wsi) {
+    s->close_drained = TRUE;
+    socket_flush(s);
+  }
+}
+
+/* Bytes a splice destination may have queued before its source's RX is
+   paused - see wsi.splice(). */
+#define SPLICE_HIGH_WATER_MARK 65536
+
+int
+socket_splice_rx(LWSSocket* s, const void* in, size_t len, BOOL is_text, JSRuntime* rt) {
+  LWSSocket* dst = s->splice_to;
+  WriteChunk* wc;
+
+  if(dst->wsi && len > 0) {
+    if(!(wc = write_chunk_new(socket_write_pool(dst), in, len, lwsi_role_ws(dst->wsi) ? is_text ? LWS_WRITE_TEXT : LWS_WRITE_BINARY : LWS_WRITE_HTTP)))
+      return -1;
+
+    socket_enqueue(dst, wc);
+    s->splice_bytes += len;
+  }
+
+  /* dst is on its way out (gone, or closing once drained because its own
+     peer closed): nothing more can go through it, so stop s as well -
+     the same as either end of the splice closing - rather than going on
+     reading RX only to drop it. */
+  if(!dst->wsi || dst->close_drained) {
+    socket_splice_detach(s, rt);
+    lws_rx_flow_control(s->wsi, 0);
+    socket_close_drained(s);
+    return 0;
+  }
+
+  if(dst->write_buffered > s->splice_hwm && !s->rx_paused) {
+    s->rx_paused = TRUE;
+    lws_rx_flow_control(s->wsi, 0);
+  }
+
+  return 0;
+}
+
+void
+socket_unsplice(LWSSocket* s, JSRuntime* rt) {
+  LWSSocket *to = s->splice_to, *from = s->splice_from;
+
+  if(to)
+    socket_splice_detach(s, rt);
+
+  if(from)
+    socket_splice_detach(from, rt);
+
+  /* A source going away still gets its own write queue out first: with a
+     splice in each direction, that is what s had sent it. */
+  if(to)
+    socket_close_drained(to);
+
+  if(from && from != to)
+    socket_close_drained(from);
+}
+
+static BOOL
+socket_spliceable(LWSSocket* s) {
+  return s->wsi && !s->closed && !s->close_drained && !lws_wsi_is_udp(s->wsi) && socket_type(s->wsi) != SOCKET_HTTP;
+}
+
+/* wsi.splice(dest [, highWaterMark]): see doc/native/LWSSocket.md. */
+static JSValue
+lwsjs_socket_splice(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  LWSSocket *s, *dst = NULL;
+  int64_t hwm = SPLICE_HIGH_WATER_MARK;
+
+  if(!(s = lwsjs_socket_method_data(ctx, this_val, __func__)))
+    return JS_EXCEPTION;
+
+  if(is_nullish(argv[0])) {
+    if(s->splice_to)
+      socket_splice_detach(s, JS_GetRuntime(ctx));
+
+    return JS_UNDEFINED;
+  }
+
+  if(!(dst = lwsjs_socket_data(argv[0])))
+    return JS_ThrowTypeError(ctx, "wsi.splice: argument 1 must be an LWSSocket");
+
+  if(argc > 1 && !JS_IsUndefined(argv[1])) {
+    if(JS_ToInt64(ctx, &hwm, argv[1]))
+      return JS_EXCEPTION;
+
+    if(hwm < 0)
+      return JS_ThrowRangeError(ctx, "wsi.splice: highWaterMark must not be negative");
+  }
+
+  if(dst == s || s->splice_to || dst->splice_from || !socket_spliceable(s) || !socket_spliceable(dst))
+    return JS_FALSE;
+
+  s->splice_to = socket_dup(dst);
+  dst->splice_from = socket_dup(s);
+  s->splice_hwm = hwm;
+
+  return JS_TRUE;
+}
+
+static JSValue
+lwsjs_socket_write(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  LWSSocket* s;
+  const void* buf = NULL;
+  BOOL text = FALSE, have_len = FALSE, have_proto = FALSE;
+  int i = 0;
+  enum lws_write_protocol proto = -1;
+  size_t size = 0, len = 0, offset = 0, maxlen = 0;
+  lws_sockaddr46* sa = 0;
+  JSValue buffer = JS_UNDEFINED;
+
+  if(!(s = lwsjs_socket_method_data(ctx, this_val, __func__)))
+    return JS_EXCEPTION;
+
+  if(JS_IsString(argv[i])) {
+    text = TRUE;
+  }
+
+  if(text) {
+    buf = JS_ToCStringLen(ctx, &size, argv[i]);
+  } else if(!(buf = JS_GetArrayBuffer(ctx, &size, argv[i]))) {
+    /* Not a bare ArrayBuffer - try a TypedArray/DataView onto one. One
+       starting at least LWS_PRE bytes into an LWSSocket.allocBuffer() buffer
+       is written straight out of the caller's memory - see
+       write_chunk_pin(). */
+    JS_FreeValue(ctx, JS_GetException(ctx));
+
+    buffer = get_typedarray_buffer(ctx, argv[i], &offset, &size);
+
+    if((buf = JS_GetArrayBuffer(ctx, &maxlen, buffer))) {
+      size = MIN(size, maxlen - MIN(offset, maxlen));
+      buf = (const uint8_t*)buf + offset;
+    } else {
+      JS_FreeValue(ctx, JS_GetException(ctx));
+    }
+  }
+
+  if(!buf) {
+    JS_FreeValue(ctx, buffer);
+    return JS_ThrowTypeError(ctx, "wsi.write: expected string, ArrayBuffer or TypedArray");
+  }
+
+  len = size;
+  i++;
+
+  while(i < argc) {
+    if(!have_len && i + 1 < argc && JS_IsNumber(argv[i])) {
+      len = to_int32(ctx, argv[i++]);
+      have_len = TRUE;
+    } else if(!have_proto && JS_IsNumber(argv[i])) {
+      proto = to_int32(ctx, argv[i++]);
+      have_proto = TRUE;
+    } else if(!sa && (sa = lwsjs_sockaddr46_data(ctx, argv[i]))) {
+      i++;
+    } else {
+      break;
+    }
+  }
+
+  if(!have_proto)
+    proto = lwsi_role_ws(s->wsi) ? text ? LWS_WRITE_TEXT : LWS_WRITE_BINARY : LWS_WRITE_HTTP;
+
+  if(len > size)
+    len = size;
+
+  BOOL pin = offset >= LWS_PRE && alloc_buffer_owned((const uint8_t*)buf - offset, maxlen);
+  WriteChunk* wc = pin ? write_chunk_pin(ctx, buffer, offset, len, proto) : write_chunk_new(socket_write_pool(s), buf, len, proto);
+
+  if(text)
+    JS_FreeCString(ctx, (const char*)buf);
+
+  JS_FreeValue(ctx, buffer);
+
+  if(!wc)
+    return JS_ThrowOutOfMemory(ctx);
+
+  if(sa) {
+    wc->addr = *sa;
+    wc->has_addr = TRUE;
+  }
+
+  socket_enqueue(s, wc);
+
+  return JS_NewInt32(ctx, (int)len);
+}
+
+/* wsi.writev([data, ...] [, proto] [, sockaddr]): the pieces are gathered
+   into a single chunk, so they go out in one lws_write() - one WS message,
+   or one syscall/TLS record for an HTTP/raw body. */
+static JSValue
+lwsjs_socket_writev(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  LWSSocket* s;
+  JSValue* values;
+  size_t i, n = 0, len = 0;
+  BOOL text = TRUE, failed = FALSE;
+  enum lws_write_protocol proto = -1;
+  lws_sockaddr46* sa = 0;
+
+  if(!(s = lwsjs_socket_method_data(ctx, this_val, __func__)))
+    return JS_EXCEPTION;
+
+  if(!JS_IsObject(argv[0]) || !(values = to_valuearray(ctx, argv[0], &n)))
+    return JS_ThrowTypeError(ctx, "wsi.writev: expected an array");
+
+  for(int j = 1; j < argc; j++) {
+    if(JS_IsNumber(argv[j]))
+      proto = to_int32(ctx, argv[j]);
+    else if(!sa)
+      sa = lwsjs_sockaddr46_data(ctx, argv[j]);
+  }
+
+  struct {
+    const void* ptr;
+    size_t len;
+    BOOL str;
+  }* pieces;
+  WriteChunk* wc = NULL;
+
+  /* On the heap: n is the length of a JS array. */
+  if(!(pieces = js_malloc(ctx, sizeof(*pieces) * (n + 1)))) {
+    failed = TRUE;
+    i = 0;
+    goto end;
+  }
+
+  for(i = 0; i < n; i++) {
+    if((pieces[i].str = JS_IsString(values[i]))) {
+      if((failed = !(pieces[i].ptr = JS_ToCStringLen(ctx, &pieces[i].len, values[i]))))
+        break;
+    } else if(!(pieces[i].ptr = get_buffer(ctx, 1, &values[i], &pieces[i].len)))
+      break;
+    else
+      text = FALSE;
+
+    len += pieces[i].len;
+  }
+
+  if(i == n && (wc = write_chunk_new(socket_write_pool(s), NULL, len, proto))) {
+    uint8_t* p = wc->buf + LWS_PRE;
+
+    for(size_t j = 0; j < n; j++) {
+      memcpy(p, pieces[j].ptr, pieces[j].len);
+      p += pieces[j].len;
+    }
+  }
+
+  for(size_t j = 0; j < i; j++)
+    if(pieces[j].str)
+      JS_FreeCString(ctx, pieces[j].ptr);
+
+  js_free(ctx, pieces);
+
+end:
+  for(size_t j = 0; j < n; j++)
+    JS_FreeValue(ctx, values[j]);
+
+  js_free(ctx, values);
+
+  if(failed)
+    return JS_EXCEPTION;
+
+  if(i < n)
+    return JS_ThrowTypeError(ctx, "wsi.writev: element %zu is not a string, ArrayBuffer or TypedArray", i);
+
+  if(!wc)
+    return JS_ThrowOutOfMemory(ctx);
+
+  if((int)proto == -1)
+    wc->proto = lwsi_role_ws(s->wsi) ? text && n ? LWS_WRITE_TEXT : LWS_WRITE_BINARY : LWS_WRITE_HTTP;
+
+  if(sa) {
+    wc->addr = *sa;
+    wc->has_addr = TRUE;
+  }
+
+  socket_enqueue(s, wc);
+
+  return JS_NewInt64(ctx, (int64_t)len);
+}
+
+/* wsi.writeChunked([data] [, final]): one Transfer-Encoding: chunked
+   segment - "<hex length>\r\n<data>\r\n" - framed straight into a single
+   queued chunk, its length taken from the bytes JS_ToCStringLen() already
+   produced (one UTF-8 conversion, no toArrayBuffer() first). With final
+   the "0\r\n\r\n" terminator goes into the same chunk, which is then
+   LWS_WRITE_HTTP_FINAL. Empty data frames nothing: a zero-length segment
+   would end the body early. Returns the number of payload bytes. */
+static JSValue
+lwsjs_socket_write_chunked(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  static const char terminator[] = "0\r\n\r\n";
+  LWSSocket* s;
+  const void* buf = NULL;
+  BOOL text = FALSE, final = argc > 1 && JS_ToBool(ctx, argv[1]);
+  size_t size = 0, total;
+  char prefix[20];
+  int plen = 0;
+  WriteChunk* wc;
+
+  if(!(s = lwsjs_socket_method_data(ctx, this_val, __func__)))
+    return JS_EXCEPTION;
+
+  if(argc > 0 && !is_nullish(argv[0])) {
+    if((text = JS_IsString(argv[0])))
+      buf = JS_ToCStringLen(ctx, &size, argv[0]);
+    else
+      buf = get_buffer(ctx, 1, &argv[0], &size);
+
+    if(!buf)
+      return JS_ThrowTypeError(ctx, "wsi.writeChunked: expected string, ArrayBuffer or TypedArray");
+  }
+
+  if(size)
+    plen = snprintf(prefix, sizeof(prefix), "%zx\r\n", size);
+
+  if(!(total = plen + (size ? size + 2 : 0) + (final ? sizeof(terminator) - 1 : 0))) {
+    if(text)
+      JS_FreeCString(ctx, buf);
+
+    return JS_NewInt32(ctx, 0);
+  }
+
+  if((wc = write_chunk_new(socket_write_pool(s), NULL, total, final ? LWS_WRITE_HTTP_FINAL : LWS_WRITE_HTTP))) {
+    uint8_t* p = wc->buf + LWS_PRE;
+
+    if(size) {
+      memcpy(p, prefix, plen);
+      memcpy(p += plen, buf, size);
+      memcpy(p += size, "\r\n", 2);
+      p += 2;
+    }
+
+    if(final)
+      memcpy(p, terminator, sizeof(terminator) - 1);
+  }
+
+  if(text)
+    JS_FreeCString(ctx, buf);
+
+  if(!wc)
+    return JS_ThrowOutOfMemory(ctx);
+
+  socket_enqueue(s, wc);
+
+  return JS_NewInt64(ctx, (int64_t)size);
+}
+
+/* A response header set compiled by LWSSocket.compileHeaders(), for
+   respond() to reuse across responses. Besides the HTTP/1 wire form
+   respond() copies in one go, it records where each name and value is,
+   because HTTP/2 has to go through lws's HPACK encoder one header at a
+   time. The status line and Content-Length stay per call. */
+typedef struct {
+  uint32_t name, name_len, value, value_len; /* offsets into wire */
+} HeaderBlockEntry;
+
+typedef struct {
+  DynBuf wire;    /* "Name: value\r\n"... */
+  DynBuf entries; /* HeaderBlockEntry[] */
+  BOOL has_date;  /* respond() doesn't add the context's own Date then */
+} LWSHeaderBlock;
+
+static JSClassID lwsjs_header_block_class_id;
+static JSValue lwsjs_header_block_proto;
+
+static int
+header_block_add(LWSHeaderBlock* hb, const char* name, size_t name_len, const char* value, size_t value_len) {
+  HeaderBlockEntry e = {hb->wire.size, name_len, hb->wire.size + name_len + 2, value_len};
+
+  if(dbuf_put(&hb->wire, (const uint8_t*)name, name_len) || dbuf_putstr(&hb->wire, ": ") || dbuf_put(&hb->wire, (const uint8_t*)value, value_len) ||
+     dbuf_putstr(&hb->wire, "\r\n") || dbuf_put(&hb->entries, (const uint8_t*)&e, sizeof(e)))
+    return -1;
+
+  return 0;
+}
+
+/* Same checks lib/lws/headers.js applies, done once here instead of on
+   every response: a name is a non-empty token, and a value can't carry
+   CR, LF or NUL into the header block. */
+static BOOL
+header_block_valid(const char* name, size_t name_len, const char* value, size_t value_len) {
+  if(name_len == 0)
+    return FALSE;
+
+  for(size_t i = 0; i < name_len; i++)
+    if((uint8_t)name[i] <= 0x20 || (uint8_t)name[i] >= 0x7f || name[i] == ':')
+      return FALSE;
+
+  for(size_t i = 0; i < value_len; i++)
+    if(value[i] == '\r' || value[i] == '\n' || value[i] == '\0')
+      return FALSE;
+
+  return TRUE;
+}
+
+static void
+header_block_free(LWSHeaderBlock* hb) {
+  dbuf_free(&hb->wire);
+  dbuf_free(&hb->entries);
+  free(hb);
+}
+
+/* The headers of obj ({name: value, ...}) as a header block: array values
+   give one line per element, as in respond(). NULL, with an exception
+   pending, if one of them is invalid. */
+static LWSHeaderBlock*
+header_block_from(JSContext* ctx, JSValueConst obj) {
+  LWSHeaderBlock* hb;
+  JSPropertyEnum* tab;
+  uint32_t tab_len;
+  JSValue ret;
+
+  if(!JS_IsObject(obj)) {
+    JS_ThrowTypeError(ctx, "headers must be an object");
+    return NULL;
+  }
+
+  if(JS_GetOwnPropertyNames(ctx, &tab, &tab_len, obj, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY))
+    return NULL;
+
+  if(!(hb = calloc(1, sizeof(LWSHeaderBlock)))) {
+    JS_ThrowOutOfMemory(ctx);
+    goto done;
+  }
+
+  dbuf_init(&hb->wire);
+  dbuf_init(&hb->entries);
+  ret = JS_UNDEFINED;
+
+  for(uint32_t j = 0; j < tab_len && JS_IsUndefined(ret); j++) {
+    JSValue value = JS_GetProperty(ctx, obj, tab[j].atom);
+    BOOL array = JS_IsArray(ctx, value);
+    uint32_t n = array ? to_uint32free(ctx, JS_GetPropertyStr(ctx, value, "length")) : 1;
+    JSValue key = JS_AtomToValue(ctx, tab[j].atom);
+    size_t name_len;
+    const char* name = JS_ToCStringLen(ctx, &name_len, key);
+
+    JS_FreeValue(ctx, key);
+
+    if(!name) {
+      ret = JS_EXCEPTION;
+    } else {
+      for(uint32_t k = 0; k < n && JS_IsUndefined(ret); k++) {
+        JSValue elem = array ? JS_GetPropertyUint32(ctx, value, k) : JS_DupValue(ctx, value);
+        size_t vlen;
+        const char* vstr = JS_ToCStringLen(ctx, &vlen, elem);
+
+        JS_FreeValue(ctx, elem);
 
-  if(!(s = lwsjs_socket_method_data(ctx, this_val, __func__)))
-    return JS_EXCEPTION;
+        if(!vstr)
+          ret = JS_EXCEPTION;
+        else if(!header_block_valid(name, name_len, vstr, vlen))
+          ret = JS_ThrowTypeError(ctx, "Invalid header: \"%s\"", name);
+        else if(header_block_add(hb, name, name_len, vstr, vlen))
+          ret = JS_ThrowOutOfMemory(ctx);
 
-  if(!s->want_write) {
-    lws_callback_on_writable(s->wsi);
+        JS_FreeCString(ctx, vstr);
+      }
 
-    s->want_write = TRUE;
-    ret = JS_NewBool(ctx, TRUE);
+      if(name_len == 4 && !strncasecmp(name, "date", 4))
+        hb->has_date = TRUE;
 
-    if(argc > 0) {
-      JS_FreeValue(ctx, s->write_handler);
-      s->write_handler = JS_DupValue(ctx, argv[0]);
+      JS_FreeCString(ctx, name);
     }
+
+    JS_FreeValue(ctx, value);
   }
 
-  return ret;
+  if(!JS_IsUndefined(ret)) {
+    header_block_free(hb);
+    hb = NULL;
+  }
+
+done:
+  for(uint32_t j = 0; j < tab_len; j++)
+    JS_FreeAtom(ctx, tab[j].atom);
+
+  js_free(ctx, tab);
+  return hb;
 }
 
+/* LWSSocket.compileHeaders({name: value, ...}) */
 static JSValue
-lwsjs_socket_write(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  LWSSocket* s;
-  const void* buf = NULL;
-  BOOL text = FALSE, have_len = FALSE, have_proto = FALSE;
-  int i = 0;
-  enum lws_write_protocol proto = -1;
-  size_t size = 0, len = 0;
-  lws_sockaddr46* sa = 0;
+lwsjs_socket_compile_headers(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  LWSHeaderBlock* hb;
+  JSValue ret;
 
-  if(!(s = lwsjs_socket_method_data(ctx, this_val, __func__)))
+  if(!JS_IsObject(argv[0]))
+    return JS_ThrowTypeError(ctx, "argument 1 must be an object");
+
+  if(!(hb = header_block_from(ctx, argv[0])))
     return JS_EXCEPTION;
 
-  if(JS_IsString(argv[i])) {
-    text = TRUE;
-  }
+  if(!JS_IsException(ret = JS_NewObjectProtoClass(ctx, lwsjs_header_block_proto, lwsjs_header_block_class_id)))
+    JS_SetOpaque(ret, hb);
+  else
+    header_block_free(hb);
 
-  if(!(buf = text ? (const void*)JS_ToCStringLen(ctx, &size, argv[i]) : (const void*)JS_GetArrayBuffer(ctx, &size, argv[i])))
-    return JS_ThrowTypeError(ctx, "wsi.write: expected string or ArrayBuffer");
+  return ret;
+}
 
-  len = size;
-  i++;
+/* Appends the block's headers at *p, the way respond() appends those from
+   a plain object. */
+static int
+header_block_write(struct lws* wsi, LWSHeaderBlock* hb, uint8_t** p, uint8_t* end) {
+  if(lwsi_role_h2(wsi) || lwsi_role_h2_ENCAPSULATION(wsi)) {
+    const HeaderBlockEntry* e = (const HeaderBlockEntry*)hb->entries.buf;
 
-  while(i < argc) {
-    if(!have_len && i + 1 < argc && JS_IsNumber(argv[i])) {
-      len = to_int32(ctx, argv[i++]);
-      have_len = TRUE;
-    } else if(!have_proto && JS_IsNumber(argv[i])) {
-      proto = to_int32(ctx, argv[i++]);
-      have_proto = TRUE;
-    } else if(!sa && (sa = lwsjs_sockaddr46_data(ctx, argv[i]))) {
-      i++;
-    } else {
-      break;
-    }
-  }
+    for(size_t i = 0; i < hb->entries.size / sizeof(*e); i++) {
+      char name[e[i].name_len + 1];
 
-  if(!have_proto)
-    proto = lwsi_role_ws(s->wsi) ? text ? LWS_WRITE_TEXT : LWS_WRITE_BINARY : LWS_WRITE_HTTP;
+      memcpy(name, hb->wire.buf + e[i].name, e[i].name_len);
+      name[e[i].name_len] = '\0';
 
-  if(len > size)
-    len = size;
+      if(lws_add_http_header_by_name(wsi, (const uint8_t*)name, hb->wire.buf + e[i].value, e[i].value_len, p, end))
+        return -1;
+    }
 
-  WriteChunk* wc = write_chunk_new(buf, len, proto);
+    return 0;
+  }
 
-  if(text)
-    JS_FreeCString(ctx, (const char*)buf);
+  if(hb->wire.size >= (size_t)(end - *p))
+    return -1;
 
-  if(!wc)
-    return JS_ThrowOutOfMemory(ctx);
+  memcpy(*p, hb->wire.buf, hb->wire.size);
+  *p += hb->wire.size;
+  return 0;
+}
 
-  if(sa) {
-    wc->addr = *sa;
-    wc->has_addr = TRUE;
-  }
+static JSValue
+lwsjs_header_block_get_byte_length(JSContext* ctx, JSValueConst this_val) {
+  LWSHeaderBlock* hb;
 
-  list_add_tail(&wc->link, &s->write_queue);
-  s->write_buffered += len;
+  if(!(hb = JS_GetOpaque2(ctx, this_val, lwsjs_header_block_class_id)))
+    return JS_EXCEPTION;
 
-  socket_flush(s);
+  return JS_NewInt64(ctx, hb->wire.size);
+}
 
-  DEBUG_WSI(s->wsi, "queued %zu bytes, %zu buffered, partial=%d", len, s->write_buffered, lws_partial_buffered(s->wsi));
+static void
+lwsjs_header_block_finalizer(JSRuntime* rt, JSValue val) {
+  LWSHeaderBlock* hb;
 
-  return JS_NewInt32(ctx, (int)len);
+  if((hb = JS_GetOpaque(val, lwsjs_header_block_class_id)))
+    header_block_free(hb);
 }
 
+static const JSClassDef lws_header_block_class = {
+    "LWSHeaderBlock",
+    .finalizer = lwsjs_header_block_finalizer,
+};
+
+static const JSCFunctionListEntry lws_header_block_proto_funcs[] = {
+    JS_CGETSET_DEF("byteLength", lwsjs_header_block_get_byte_length, 0),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "LWSHeaderBlock", JS_PROP_CONFIGURABLE),
+};
+
 static JSValue
 lwsjs_socket_respond(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
   LWSSocket* s;
@@ -724,7 +2082,9 @@ lwsjs_socket_respond(JSContext* ctx, JSValueConst this_val, int argc, JSValueCon
   int64_t len = -1;
   int code = -1;
   int header_arg = -1;
-  BOOL is_str = FALSE;
+  BOOL is_str = FALSE, has_date = FALSE;
+  LWSHeaderBlock* block = NULL;
+  LWSContext* lc;
 
   if(!(s = lwsjs_socket_method_data(ctx, this_val, __func__)))
     return JS_EXCEPTION;
@@ -734,6 +2094,8 @@ lwsjs_socket_respond(JSContext* ctx, JSValueConst this_val, int argc, JSValueCon
       code = to_int32(ctx, argv[i]);
     } else if(len == -1 && JS_IsNumber(argv[i])) {
       len = to_int64(ctx, argv[i]);
+    } else if(!block && (block = JS_GetOpaque(argv[i], lwsjs_header_block_class_id))) {
+      /* LWSSocket.compileHeaders() block, sent before any header object */
     } else if(!ptr && (ptr = JS_GetArrayBuffer(ctx, &tmp_len, argv[i]))) {
       len = len == -1 ? (int64_t)tmp_len : len;
     } else if(!ptr && JS_IsString(argv[i]) && (ptr = (uint8_t*)JS_ToCStringLen(ctx, &tmp_len, argv[i]))) {
@@ -753,6 +2115,13 @@ lwsjs_socket_respond(JSContext* ctx, JSValueConst this_val, int argc, JSValueCon
     return JS_ThrowInternalError(ctx, "lws_add_http_common_headers failed");
   }
 
+  if(block && header_block_write(s->wsi, block, &p, end)) {
+    if(is_str)
+      JS_FreeCString(ctx, (const char*)ptr);
+
+    return JS_ThrowInternalError(ctx, "header block doesn't fit");
+  }
+
   JSPropertyEnum* tab = 0;
   uint32_t tab_len;
 
@@ -765,6 +2134,9 @@ lwsjs_socket_respond(JSContext* ctx, JSValueConst this_val, int argc, JSValueCon
 
       JSValue value = JS_GetProperty(ctx, argv[header_arg], tab[j].atom);
 
+      if(name && !strcasecmp(name, "date"))
+        has_date = TRUE;
+
       /* Array values emit one header line per element. Needed for
          Set-Cookie (RFC 6265 forbids comma-folding) and accepted
          generally so callers can pass a list under any name. */
@@ -805,6 +2177,16 @@ lwsjs_socket_respond(JSContext* ctx, JSValueConst this_val, int argc, JSValueCon
     js_free(ctx, tab);
   }
 
+  /* The `date_header` context option: the context's cached Date value,
+     unless the caller brought their own. */
+  if(!has_date && !(block && block->has_date) && (lc = lwsjs_wsi_context(s->wsi)) && lc->date_header)
+    if(lws_add_http_header_by_token(s->wsi, WSI_TOKEN_HTTP_DATE, (const uint8_t*)lwsjs_context_date(lc), HTTP_DATE_LEN, &p, end)) {
+      if(is_str)
+        JS_FreeCString(ctx, (const char*)ptr);
+
+      return JS_ThrowInternalError(ctx, "lws_add_http_header_by_token");
+    }
+
   int n = lws_finalize_write_http_header(s->wsi, start, &p, end) ? -1 : (int)lws_ptr_diff_size_t(p, start);
 
   DEBUG_WSI(s->wsi, "wrote headers (%d)", n);
@@ -842,9 +2224,343 @@ lwsjs_socket_respond(JSContext* ctx, JSValueConst this_val, int argc, JSValueCon
   return JS_NewUint32(ctx, written);
 }
 
+/* Whether the request's Accept-Encoding lists gzip, with a q-value other
+   than 0 if it has one. */
+static BOOL
+accepts_gzip(struct lws* wsi) {
+  int n = lws_hdr_total_length(wsi, WSI_TOKEN_HTTP_ACCEPT_ENCODING);
+
+  if(n <= 0)
+    return FALSE;
+
+  char buf[n + 1];
+
+  if(lws_hdr_copy(wsi, buf, n + 1, WSI_TOKEN_HTTP_ACCEPT_ENCODING) < 0)
+    return FALSE;
+
+  for(char *tok = buf, *next; tok; tok = next) {
+    size_t len;
+
+    if((next = strchr(tok, ',')))
+      *next++ = '\0';
+
+    tok += strspn(tok, " \t");
+    len = strcspn(tok, " \t;");
+
+    if(len == 4 && !strncasecmp(tok, "gzip", 4)) {
+      const char* q = strstr(tok + len, "q=");
+
+      return !q || strtod(q + 2, NULL) > 0;
+    }
+  }
+
+  return FALSE;
+}
+
+/* A whole response rendered once, by LWSSocket.compileResponse(), for a
+   route that always answers the same - serve()'s static `routes` entries
+   (lib/serve.js). Set on an LWSRouter route (setResponse(), lws-router.c)
+   of a protocol's `router`, lwsjs_callback_protocol() sends it for a GET
+   or HEAD right from LWS_CALLBACK_HTTP with socket_respond_static(),
+   without calling into JS. The bodies are ArrayBuffers with LWS_PRE spare
+   bytes in front, queued as pinned chunks, so a hit doesn't copy them;
+   with `gzip` there is a compressed variant for clients that accept it. */
+typedef struct {
+  int status;
+  LWSHeaderBlock* headers[2]; /* identity, gzip */
+  JSValue body[2];            /* JS_UNDEFINED if there's no gzip variant */
+  size_t len[2];
+} LWSStaticResponse;
+
+JSClassID lwsjs_static_response_class_id;
+static JSValue lwsjs_static_response_proto;
+
+enum {
+  STATIC_RESPONSE_STATUS = 0,
+  STATIC_RESPONSE_BYTE_LENGTH,
+  STATIC_RESPONSE_GZIP_BYTE_LENGTH,
+};
+
+/* Bodies smaller than this go out as they are. */
+#define STATIC_GZIP_MIN 256
+
+static JSValue
+static_body(JSContext* ctx, uint8_t* buf, size_t len) {
+  JSValue ret = JS_NewArrayBuffer(ctx, buf, LWS_PRE + len, socket_rx_free, NULL, FALSE);
+
+  if(JS_IsException(ret))
+    js_free(ctx, buf);
+
+  return ret;
+}
+
+static BOOL
+header_block_has(LWSHeaderBlock* hb, const char* name) {
+  const HeaderBlockEntry* e = (const HeaderBlockEntry*)hb->entries.buf;
+  size_t len = strlen(name);
+
+  for(size_t i = 0; i < hb->entries.size / sizeof(*e); i++)
+    if(e[i].name_len == len && !strncasecmp((const char*)hb->wire.buf + e[i].name, name, len))
+      return TRUE;
+
+  return FALSE;
+}
+
+#ifdef HAVE_ZLIB
+/* The gzip variant of the identity body: compressed once, at level 9, and
+   only kept if it comes out smaller. */
+static int
+static_response_gzip(JSContext* ctx, LWSStaticResponse* sr, const uint8_t* data) {
+  static const char encoding[] = "gzip", vary[] = "Accept-Encoding";
+  z_stream zs = {0};
+  uint8_t* buf;
+  size_t bound;
+  int r;
+
+  if(sr->len[0] < STATIC_GZIP_MIN || header_block_has(sr->headers[0], "content-encoding"))
+    return 0;
+
+  if(deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return 0;
+
+  bound = deflateBound(&zs, sr->len[0]);
+
+  if(!(buf = js_malloc(ctx, LWS_PRE + bound))) {
+    deflateEnd(&zs);
+    return -1;
+  }
+
+  zs.next_in = (Bytef*)data;
+  zs.avail_in = sr->len[0];
+  zs.next_out = buf + LWS_PRE;
+  zs.avail_out = bound;
+  r = deflate(&zs, Z_FINISH);
+  deflateEnd(&zs);
+
+  if(r != Z_STREAM_END || zs.total_out >= sr->len[0]) {
+    js_free(ctx, buf);
+    return 0;
+  }
+
+  if(!(sr->headers[1] = calloc(1, sizeof(LWSHeaderBlock)))) {
+    js_free(ctx, buf);
+    return -1;
+  }
+
+  dbuf_init(&sr->headers[1]->wire);
+  dbuf_init(&sr->headers[1]->entries);
+  sr->headers[1]->has_date = sr->headers[0]->has_date;
+
+  if(dbuf_put(&sr->headers[1]->wire, sr->headers[0]->wire.buf, sr->headers[0]->wire.size) ||
+     dbuf_put(&sr->headers[1]->entries, sr->headers[0]->entries.buf, sr->headers[0]->entries.size) ||
+     header_block_add(sr->headers[1], "content-encoding", 16, encoding, sizeof(encoding) - 1) ||
+     header_block_add(sr->headers[1], "vary", 4, vary, sizeof(vary) - 1) || header_block_add(sr->headers[0], "vary", 4, vary, sizeof(vary) - 1)) {
+    js_free(ctx, buf);
+    return -1;
+  }
+
+  sr->len[1] = zs.total_out;
+
+  if(JS_IsException(sr->body[1] = static_body(ctx, buf, sr->len[1])))
+    return -1;
+
+  return 0;
+}
+#endif
+
+static void
+static_response_free(JSRuntime* rt, LWSStaticResponse* sr) {
+  for(int i = 0; i < 2; i++) {
+    if(sr->headers[i])
+      header_block_free(sr->headers[i]);
+
+    JS_FreeValueRT(rt, sr->body[i]);
+  }
+
+  js_free_rt(rt, sr);
+}
+
+/* LWSSocket.compileResponse(status, headers, body[, {gzip}]) */
+static JSValue
+lwsjs_socket_compile_response(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  LWSStaticResponse* sr;
+  const uint8_t* data = NULL;
+  uint8_t* buf;
+  size_t len = 0;
+  int32_t status;
+  BOOL is_str = FALSE;
+#ifdef HAVE_ZLIB
+  BOOL gzip = FALSE;
+#endif
+  JSValue ret = JS_EXCEPTION;
+
+  if(JS_ToInt32(ctx, &status, argv[0]))
+    return JS_EXCEPTION;
+
+  if(status < 100 || status > 999)
+    return JS_ThrowRangeError(ctx, "status must be between 100 and 999");
+
+  if(!JS_IsObject(argv[1]))
+    return JS_ThrowTypeError(ctx, "argument 2 must be an object");
+
+  if(!(sr = js_mallocz(ctx, sizeof(LWSStaticResponse))))
+    return JS_EXCEPTION;
+
+  sr->status = status;
+  sr->body[0] = sr->body[1] = JS_UNDEFINED;
+
+  /* The headers' getters and toString()s and the gzip option can run user
+     code that detaches the body, so it is only looked at after them. */
+  if(!(sr->headers[0] = header_block_from(ctx, argv[1])))
+    goto fail;
+
+#ifdef HAVE_ZLIB
+  if(argc > 3 && JS_IsObject(argv[3]) && (gzip = to_boolfree(ctx, js_get_property(ctx, argv[3], "gzip"))) == -1)
+    goto fail;
+#endif
+
+  if(JS_IsString(argv[2])) {
+    if(!(data = (const uint8_t*)JS_ToCStringLen(ctx, &len, argv[2])))
+      goto fail;
+
+    is_str = TRUE;
+  } else if(!is_nullish(argv[2]) && !(data = JS_GetArrayBuffer(ctx, &len, argv[2]))) {
+    goto fail;
+  }
+
+  sr->len[0] = len;
+
+  if(!(buf = js_malloc(ctx, LWS_PRE + len)))
+    goto fail;
+
+  if(len)
+    memcpy(buf + LWS_PRE, data, len);
+
+  if(JS_IsException(sr->body[0] = static_body(ctx, buf, len)))
+    goto fail;
+
+#ifdef HAVE_ZLIB
+  if(gzip && static_response_gzip(ctx, sr, data)) {
+    JS_ThrowOutOfMemory(ctx);
+    goto fail;
+  }
+#endif
+
+  if(!JS_IsException(ret = JS_NewObjectProtoClass(ctx, lwsjs_static_response_proto, lwsjs_static_response_class_id))) {
+    JS_SetOpaque(ret, sr);
+    sr = NULL;
+  }
+
+fail:
+  if(sr)
+    static_response_free(JS_GetRuntime(ctx), sr);
+
+  if(is_str)
+    JS_FreeCString(ctx, (const char*)data);
+
+  return ret;
+}
+
+int
+socket_respond_static(LWSSocket* s, JSValueConst response, BOOL head) {
+  uint8_t buf[LWS_PRE + LWS_RECOMMENDED_MIN_HEADER_SPACE], *start = buf + LWS_PRE, *p = start, *end = buf + sizeof(buf) - 1;
+  LWSContext* lc = lwsjs_wsi_context(s->wsi);
+  LWSStaticResponse* sr;
+  WriteChunk* wc;
+  int v;
+
+  if(!lc || !(sr = JS_GetOpaque(response, lwsjs_static_response_class_id)))
+    return -1;
+
+  v = !JS_IsUndefined(sr->body[1]) && accepts_gzip(s->wsi);
+
+  if(lws_add_http_common_headers(s->wsi, sr->status, NULL, sr->len[v], &p, end) || header_block_write(s->wsi, sr->headers[v], &p, end))
+    return -1;
+
+  if(!sr->headers[v]->has_date && lc->date_header)
+    if(lws_add_http_header_by_token(s->wsi, WSI_TOKEN_HTTP_DATE, (const uint8_t*)lwsjs_context_date(lc), HTTP_DATE_LEN, &p, end))
+      return -1;
+
+  if(lws_finalize_write_http_header(s->wsi, start, &p, end))
+    return -1;
+
+  /* An empty LWS_WRITE_HTTP_FINAL write still has to go out for HEAD: the
+     transaction completes once it has. */
+  if(head || sr->len[v] == 0)
+    wc = write_chunk_new(socket_write_pool(s), NULL, 0, LWS_WRITE_HTTP_FINAL);
+  else
+    wc = write_chunk_pin(lc->js, sr->body[v], LWS_PRE, sr->len[v], LWS_WRITE_HTTP_FINAL);
+
+  if(!wc)
+    return -1;
+
+  socket_enqueue(s, wc);
+  return 0;
+}
+
+static JSValue
+lwsjs_static_response_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  LWSStaticResponse* sr;
+
+  if(!(sr = JS_GetOpaque2(ctx, this_val, lwsjs_static_response_class_id)))
+    return JS_EXCEPTION;
+
+  JSValue ret = JS_UNDEFINED;
+
+  switch(magic) {
+    case STATIC_RESPONSE_STATUS: {
+      ret = JS_NewInt32(ctx, sr->status);
+      break;
+    }
+
+    case STATIC_RESPONSE_BYTE_LENGTH: {
+      ret = JS_NewInt64(ctx, sr->len[0]);
+      break;
+    }
+
+    case STATIC_RESPONSE_GZIP_BYTE_LENGTH: {
+      ret = JS_NewInt64(ctx, sr->len[1]);
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static void
+lwsjs_static_response_finalizer(JSRuntime* rt, JSValue val) {
+  LWSStaticResponse* sr;
+
+  if((sr = JS_GetOpaque(val, lwsjs_static_response_class_id)))
+    static_response_free(rt, sr);
+}
+
+static void
+lwsjs_static_response_mark(JSRuntime* rt, JSValueConst val, JS_MarkFunc* mark_func) {
+  LWSStaticResponse* sr;
+
+  if((sr = JS_GetOpaque(val, lwsjs_static_response_class_id)))
+    for(int i = 0; i < 2; i++)
+      JS_MarkValue(rt, sr->body[i], mark_func);
+}
+
+static const JSClassDef lws_static_response_class = {
+    "LWSStaticResponse",
+    .finalizer = lwsjs_static_response_finalizer,
+    .gc_mark = lwsjs_static_response_mark,
+};
+
+static const JSCFunctionListEntry lws_static_response_proto_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("status", lwsjs_static_response_get, 0, STATIC_RESPONSE_STATUS),
+    JS_CGETSET_MAGIC_DEF("byteLength", lwsjs_static_response_get, 0, STATIC_RESPONSE_BYTE_LENGTH),
+    JS_CGETSET_MAGIC_DEF("gzipByteLength", lwsjs_static_response_get, 0, STATIC_RESPONSE_GZIP_BYTE_LENGTH),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "LWSStaticResponse", JS_PROP_CONFIGURABLE),
+};
+
 static JSValue
 lwsjs_socket_set_timeout(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
   LWSSocket* s;
+  LWSContext* lc;
   int32_t secs;
 
   if(!(s = lwsjs_socket_data2(ctx, this_val)))
@@ -860,6 +2576,9 @@ lwsjs_socket_set_timeout(JSContext* ctx, JSValueConst this_val, int argc, JSValu
      timeout the same way lws itself does internally (NO_PENDING_TIMEOUT). */
   lws_set_timeout(s->wsi, secs > 0 ? PENDING_TIMEOUT_USER_OK : NO_PENDING_TIMEOUT, secs);
 
+  if((lc = lwsjs_wsi_context(s->wsi)))
+    lwsjs_service_arm(lc);
+
   return JS_UNDEFINED;
 }
 
@@ -1092,6 +2811,7 @@ lwsjs_socket_client_http_multipart(JSContext* ctx, JSValueConst this_val, int ar
 enum {
   FUNCTION_LIST,
   FUNCTION_GET,
+  FUNCTION_ALLOC_BUFFER,
 };
 
 static JSValue
@@ -1123,6 +2843,41 @@ lwsjs_socket_functions(JSContext* ctx, JSValueConst this_val, int argc, JSValueC
       ret = socket_obj2(socket_get_by_id(to_int32(ctx, argv[0])), ctx);
       break;
     }
+
+    case FUNCTION_ALLOC_BUFFER: {
+      /* A Uint8Array of the requested size, sitting LWS_PRE bytes into a
+         bigger ArrayBuffer whose memory is recorded in alloc_buffers:
+         wsi.write() recognizes it and sends it without copying (see
+         write_chunk_pin()). */
+      uint32_t size = to_uint32(ctx, argv[0]);
+      JSValue args[3], ctor;
+      uint8_t* base;
+
+      if(!(base = js_mallocz(ctx, (size_t)LWS_PRE + size)))
+        return JS_EXCEPTION;
+
+      if(alloc_buffers_add(base)) {
+        js_free(ctx, base);
+        return JS_ThrowOutOfMemory(ctx);
+      }
+
+      args[0] = JS_NewArrayBuffer(ctx, base, (size_t)LWS_PRE + size, alloc_buffer_free, NULL, FALSE);
+
+      if(JS_IsException(args[0])) {
+        alloc_buffers_remove(base);
+        js_free(ctx, base);
+        return JS_EXCEPTION;
+      }
+
+      args[1] = JS_NewUint32(ctx, LWS_PRE);
+      args[2] = JS_NewUint32(ctx, size);
+
+      ctor = global_get(ctx, "Uint8Array");
+      ret = JS_CallConstructor(ctx, ctor, countof(args), args);
+      JS_FreeValue(ctx, ctor);
+      JS_FreeValue(ctx, args[0]);
+      break;
+    }
   }
 
   return ret;
@@ -1141,6 +2896,7 @@ enum {
   PROP_DISPATCH_REASON,
   PROP_REDIRECTED_TO_GET,
   PROP_BUFFERED_AMOUNT,
+  PROP_SPLICED,
   PROP_PROTOCOL,
   PROP_VHOST,
   PROP_TAG,
@@ -1243,6 +2999,12 @@ lwsjs_socket_get(JSContext* ctx, JSValueConst this_val, int magic) {
 
   switch(magic) {
     case PROP_HEADERS: {
+      /* Built on first access rather than by lwsjs_callback_protocol() for
+         every transaction, and kept: once lws drops the header table this
+         is all that's left of the headers. */
+      if(is_nullish(s->headers) && socket_headers_live(s))
+        s->headers = lwsjs_socket_headers(ctx, s->wsi, &s->proto);
+
       ret = JS_DupValue(ctx, s->headers);
       break;
     }
@@ -1509,6 +3271,11 @@ lwsjs_socket_get(JSContext* ctx, JSValueConst this_val, int magic) {
       break;
     }
 
+    case PROP_SPLICED: {
+      ret = JS_NewInt64(ctx, s->splice_bytes);
+      break;
+    }
+
     case PROP_TLS_SESSION_REUSED: {
       ret = JS_NewBool(ctx, lws_tls_session_is_reused(s->wsi));
       break;
@@ -1564,10 +3331,14 @@ static const JSClassDef lws_socket_class = {
 static const JSCFunctionListEntry lws_socket_proto_funcs[] = {
     JS_CFUNC_DEF("wantWrite", 0, lwsjs_socket_want_write),
     JS_CFUNC_DEF("write", 1, lwsjs_socket_write),
+    JS_CFUNC_DEF("writev", 1, lwsjs_socket_writev),
+    JS_CFUNC_DEF("writeChunked", 1, lwsjs_socket_write_chunked),
+    JS_CFUNC_DEF("splice", 1, lwsjs_socket_splice),
     JS_CFUNC_DEF("respond", 1, lwsjs_socket_respond),
     JS_CFUNC_DEF("close", 0, lwsjs_socket_close),
     JS_CFUNC_DEF("httpClientRead", 1, lwsjs_socket_http_client_read),
     JS_CFUNC_DEF("addHeader", 4, lwsjs_socket_add_header),
+    JS_CFUNC_DEF("header", 1, lwsjs_socket_header),
     JS_CFUNC_DEF("clientHttpMultipart", 4, lwsjs_socket_client_http_multipart),
     JS_CFUNC_DEF("setTimeout", 1, lwsjs_socket_set_timeout),
     JS_CGETSET_MAGIC_FLAGS_DEF("id", lwsjs_socket_get, 0, PROP_ID, 0),
@@ -1600,6 +3371,7 @@ static const JSCFunctionListEntry lws_socket_proto_funcs[] = {
     JS_CGETSET_MAGIC_DEF("isPipelineLeader", lwsjs_socket_get, 0, PROP_IS_PIPELINE_LEADER),
     JS_CGETSET_MAGIC_DEF("pipelineQueueDepth", lwsjs_socket_get, 0, PROP_PIPELINE_QUEUE_DEPTH),
     JS_CGETSET_MAGIC_DEF("sendPipeChoked", lwsjs_socket_get, 0, PROP_SEND_PIPE_CHOKED),
+    JS_CGETSET_MAGIC_DEF("spliced", lwsjs_socket_get, 0, PROP_SPLICED),
     JS_CGETSET_MAGIC_DEF("tlsSessionReused", lwsjs_socket_get, 0, PROP_TLS_SESSION_REUSED),
     JS_CGETSET_MAGIC_DEF("peerCertificate", lwsjs_socket_get, 0, PROP_PEER_CERTIFICATE),
 #ifdef LWS_WITH_CONMON
@@ -1611,6 +3383,10 @@ static const JSCFunctionListEntry lws_socket_proto_funcs[] = {
 static const JSCFunctionListEntry lws_socket_static_funcs[] = {
     JS_CFUNC_MAGIC_DEF("list", 0, lwsjs_socket_functions, FUNCTION_LIST),
     JS_CFUNC_MAGIC_DEF("get", 1, lwsjs_socket_functions, FUNCTION_GET),
+    JS_CFUNC_MAGIC_DEF("allocBuffer", 1, lwsjs_socket_functions, FUNCTION_ALLOC_BUFFER),
+    JS_CFUNC_DEF("compileHeaders", 1, lwsjs_socket_compile_headers),
+    JS_CFUNC_DEF("compileResponse", 3, lwsjs_socket_compile_response),
+    JS_PROP_INT32_DEF("PRE", LWS_PRE, 0),
 };
 
 int
@@ -1619,6 +3395,18 @@ lwsjs_socket_init(JSContext* ctx, JSModuleDef* m) {
 
   JS_NewClassID(&lwsjs_socket_class_id);
   JS_NewClass(JS_GetRuntime(ctx), lwsjs_socket_class_id, &lws_socket_class);
+  header_names_init();
+
+  JS_NewClassID(&lwsjs_header_block_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), lwsjs_header_block_class_id, &lws_header_block_class);
+  lwsjs_header_block_proto = JS_NewObjectProto(ctx, JS_NULL);
+  JS_SetPropertyFunctionList(ctx, lwsjs_header_block_proto, lws_header_block_proto_funcs, countof(lws_header_block_proto_funcs));
+
+  JS_NewClassID(&lwsjs_static_response_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), lwsjs_static_response_class_id, &lws_static_response_class);
+  lwsjs_static_response_proto = JS_NewObjectProto(ctx, JS_NULL);
+  JS_SetPropertyFunctionList(ctx, lwsjs_static_response_proto, lws_static_response_proto_funcs, countof(lws_static_response_proto_funcs));
+
   lwsjs_socket_proto = JS_NewObjectProto(ctx, JS_NULL);
   JS_SetPropertyFunctionList(ctx, lwsjs_socket_proto, lws_socket_proto_funcs, countof(lws_socket_proto_funcs));
 
@@ -11,7 +11,15 @@ typedef enum {
   SOCKET_HTTP,
 } LWSSocketType;
 
-typedef struct {
+/* Size classes of the per-LWSContext WriteChunk freelist (lws-socket.c). */
+#define WRITE_POOL_CLASSES 3
+
+typedef struct WriteChunkPool WriteChunkPool;
+
+/* An LWSContext's interned header-name atoms (lws-socket.c). */
+typedef struct HeaderAtoms HeaderAtoms;
+
+typedef struct LWSSocket {
   struct list_head link;
   int ref_count;
   struct lws* wsi;
@@ -19,7 +27,7 @@ typedef struct {
   LWSSocketType type;
   char *uri, *proto;
   void* obj;
-  BOOL client : 1, want_write : 1, redirected_to_get : 1, completed : 1, closed : 1, dispatching : 1, close_code_set : 1;
+  BOOL client : 1, want_write : 1, redirected_to_get : 1, completed : 1, closed : 1, dispatching : 1, close_code_set : 1, rx_paused : 1, close_drained : 1;
   int dispatch_reason;
   JSValue headers, write_handler;
   int response_code, body_pending, method;
@@ -43,20 +51,66 @@ typedef struct {
   struct lws_retry_bo* retry;
   struct list_head write_queue; /* pending WriteChunks, FIFO */
   size_t write_buffered;        /* bytes still queued at our layer */
+  WriteChunkPool* write_pool;   /* where write_queue chunks come from/go back to */
+  /* The WS message being reassembled from its fragments when the protocol
+     has the `reassemble` option - see socket_rx_append(). */
+  uint8_t* rx_msg;
+  size_t rx_msg_len, rx_msg_size;
+  /* LWSHeaders objects (lws-headers.c) still reading from this wsi's
+     header table - handed a copy of their own before the table goes away,
+     see lwsjs_headers_detach(). */
+  struct list_head live_headers;
+  /* wsi.splice(): this socket's RX goes straight into splice_to's write
+     queue instead of to JS, and splice_to->splice_from points back here
+     so draining that queue can resume our RX (paused, rx_paused, while
+     more than splice_hwm bytes are queued there). Each holds a reference
+     on the other until socket_unsplice(). close_drained: close this wsi
+     as soon as its write queue is empty - set when the other end of a
+     splice has closed. splice_bytes: RX passed on to splice_to, for
+     wsi.spliced. */
+  struct LWSSocket *splice_to, *splice_from;
+  size_t splice_hwm;
+  int64_t splice_bytes;
 } LWSSocket;
 
 extern JSClassID lwsjs_socket_class_id;
+extern JSClassID lwsjs_static_response_class_id;
 
 int socket_getid(struct lws* wsi);
 LWSSocket* socket_get(struct lws* wsi);
 LWSSocket* socket_alloc(JSContext* ctx);
+LWSSocket* socket_dup(LWSSocket*);
+void socket_free(LWSSocket*, JSRuntime*);
 void socket_flush(LWSSocket* s);
+/* Hands len bytes of RX on s (spliced) to its splice_to, as one message
+   if that is a WS connection (text if is_text). Once splice_to is closing,
+   ends the splice and closes s too. -1 if out of memory. */
+int socket_splice_rx(LWSSocket* s, const void* in, size_t len, BOOL is_text, JSRuntime* rt);
+/* Ends s's splice in either direction, closing the other end: the
+   destination only once it has written out what it has queued. */
+void socket_unsplice(LWSSocket* s, JSRuntime* rt);
+int socket_rx_append(JSContext*, LWSSocket*, const void* data, size_t len, size_t max);
+JSValue socket_rx_take(JSContext*, LWSSocket*, BOOL binary);
+WriteChunkPool* write_pool_new(size_t max_retained);
+WriteChunkPool* write_pool_dup(WriteChunkPool*);
+void write_pool_free(WriteChunkPool*);
+JSValue write_pool_stats(JSContext*, WriteChunkPool*);
 struct lws* lwsjs_socket_wsi(JSValueConst);
 void lwsjs_socket_destroy(JSContext*, struct lws*);
 JSValue lwsjs_socket_wrap(JSContext*, LWSSocket*);
 JSValue lwsjs_socket_create(JSContext*, struct lws*);
 JSValue lwsjs_socket_get_or_create(JSContext*, struct lws*);
 JSValue lwsjs_socket_headers(JSContext*, struct lws*, char**);
+void header_atoms_free(JSRuntime*, HeaderAtoms*);
+void lwsjs_socket_proto(JSContext*, struct lws*, char**);
+JSValue socket_header(JSContext*, LWSSocket*, const char* name, size_t len);
+JSValue socket_headers_copy(JSContext*, LWSSocket*);
+void lwsjs_headers_detach(JSContext*, LWSSocket*, BOOL copy);
+/* Sends an LWSSocket.compileResponse() response in reply to the current
+   request: the headers right away, the body (none for head) queued as
+   the transaction's LWS_WRITE_HTTP_FINAL write. -1 if response isn't one
+   or the headers couldn't be written. */
+int socket_respond_static(LWSSocket*, JSValueConst response, BOOL head);
 int lwsjs_socket_init(JSContext*, JSModuleDef*);
 int lwsjs_method_index(const char* method);
 const char* lwsjs_method_name(int index);
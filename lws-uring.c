@@ -0,0 +1,530 @@
+#ifdef USE_IO_URING
+#include "lws-uring.h"
+#include "iohandler.h"
+#include "js-utils.h"
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <endian.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+/* io_uring poll backend, used through the raw syscalls rather than
+   liburing so the build doesn't grow a dependency for the handful of
+   operations needed here: IORING_OP_POLL_ADD (multishot where the kernel
+   has it, 5.13+), IORING_OP_POLL_REMOVE, and an eventfd registered with
+   IORING_REGISTER_EVENTFD. That eventfd is the only fd quickjs-libc ever
+   sees; completions are reaped and serviced in C, and arming, re-arming
+   or cancelling a poll is just an SQE written into shared memory -
+   submitted with one io_uring_enter() after a whole batch of completions
+   has been serviced, not one syscall per interest change. */
+
+/* user_data of POLL_REMOVE SQEs - their completions carry nothing of
+   interest. Poll completions carry (generation << 32 | fd). */
+#define URING_CANCEL_DATA UINT64_MAX
+
+/* Same purpose as EPOLL_SETTLE_PASSES in lws-epoll.c. */
+#define URING_SETTLE_PASSES 16
+
+typedef struct {
+  int events;   /* POLLIN/POLLOUT interest, as registered by lws */
+  uint32_t gen; /* bumped on every (re-)arm; stale completions don't match */
+  unsigned registered : 1, armed : 1, multi : 1, pending : 1;
+} LWSUringFd;
+
+struct LWSUring {
+  LWSContext* lws;
+  int ring_fd, event_fd;
+  void* ring;
+  size_t ring_size;
+  struct io_uring_sqe* sqes;
+  size_t sqes_size;
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_flags, *sq_array, sq_entries;
+  unsigned sq_local_tail, to_submit;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_cqe* cqes;
+  LWSUringFd* fds;
+  int nfds;
+  BOOL multishot, draining;
+  /* fds serviced during this drain whose readiness is unknown afterwards:
+     a multishot poll only completes again on a new wakeup, not while the
+     fd merely stays ready - see uring_settle(). */
+  int *pending, npending, pending_size;
+  struct pollfd* pollfds;
+  uint64_t submitted, completions;
+};
+
+static int
+uring_setup(unsigned entries, struct io_uring_params* p) {
+  return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int
+uring_enter(int fd, unsigned to_submit, unsigned flags) {
+  return syscall(__NR_io_uring_enter, fd, to_submit, 0, flags, NULL, 0);
+}
+
+static int
+uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+  return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static LWSUringFd*
+uring_fd_get(LWSUring* ur, int fd) {
+  if(fd < 0 || fd >= ur->nfds || !ur->fds[fd].registered)
+    return NULL;
+
+  return &ur->fds[fd];
+}
+
+static LWSUringFd*
+uring_fd_slot(LWSUring* ur, int fd) {
+  if(fd < 0)
+    return NULL;
+
+  if(fd >= ur->nfds) {
+    int n = ur->nfds ? ur->nfds : 64;
+    LWSUringFd* fds;
+
+    while(n <= fd)
+      n *= 2;
+
+    if(!(fds = js_realloc(ur->lws->js, ur->fds, n * sizeof(LWSUringFd))))
+      return NULL;
+
+    memset(fds + ur->nfds, 0, (n - ur->nfds) * sizeof(LWSUringFd));
+    ur->fds = fds;
+    ur->nfds = n;
+  }
+
+  return &ur->fds[fd];
+}
+
+static void
+uring_submit(LWSUring* ur) {
+  int ret;
+
+  if(!ur->to_submit)
+    return;
+
+  __atomic_store_n(ur->sq_tail, ur->sq_local_tail, __ATOMIC_RELEASE);
+
+  if((ret = uring_enter(ur->ring_fd, ur->to_submit, 0)) > 0) {
+    ur->to_submit -= ret < (int)ur->to_submit ? ret : ur->to_submit;
+    ur->submitted += ret;
+  } else if(ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+    lwsl_err("io_uring_enter: %s", strerror(errno));
+  }
+}
+
+static struct io_uring_sqe*
+uring_sqe(LWSUring* ur) {
+  struct io_uring_sqe* sqe;
+  unsigned idx;
+
+  /* Ring full: hand what's queued to the kernel, which consumes it
+     synchronously (no SQPOLL), then there's room again. */
+  if(ur->sq_local_tail - __atomic_load_n(ur->sq_head, __ATOMIC_ACQUIRE) >= ur->sq_entries) {
+    uring_submit(ur);
+
+    if(ur->sq_local_tail - __atomic_load_n(ur->sq_head, __ATOMIC_ACQUIRE) >= ur->sq_entries)
+      return NULL;
+  }
+
+  idx = ur->sq_local_tail & *ur->sq_mask;
+  sqe = &ur->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  ur->sq_array[idx] = idx;
+  ur->sq_local_tail++;
+  ur->to_submit++;
+  return sqe;
+}
+
+static uint64_t
+uring_user_data(int fd, LWSUringFd* e) {
+  return ((uint64_t)e->gen << 32) | (uint32_t)fd;
+}
+
+/* Cancel fd's current poll (if any) and, if lws still wants events, arm a
+   fresh one. A fresh POLL_ADD checks readiness up front and completes
+   right away if the fd is ready already - which is also how a leftover
+   from uring_settle() gets picked up again. */
+static void
+uring_arm(LWSUring* ur, int fd, LWSUringFd* e) {
+  struct io_uring_sqe* sqe;
+  uint32_t events;
+
+  if(e->armed && (sqe = uring_sqe(ur))) {
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = uring_user_data(fd, e);
+    sqe->user_data = URING_CANCEL_DATA;
+  }
+
+  e->armed = FALSE;
+  e->gen++;
+
+  if(!(e->events & (POLLIN | POLLOUT)) || !(sqe = uring_sqe(ur)))
+    return;
+
+  events = e->events & (POLLIN | POLLOUT);
+#if __BYTE_ORDER == __BIG_ENDIAN
+  events = (events << 16) | (events >> 16);
+#endif
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = events;
+  sqe->len = ur->multishot ? IORING_POLL_ADD_MULTI : 0;
+  sqe->user_data = uring_user_data(fd, e);
+  e->armed = TRUE;
+  e->multi = ur->multishot;
+}
+
+/* Queues fd for uring_settle(). FALSE if the list couldn't grow - the
+   caller has to make sure the fd's readiness isn't lost some other way. */
+static BOOL
+uring_pending_add(LWSUring* ur, int fd, LWSUringFd* e) {
+  if(e->pending)
+    return TRUE;
+
+  if(ur->npending == ur->pending_size) {
+    int n = ur->pending_size ? ur->pending_size * 2 : 64;
+    int* pending;
+    struct pollfd* pollfds;
+
+    if(!(pending = js_realloc(ur->lws->js, ur->pending, n * sizeof(int))))
+      return FALSE;
+
+    ur->pending = pending;
+
+    if(!(pollfds = js_realloc(ur->lws->js, ur->pollfds, n * sizeof(struct pollfd))))
+      return FALSE;
+
+    ur->pollfds = pollfds;
+    ur->pending_size = n;
+  }
+
+  e->pending = TRUE;
+  ur->pending[ur->npending++] = fd;
+  return TRUE;
+}
+
+/* A multishot poll doesn't complete again for an fd that stays ready, so
+   one that couldn't be queued for uring_settle() gets a fresh POLL_ADD
+   once serviced, which completes straight away if it still is. */
+static void
+uring_service(LWSUring* ur, int fd, LWSUringFd* e, int revents) {
+  struct lws_pollfd pfd = {
+      .fd = fd,
+      .events = e->events,
+      .revents = revents,
+  };
+
+  if(revents & POLLERR)
+    pfd.revents = (revents & ~POLLERR) | POLLHUP;
+
+  BOOL queued = uring_pending_add(ur, fd, e);
+
+  lws_service_fd(ur->lws->ctx, &pfd);
+
+  if(!queued && (e = uring_fd_get(ur, fd)))
+    uring_arm(ur, fd, e);
+}
+
+/* One poll() over every fd serviced so far in this drain, re-servicing
+   those still ready, until none are or URING_SETTLE_PASSES runs out;
+   whatever is left is re-armed, so its fresh POLL_ADD completes straight
+   away and the next wakeup carries on with it. */
+static void
+uring_settle(LWSUring* ur) {
+  for(int pass = 0; ur->npending > 0; pass++) {
+    int i, n = 0, count = ur->npending;
+
+    for(i = 0; i < count; i++) {
+      int fd = ur->pending[i];
+      LWSUringFd* e;
+
+      if(fd < ur->nfds)
+        ur->fds[fd].pending = FALSE;
+
+      if(!(e = uring_fd_get(ur, fd)))
+        continue;
+
+      if(pass == URING_SETTLE_PASSES) {
+        uring_arm(ur, fd, e);
+        continue;
+      }
+
+      if(e->events & (POLLIN | POLLOUT))
+        ur->pollfds[n++] = (struct pollfd){.fd = fd, .events = e->events & (POLLIN | POLLOUT)};
+    }
+
+    ur->npending = 0;
+
+    if(pass == URING_SETTLE_PASSES || n == 0 || poll(ur->pollfds, n, 0) <= 0)
+      break;
+
+    for(i = 0; i < n; i++) {
+      LWSUringFd* e;
+      int revents;
+
+      if(!(e = uring_fd_get(ur, ur->pollfds[i].fd)))
+        continue;
+
+      if((revents = ur->pollfds[i].revents & (e->events | POLLHUP | POLLERR)))
+        uring_service(ur, ur->pollfds[i].fd, e, revents);
+    }
+  }
+}
+
+static void
+uring_complete(LWSUring* ur, uint64_t user_data, int32_t res, uint32_t flags) {
+  int fd = (int)(uint32_t)user_data;
+  LWSUringFd* e;
+
+  if(user_data == URING_CANCEL_DATA)
+    return;
+
+  /* Cancelled or re-armed since: a newer poll (or none) is in charge. */
+  if(!(e = uring_fd_get(ur, fd)) || e->gen != (uint32_t)(user_data >> 32))
+    return;
+
+  if(!(flags & IORING_CQE_F_MORE))
+    e->armed = FALSE;
+
+  if(res < 0) {
+    /* Pre-5.13 kernels reject IORING_POLL_ADD_MULTI - carry on one-shot. */
+    if(res == -EINVAL && e->multi) {
+      if(ur->multishot)
+        lwsl_notice("io_uring: no multishot poll, re-arming one-shot polls instead");
+
+      ur->multishot = FALSE;
+      uring_arm(ur, fd, e);
+    } else if(res != -ECANCELED) {
+      lwsl_warn("io_uring: poll on fd %d failed: %s", fd, strerror(-res));
+    }
+
+    return;
+  }
+
+  if(res & (e->events | POLLHUP | POLLERR))
+    uring_service(ur, fd, e, res & (e->events | POLLHUP | POLLERR));
+
+  /* One-shot completion (or multishot terminated by the kernel) and lws
+     still has the fd: arm it again. */
+  if((e = uring_fd_get(ur, fd)) && !e->armed)
+    uring_arm(ur, fd, e);
+}
+
+/* Services the completions present when the eventfd fired; any that land
+   while doing so bump the eventfd again and get the next wakeup. */
+static void
+uring_drain(LWSUring* ur) {
+  uint64_t count;
+  unsigned head, tail;
+
+  if(read(ur->event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+    lwsl_warn("io_uring: eventfd read: %s", strerror(errno));
+
+  /* Completions that didn't fit the CQ wait in the kernel until asked. */
+  if(__atomic_load_n(ur->sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW)
+    uring_enter(ur->ring_fd, 0, IORING_ENTER_GETEVENTS);
+
+  ur->draining = TRUE;
+
+  head = *ur->cq_head;
+  tail = __atomic_load_n(ur->cq_tail, __ATOMIC_ACQUIRE);
+
+  while(head != tail) {
+    struct io_uring_cqe* cqe = &ur->cqes[head & *ur->cq_mask];
+    uint64_t user_data = cqe->user_data;
+    int32_t res = cqe->res;
+    uint32_t flags = cqe->flags;
+
+    /* Release the slot before servicing, which may take a while. */
+    __atomic_store_n(ur->cq_head, ++head, __ATOMIC_RELEASE);
+    ur->completions++;
+
+    uring_complete(ur, user_data, res, flags);
+  }
+
+  uring_settle(ur);
+
+  ur->draining = FALSE;
+  uring_submit(ur);
+
+  /* Same as pollfd_handler(), once for the whole batch. */
+  lwsjs_service_forced(ur->lws);
+}
+
+static JSValue
+uring_readable(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int magic, void* opaque) {
+  uring_drain(opaque);
+  return JS_UNDEFINED;
+}
+
+static void
+uring_free(LWSUring* ur) {
+  JSContext* ctx = ur->lws->js;
+
+  if(ur->sqes)
+    munmap(ur->sqes, ur->sqes_size);
+  if(ur->ring)
+    munmap(ur->ring, ur->ring_size);
+  if(ur->event_fd >= 0)
+    close(ur->event_fd);
+  if(ur->ring_fd >= 0)
+    close(ur->ring_fd);
+
+  js_free(ctx, ur->fds);
+  js_free(ctx, ur->pending);
+  js_free(ctx, ur->pollfds);
+  js_free(ctx, ur);
+}
+
+int
+lws_uring_init(LWSContext* lws) {
+  struct io_uring_params p = {0};
+  LWSUring* ur;
+  size_t sq_size, cq_size;
+  uint8_t* ring;
+
+  if(!(ur = js_mallocz(lws->js, sizeof(LWSUring))))
+    return -1;
+
+  ur->lws = lws;
+  ur->ring_fd = ur->event_fd = -1;
+  ur->multishot = TRUE;
+
+  if((ur->ring_fd = uring_setup(lws->uring_entries > 0 ? lws->uring_entries : URING_ENTRIES_DEFAULT, &p)) < 0) {
+    lwsl_notice("io_uring_setup: %s", strerror(errno));
+    goto fail;
+  }
+
+  /* SQ and CQ rings in one mapping - 5.4+, same vintage as everything
+     else relied on here. */
+  if(!(p.features & IORING_FEAT_SINGLE_MMAP))
+    goto fail;
+
+  sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  ur->ring_size = sq_size > cq_size ? sq_size : cq_size;
+
+  if((ur->ring = mmap(NULL, ur->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->ring_fd, IORING_OFF_SQ_RING)) == MAP_FAILED) {
+    ur->ring = NULL;
+    goto fail;
+  }
+
+  ur->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+  if((ur->sqes = mmap(NULL, ur->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->ring_fd, IORING_OFF_SQES)) == MAP_FAILED) {
+    ur->sqes = NULL;
+    goto fail;
+  }
+
+  ring = ur->ring;
+  ur->sq_head = (unsigned*)(ring + p.sq_off.head);
+  ur->sq_tail = (unsigned*)(ring + p.sq_off.tail);
+  ur->sq_mask = (unsigned*)(ring + p.sq_off.ring_mask);
+  ur->sq_flags = (unsigned*)(ring + p.sq_off.flags);
+  ur->sq_array = (unsigned*)(ring + p.sq_off.array);
+  ur->sq_entries = p.sq_entries;
+  ur->sq_local_tail = *ur->sq_tail;
+  ur->cq_head = (unsigned*)(ring + p.cq_off.head);
+  ur->cq_tail = (unsigned*)(ring + p.cq_off.tail);
+  ur->cq_mask = (unsigned*)(ring + p.cq_off.ring_mask);
+  ur->cqes = (struct io_uring_cqe*)(ring + p.cq_off.cqes);
+
+  if((ur->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0)
+    goto fail;
+
+  if(uring_register(ur->ring_fd, IORING_REGISTER_EVENTFD, &ur->event_fd, 1) < 0) {
+    lwsl_notice("IORING_REGISTER_EVENTFD: %s", strerror(errno));
+    goto fail;
+  }
+
+  lws->uring = ur;
+
+  JSValue fn = js_function_cclosure(lws->js, uring_readable, 0, 0, ur, NULL);
+  iohandler_set(lws, ur->event_fd, fn, FALSE);
+  JS_FreeValue(lws->js, fn);
+
+  return 0;
+
+fail:
+  uring_free(ur);
+  return -1;
+}
+
+void
+lws_uring_ctl(LWSContext* lws, int fd, int events) {
+  LWSUring* ur;
+  LWSUringFd* e;
+
+  if(!(ur = lws->uring) || !(e = uring_fd_slot(ur, fd)))
+    return;
+
+  if(!e->registered) {
+    e->registered = TRUE;
+    e->armed = FALSE;
+  } else if(e->events == events && e->armed) {
+    return;
+  }
+
+  e->events = events;
+  uring_arm(ur, fd, e);
+
+  /* During a drain the SQEs go out in one batch at its end. */
+  if(!ur->draining)
+    uring_submit(ur);
+}
+
+void
+lws_uring_del(LWSContext* lws, int fd) {
+  LWSUring* ur;
+  LWSUringFd* e;
+
+  if(!(ur = lws->uring) || !(e = uring_fd_get(ur, fd)))
+    return;
+
+  e->events = 0;
+  uring_arm(ur, fd, e);
+  e->registered = FALSE;
+
+  if(!ur->draining)
+    uring_submit(ur);
+}
+
+JSValue
+lws_uring_stats(JSContext* ctx, LWSContext* lws) {
+  LWSUring* ur;
+  JSValue ret;
+
+  if(lws->poll_backend != POLL_BACKEND_IO_URING || !(ur = lws->uring))
+    return JS_NULL;
+
+  ret = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, ret, "submitted", JS_NewInt64(ctx, (int64_t)ur->submitted));
+  JS_SetPropertyStr(ctx, ret, "completions", JS_NewInt64(ctx, (int64_t)ur->completions));
+  JS_SetPropertyStr(ctx, ret, "entries", JS_NewUint32(ctx, ur->sq_entries));
+  JS_SetPropertyStr(ctx, ret, "multishot", JS_NewBool(ctx, ur->multishot));
+  return ret;
+}
+
+void
+lws_uring_destroy(LWSContext* lws) {
+  LWSUring* ur;
+
+  if(!(ur = lws->uring))
+    return;
+
+  iohandler_set(lws, ur->event_fd, JS_NULL, FALSE);
+
+  uring_free(ur);
+  lws->uring = NULL;
+}
+#endif /* defined(USE_IO_URING) */
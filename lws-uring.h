@@ -0,0 +1,34 @@
+#ifndef QJS_LWS_URING_H
+#define QJS_LWS_URING_H
+
+#ifdef USE_IO_URING
+
+#include "lws-context.h"
+
+/* Submission/completion ring size when the `uring_entries` option isn't
+   given. */
+#define URING_ENTRIES_DEFAULT 256
+
+/* Set up the LWSContext's io_uring instance and register its eventfd with
+   quickjs-libc. Returns -1 if io_uring isn't usable here (old kernel,
+   disabled by sysctl or seccomp) - the caller then falls back to epoll. */
+int lws_uring_init(LWSContext*);
+
+/* Arm (or re-arm with new interest) a multishot poll for fd (POLLIN/POLLOUT
+   bitmask). */
+void lws_uring_ctl(LWSContext*, int fd, int events);
+
+/* Cancel fd's poll. */
+void lws_uring_del(LWSContext*, int fd);
+
+/* { submitted, completions, entries, multishot }, or null if the context
+   doesn't use this backend. */
+JSValue lws_uring_stats(JSContext*, LWSContext*);
+
+/* Tear down the ring: unmap it, close the ring fd and the eventfd, and
+   unregister the eventfd's read handler. */
+void lws_uring_destroy(LWSContext*);
+
+#endif /* defined(USE_IO_URING) */
+
+#endif /* defined QJS_LWS_URING_H */
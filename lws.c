@@ -6,6 +6,7 @@
 #include "lws-protocol.h"
 #include "lws.h"
 #include "js-utils.h"
+#include "utf8.h"
 
 #ifdef LWSJS_PRECOMPILED
 struct bytecode {
@@ -178,90 +179,22 @@ decamelize(char* dst, size_t dlen, const char* src) {
 
 /* WHATWG Encoding Standard's UTF-8 decoder (non-fatal mode): replaces
    every malformed byte or byte sequence with U+FFFD instead of
-   rejecting the input, byte-range boundaries (including the 0xE0/0xED/
-   0xF0/0xF4 lead-byte special cases that rule out overlong encodings,
-   surrogate halves, and code points past U+10FFFF) taken directly from
-   the spec's decoder algorithm. Used by toString()'s noThrow mode. */
+   rejecting the input (utf8_decode_lossy(), utf8.h). Input that is valid
+   already - nearly all of it - goes to JS_NewStringLen() as it is,
+   without the 3x scratch copy. Used by toString()'s noThrow mode. */
 static JSValue
 lossy_utf8_decode(JSContext* ctx, const uint8_t* p, size_t n) {
   uint8_t* out;
-  size_t out_len = 0, i = 0, seen = 0, needed = 0;
-  uint32_t cp = 0;
-  uint8_t lower = 0x80, upper = 0xbf;
+  size_t out_len;
   JSValue ret;
 
-  if(n == 0)
-    return JS_NewStringLen(ctx, "", 0);
+  if(utf8_validate(p, n) == n)
+    return JS_NewStringLen(ctx, (const char*)p, n);
 
-  if(!(out = js_malloc(ctx, n * UTF8_CHAR_LEN_MAX)))
+  if(!(out = js_malloc(ctx, n * 3)))
     return JS_EXCEPTION;
 
-  while(i < n) {
-    uint8_t b = p[i];
-
-    if(!needed) {
-      if(b < 0x80) {
-        out_len += unicode_to_utf8(out + out_len, b);
-        ++i;
-        continue;
-      }
-
-      if(b >= 0xc2 && b <= 0xdf) {
-        needed = 1;
-        cp = b & 0x1f;
-      } else if(b >= 0xe0 && b <= 0xef) {
-        if(b == 0xe0)
-          lower = 0xa0;
-        else if(b == 0xed)
-          upper = 0x9f;
-        needed = 2;
-        cp = b & 0x0f;
-      } else if(b >= 0xf0 && b <= 0xf4) {
-        if(b == 0xf0)
-          lower = 0x90;
-        else if(b == 0xf4)
-          upper = 0x8f;
-        needed = 3;
-        cp = b & 0x07;
-      } else {
-        /* not a valid lead byte: consume it, emit U+FFFD */
-        out_len += unicode_to_utf8(out + out_len, 0xfffd);
-        ++i;
-        continue;
-      }
-
-      seen = 0;
-      ++i;
-      continue;
-    }
-
-    if(b < lower || b > upper) {
-      /* bad continuation byte: discard the sequence-so-far as a single
-         U+FFFD, but don't consume this byte - it's reprocessed as a
-         fresh potential lead byte on the next iteration. */
-      out_len += unicode_to_utf8(out + out_len, 0xfffd);
-      needed = seen = cp = 0;
-      lower = 0x80;
-      upper = 0xbf;
-      continue;
-    }
-
-    lower = 0x80;
-    upper = 0xbf;
-    cp = (cp << 6) | (b & 0x3f);
-    ++seen;
-    ++i;
-
-    if(seen == needed) {
-      out_len += unicode_to_utf8(out + out_len, cp);
-      needed = seen = cp = 0;
-    }
-  }
-
-  if(needed)
-    /* truncated multi-byte sequence at end of input */
-    out_len += unicode_to_utf8(out + out_len, 0xfffd);
-
+  out_len = utf8_decode_lossy(out, p, n);
   ret = JS_NewStringLen(ctx, (const char*)out, out_len);
   js_free(ctx, out);
   return ret;
@@ -301,6 +234,7 @@ enum {
   FUNCTION_TO_STRING,
   FUNCTION_TO_POINTER,
   FUNCTION_TO_ARRAYBUFFER,
+  FUNCTION_ENCODE_INTO,
   FUNCTION_LOGLEVEL,
   FUNCTION_WRITE,
   FUNCTION_PARSE_MAC,
@@ -474,27 +408,19 @@ lwsjs_functions(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst ar
         if(no_throw) {
           ret = lossy_utf8_decode(ctx, p, n);
         } else {
-          const uint8_t *ptr = p, *end = p + n;
-
-          while(ptr < end) {
-            const uint8_t* next;
-
-            if(unicode_from_utf8(ptr, end - ptr, &next) < 0) {
-              size_t offset = ptr - p, shown = MIN((size_t)(end - ptr), 4), i;
-              char bytes[3 * 4 + 1] = {0};
+          size_t offset = utf8_validate(p, n);
 
-              for(i = 0; i < shown; i++)
-                snprintf(bytes + i * 3, 4, "%02x ", ptr[i]);
+          if(offset < n) {
+            size_t shown = MIN(n - offset, 4), i;
+            char bytes[3 * 4 + 1] = {0};
 
-              ret = JS_ThrowTypeError(ctx, "invalid UTF-8 at offset %zu: %s", offset, bytes);
-              break;
-            }
-
-            ptr = next;
-          }
+            for(i = 0; i < shown; i++)
+              snprintf(bytes + i * 3, 4, "%02x ", p[offset + i]);
 
-          if(!JS_IsException(ret))
+            ret = JS_ThrowTypeError(ctx, "invalid UTF-8 at offset %zu: %s", offset, bytes);
+          } else {
             ret = JS_NewStringLen(ctx, (const char*)p, n);
+          }
         }
       }
 
@@ -539,6 +465,40 @@ lwsjs_functions(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst ar
       break;
     }
 
+    case FUNCTION_ENCODE_INTO: {
+      /* TextEncoder.encodeInto(): as much of the string as fits, in whole
+         characters, straight into the caller's buffer - only QuickJS's own
+         UTF-8 conversion of the string is allocated. */
+      size_t slen, dlen, ofs, written, read;
+      uint32_t n = 0;
+      const char* s;
+      uint8_t* dst;
+
+      /* Both conversions can run user code that detaches the buffer, so
+         its pointer is only taken once they are done. */
+      if(!(s = JS_ToCStringLen(ctx, &slen, argv[0])))
+        return JS_EXCEPTION;
+
+      if(argc > 2 && !JS_IsUndefined(argv[2]) && JS_ToUint32(ctx, &n, argv[2])) {
+        JS_FreeCString(ctx, s);
+        return JS_EXCEPTION;
+      }
+
+      if(!(dst = get_buffer(ctx, 1, &argv[1], &dlen))) {
+        JS_FreeCString(ctx, s);
+        return JS_ThrowTypeError(ctx, "argument 2 must be an ArrayBuffer or TypedArray");
+      }
+
+      ofs = MIN(n, dlen);
+      written = utf8_encode_into(dst + ofs, dlen - ofs, (const uint8_t*)s, slen, &read);
+      JS_FreeCString(ctx, s);
+
+      ret = JS_NewObject(ctx);
+      JS_SetPropertyStr(ctx, ret, "read", JS_NewInt64(ctx, read));
+      JS_SetPropertyStr(ctx, ret, "written", JS_NewInt64(ctx, written));
+      break;
+    }
+
     case FUNCTION_LOGLEVEL: {
       if(argc > 0) {
         lwsjs_loglevel = to_uint32(ctx, argv[0]);
@@ -704,6 +664,7 @@ static const JSCFunctionListEntry lws_funcs[] = {
     JS_CFUNC_MAGIC_DEF("visible", 1, lwsjs_functions, FUNCTION_VISIBLE),
     JS_CFUNC_MAGIC_DEF("toString", 1, lwsjs_functions, FUNCTION_TO_STRING),
     JS_CFUNC_MAGIC_DEF("toArrayBuffer", 1, lwsjs_functions, FUNCTION_TO_ARRAYBUFFER),
+    JS_CFUNC_MAGIC_DEF("encodeInto", 2, lwsjs_functions, FUNCTION_ENCODE_INTO),
     JS_CFUNC_MAGIC_DEF("toPointer", 1, lwsjs_functions, FUNCTION_TO_POINTER),
     JS_CFUNC_MAGIC_DEF("write", 2, lwsjs_functions, FUNCTION_WRITE),
     JS_CFUNC_MAGIC_DEF("parseMac", 1, lwsjs_functions, FUNCTION_PARSE_MAC),
@@ -1106,6 +1067,9 @@ lwsjs_init(JSContext* ctx, JSModuleDef* m) {
   lwsjs_vhost_init(ctx, m);
   lwsjs_socket_init(ctx, m);
   lwsjs_spa_init(ctx, m);
+  lwsjs_headers_init(ctx, m);
+  lwsjs_router_init(ctx, m);
+  lwsjs_byte_queue_init(ctx, m);
   lwsjs_sockaddr46_init(ctx, m);
 #ifdef LWS_WITH_TLS
   lwsjs_tls_certverify_init(ctx, m);
@@ -1135,6 +1099,9 @@ js_init_module(JSContext* ctx, const char* module_name) {
     JS_AddModuleExport(ctx, m, "LWSVhost");
     JS_AddModuleExport(ctx, m, "LWSSocket");
     JS_AddModuleExport(ctx, m, "LWSSPA");
+    JS_AddModuleExport(ctx, m, "LWSHeaders");
+    JS_AddModuleExport(ctx, m, "LWSRouter");
+    JS_AddModuleExport(ctx, m, "LWSByteQueue");
     JS_AddModuleExport(ctx, m, "LWSSockAddr46");
 #ifdef LWS_WITH_TLS
     JS_AddModuleExport(ctx, m, "X509Certificate");
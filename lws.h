@@ -35,6 +35,11 @@ size_t decamelize(char*, size_t, const char*);
 
 int lwsjs_html_process_args(JSContext*, struct lws_process_html_args*, int, JSValueConst[]);
 int lwsjs_spa_init(JSContext*, JSModuleDef*);
+int lwsjs_headers_init(JSContext*, JSModuleDef*);
+int lwsjs_router_init(JSContext*, JSModuleDef*);
+int lwsjs_byte_queue_init(JSContext*, JSModuleDef*);
+JSValue lwsjs_router_response(JSValueConst, const char*, size_t);
+uint32_t lwsjs_router_timeout(JSValueConst);
 void lwsjs_get_lws_callbacks(JSContext*, JSValueConst, JSValue[], size_t);
 
 int lwsjs_init(JSContext*, JSModuleDef*);
@@ -0,0 +1,351 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Segment radix tree behind LWSRouter (lws-router.c) - the path matcher
+   of App/Router (lib/lws/app.js) and serve()'s routes (lib/serve.js). A
+   pattern is split on '/' the way compilePath() splits it and each
+   segment becomes one edge: a literal (matched exactly), a ':param' (any
+   one non-empty segment, captured) or a '*' (one or more whole segments,
+   possibly empty - the uncaptured '.*' compilePath() emits). A match only
+   walks the edges that fit the path, with a binary search over each
+   node's sorted literal children, so its cost follows the path's depth
+   and not the number of routes. Routes keep the index they were added
+   under and router_match() returns the lowest one (>= from) that matches:
+   exactly what the first-match scans over the regex tables found. Kept
+   free of QuickJS/lws dependencies so tests/bench/bench-router.c can
+   build it on its own. */
+
+#define ROUTER_NONE UINT32_MAX
+#define ROUTER_MAX_PARAMS 32
+
+typedef struct {
+  uint32_t* items; /* route indices, ascending */
+  uint32_t count, size;
+} RouterList;
+
+typedef struct RouterNode {
+  char* label; /* the literal segment leading here */
+  uint32_t label_len;
+  struct RouterNode** statics; /* sorted by (label_len, label) */
+  uint32_t nstatics;
+  struct RouterNode *param, *wild;
+  RouterList ends;     /* routes whose whole path ends here (end = 1) */
+  RouterList prefixes; /* mounts whose prefix ends here (end = 0) */
+} RouterNode;
+
+typedef struct {
+  RouterNode root;
+  /* compilePath()'s special cases: a lone '*' (with or without a leading
+     '/') matches anything, '/' and '' only the root - or with end = 0
+     anything starting with '/'. */
+  RouterList all, root_end, root_prefix;
+  uint32_t count;
+} Router;
+
+typedef struct {
+  const char* ptr;
+  uint32_t len;
+} RouterSpan;
+
+typedef struct {
+  const RouterSpan* segs;
+  uint32_t nsegs, from, best, ncaps, *nout;
+  RouterSpan caps[ROUTER_MAX_PARAMS], *out;
+} RouterMatch;
+
+static inline int
+router_list_add(RouterList* l, uint32_t index) {
+  if(l->count == l->size) {
+    uint32_t size = l->size ? l->size * 2 : 4;
+    uint32_t* items;
+
+    if(!(items = realloc(l->items, size * sizeof(uint32_t))))
+      return -1;
+
+    l->items = items;
+    l->size = size;
+  }
+
+  l->items[l->count++] = index;
+  return 0;
+}
+
+/* Lowest index >= from in l, or ROUTER_NONE. */
+static inline uint32_t
+router_list_first(const RouterList* l, uint32_t from) {
+  uint32_t lo = 0, hi = l->count;
+
+  while(lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+
+    if(l->items[mid] < from)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo < l->count ? l->items[lo] : ROUTER_NONE;
+}
+
+static inline int
+router_label_cmp(const RouterNode* n, const char* s, uint32_t len) {
+  if(n->label_len != len)
+    return n->label_len < len ? -1 : 1;
+
+  return memcmp(n->label, s, len);
+}
+
+/* Position of the literal child labelled s in n->statics - or, if there's
+   none, where it would go. */
+static inline uint32_t
+router_search(const RouterNode* n, const char* s, uint32_t len, int* found) {
+  uint32_t lo = 0, hi = n->nstatics;
+
+  *found = 0;
+
+  while(lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    int r = router_label_cmp(n->statics[mid], s, len);
+
+    if(r == 0) {
+      *found = 1;
+      return mid;
+    }
+
+    if(r < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+static inline RouterNode*
+router_child(RouterNode* n, const char* s, uint32_t len) {
+  RouterNode *c, **statics;
+  uint32_t pos;
+  int found;
+
+  if(len == 1 && s[0] == '*')
+    return n->wild ? n->wild : (n->wild = calloc(1, sizeof(RouterNode)));
+
+  if(len > 0 && s[0] == ':')
+    return n->param ? n->param : (n->param = calloc(1, sizeof(RouterNode)));
+
+  pos = router_search(n, s, len, &found);
+
+  if(found)
+    return n->statics[pos];
+
+  if(!(c = calloc(1, sizeof(RouterNode))))
+    return NULL;
+
+  if(!(statics = realloc(n->statics, (n->nstatics + 1) * sizeof(RouterNode*))) || !(c->label = malloc(len + 1))) {
+    if(statics)
+      n->statics = statics;
+
+    free(c);
+    return NULL;
+  }
+
+  memcpy(c->label, s, len);
+  c->label[len] = '\0';
+  c->label_len = len;
+
+  n->statics = statics;
+  memmove(&statics[pos + 1], &statics[pos], (n->nstatics - pos) * sizeof(RouterNode*));
+  statics[pos] = c;
+  n->nstatics++;
+  return c;
+}
+
+/* Adds pattern as the next route - a whole-path one if end, else a mount
+   prefix that also matches anything below it, as compilePath(pattern,
+   end) would. Returns its index, or -1 when out of memory or pattern has
+   more than ROUTER_MAX_PARAMS ':param' segments. */
+static inline int64_t
+router_add(Router* r, const char* pattern, uint32_t len, int end) {
+  RouterNode* n = &r->root;
+  RouterList* l;
+  uint32_t start = 0, params = 0;
+
+  if((len == 1 && pattern[0] == '*') || (len == 2 && pattern[0] == '/' && pattern[1] == '*')) {
+    l = &r->all;
+  } else if(len == 0 || (len == 1 && pattern[0] == '/')) {
+    l = end ? &r->root_end : &r->root_prefix;
+  } else {
+    for(uint32_t i = 0; i <= len; i++) {
+      if(i < len && pattern[i] != '/')
+        continue;
+
+      if(i > start && pattern[start] == ':' && ++params > ROUTER_MAX_PARAMS)
+        return -1;
+
+      if(!(n = router_child(n, pattern + start, i - start)))
+        return -1;
+
+      start = i + 1;
+    }
+
+    l = end ? &n->ends : &n->prefixes;
+  }
+
+  if(router_list_add(l, r->count))
+    return -1;
+
+  return r->count++;
+}
+
+/* Takes the lowest route in l as the best match so far, along with the
+   params captured on the way to it. Returns 1 once nothing can beat it. */
+static inline int
+router_consider(RouterMatch* m, const RouterList* l) {
+  uint32_t index = router_list_first(l, m->from);
+
+  if(index < m->best) {
+    m->best = index;
+    memcpy(m->out, m->caps, m->ncaps * sizeof(RouterSpan));
+    *m->nout = m->ncaps;
+  }
+
+  return m->best == m->from;
+}
+
+/* Depth-first over every branch of n that fits segs[i..]: literal, then
+   ':param', then '*' - the latter trying the longest run of segments
+   first, as the greedy '.*' would. */
+static inline int
+router_walk(RouterMatch* m, const RouterNode* n, uint32_t i) {
+  const RouterSpan* s;
+  RouterNode* c;
+  uint32_t pos;
+  int found;
+
+  /* '/?$' lets one trailing '/' (an empty last segment) through. */
+  if(i == m->nsegs || (i + 1 == m->nsegs && m->segs[i].len == 0))
+    if(router_consider(m, &n->ends))
+      return 1;
+
+  /* '(?:/|$)' - a mount matches whatever follows it. */
+  if(router_consider(m, &n->prefixes))
+    return 1;
+
+  if(i == m->nsegs)
+    return 0;
+
+  s = &m->segs[i];
+  pos = router_search(n, s->ptr, s->len, &found);
+
+  if(found && router_walk(m, n->statics[pos], i + 1))
+    return 1;
+
+  if(n->param && s->len > 0) {
+    int done;
+
+    m->caps[m->ncaps++] = *s;
+    done = router_walk(m, n->param, i + 1);
+    m->ncaps--;
+
+    if(done)
+      return 1;
+  }
+
+  if(n->wild)
+    for(c = n->wild, pos = m->nsegs; pos > i; pos--)
+      if(router_walk(m, c, pos))
+        return 1;
+
+  return 0;
+}
+
+/* The lowest-indexed route >= from matching path, or ROUTER_NONE. Its
+   ':param' captures (slices of path, in pattern order) go to caps and
+   their count to *ncaps. */
+static inline uint32_t
+router_match(const Router* r, const char* path, uint32_t len, uint32_t from, RouterSpan caps[ROUTER_MAX_PARAMS], uint32_t* ncaps) {
+  RouterSpan stack[64], *segs = stack;
+  RouterMatch m = {0};
+  uint32_t nsegs = 1, start = 0;
+
+  *ncaps = 0;
+  m.from = from;
+  m.best = router_list_first(&r->all, from);
+  m.out = caps;
+  m.nout = ncaps;
+
+  if(m.best == from)
+    return m.best;
+
+  if(len == 0 || (len == 1 && path[0] == '/'))
+    router_consider(&m, &r->root_end);
+
+  if(len > 0 && path[0] == '/')
+    router_consider(&m, &r->root_prefix);
+
+  if(m.best == from)
+    return m.best;
+
+  for(uint32_t i = 0; i < len; i++)
+    if(path[i] == '/')
+      nsegs++;
+
+  if(nsegs > sizeof(stack) / sizeof(stack[0]) && !(segs = malloc(nsegs * sizeof(RouterSpan))))
+    return ROUTER_NONE;
+
+  nsegs = 0;
+
+  for(uint32_t i = 0; i <= len; i++)
+    if(i == len || path[i] == '/') {
+      segs[nsegs].ptr = path + start;
+      segs[nsegs++].len = i - start;
+      start = i + 1;
+    }
+
+  m.segs = segs;
+  m.nsegs = nsegs;
+  router_walk(&m, &r->root, 0);
+
+  if(segs != stack)
+    free(segs);
+
+  return m.best;
+}
+
+static inline void
+router_node_free(RouterNode* n) {
+  for(uint32_t i = 0; i < n->nstatics; i++) {
+    router_node_free(n->statics[i]);
+    free(n->statics[i]);
+  }
+
+  if(n->param) {
+    router_node_free(n->param);
+    free(n->param);
+  }
+
+  if(n->wild) {
+    router_node_free(n->wild);
+    free(n->wild);
+  }
+
+  free(n->statics);
+  free(n->label);
+  free(n->ends.items);
+  free(n->prefixes.items);
+}
+
+static inline void
+router_free(Router* r) {
+  router_node_free(&r->root);
+  free(r->all.items);
+  free(r->root_end.items);
+  free(r->root_prefix.items);
+  memset(r, 0, sizeof(*r));
+}
+
+#endif /* defined ROUTER_H */
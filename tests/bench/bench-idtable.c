@@ -0,0 +1,82 @@
+/*
+ * Micro-benchmark for the LWSSocket.get(id) index (idtable.h): average
+ * lookup cost with 100 up to 100000 live entries, next to the linear
+ * socket_list walk it replaced. The hash lookup should stay flat as the
+ * table grows; the list walk grows with it.
+ *
+ *   cc -O2 -I. tests/bench/bench-idtable.c -o bench-idtable && ./bench-idtable
+ */
+#include <stdio.h>
+#include <time.h>
+#include "idtable.h"
+
+typedef struct Node {
+  struct Node* next;
+  uint32_t id;
+} Node;
+
+static double
+now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Node*
+list_get(Node* head, uint32_t id) {
+  for(Node* n = head; n; n = n->next)
+    if(n->id == id)
+      return n;
+
+  return NULL;
+}
+
+int
+main(void) {
+  static const uint32_t counts[] = {100, 1000, 10000, 100000};
+
+  printf("%8s %14s %14s\n", "sockets", "idtable ns/op", "list ns/op");
+
+  for(size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    uint32_t n = counts[c], lookups = 1000000, list_lookups = 100000000 / n;
+    Node* nodes = calloc(n, sizeof(Node));
+    Node* head = NULL;
+    IdTable t = {0};
+    uintptr_t sink = 0;
+    double t0, t1, t2;
+
+    /* Interleave some removals so there are tombstones to probe past, the
+       way closed connections leave them behind. */
+    for(uint32_t i = 0; i < n; i++) {
+      nodes[i].id = i + 1;
+      nodes[i].next = head;
+      head = &nodes[i];
+      idtable_put(&t, nodes[i].id, &nodes[i]);
+
+      if(i % 4 == 3) {
+        idtable_remove(&t, nodes[i - 1].id);
+        idtable_put(&t, nodes[i - 1].id, &nodes[i - 1]);
+      }
+    }
+
+    t0 = now();
+
+    for(uint32_t i = 0; i < lookups; i++)
+      sink += (uintptr_t)idtable_get(&t, (i * 7919u) % n + 1);
+
+    t1 = now();
+
+    for(uint32_t i = 0; i < list_lookups; i++)
+      sink += (uintptr_t)list_get(head, (i * 7919u) % n + 1);
+
+    t2 = now();
+
+    printf("%8u %14.1f %14.1f%s\n", n, (t1 - t0) * 1e9 / lookups, (t2 - t1) * 1e9 / list_lookups, sink ? "" : " ");
+
+    idtable_free(&t);
+    free(nodes);
+  }
+
+  return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Micro-benchmark for the LWSRouter radix tree (router.h): average cost of
+ * matching a request path against 10, 100 and 1000 routes, next to the
+ * first-match scan over one regex per route that App/Router and serve()'s
+ * routes used to do (POSIX regexes here, compiled the way compilePath()
+ * builds its RegExps). The tree should stay roughly flat as routes are
+ * added; the scan grows with them.
+ *
+ *   cc -O2 -I. tests/bench/bench-router.c -o bench-router && ./bench-router
+ */
+#include <regex.h>
+#include <stdio.h>
+#include <time.h>
+#include "router.h"
+
+static double
+now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* A mix of the shapes real route tables have: static paths, one and two
+   :params, and a trailing wildcard. */
+static void
+route(char* pattern, char* regex, char* path, size_t size, uint32_t i) {
+  switch(i % 4) {
+    case 0:
+      snprintf(pattern, size, "/api/v1/res%u", i);
+      snprintf(regex, size, "^/api/v1/res%u/?$", i);
+      snprintf(path, size, "/api/v1/res%u", i);
+      break;
+    case 1:
+      snprintf(pattern, size, "/api/v1/res%u/:id", i);
+      snprintf(regex, size, "^/api/v1/res%u/([^/]+)/?$", i);
+      snprintf(path, size, "/api/v1/res%u/42", i);
+      break;
+    case 2:
+      snprintf(pattern, size, "/users%u/:user/posts/:post", i);
+      snprintf(regex, size, "^/users%u/([^/]+)/posts/([^/]+)/?$", i);
+      snprintf(path, size, "/users%u/alice/posts/7", i);
+      break;
+    case 3:
+      snprintf(pattern, size, "/static%u/*", i);
+      snprintf(regex, size, "^/static%u/.*/?$", i);
+      snprintf(path, size, "/static%u/css/site.css", i);
+      break;
+  }
+}
+
+int
+main(void) {
+  static const uint32_t counts[] = {10, 100, 1000};
+
+  printf("%8s %14s %14s\n", "routes", "radix ns/op", "regex ns/op");
+
+  for(size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    uint32_t n = counts[c], lookups = 1000000, scan_lookups = 10000000 / n;
+    regex_t* regexes = calloc(n, sizeof(regex_t));
+    char(*paths)[64] = calloc(n, 64);
+    Router r = {0};
+    RouterSpan caps[ROUTER_MAX_PARAMS];
+    regmatch_t groups[3];
+    uint32_t ncaps;
+    uintptr_t sink = 0;
+    double t0, t1, t2;
+
+    for(uint32_t i = 0; i < n; i++) {
+      char pattern[64], regex[64];
+
+      route(pattern, regex, paths[i], 64, i);
+      router_add(&r, pattern, strlen(pattern), 1);
+      regcomp(&regexes[i], regex, REG_EXTENDED);
+    }
+
+    t0 = now();
+
+    for(uint32_t i = 0; i < lookups; i++) {
+      const char* path = paths[(i * 7919u) % n];
+
+      sink += router_match(&r, path, strlen(path), 0, caps, &ncaps);
+    }
+
+    t1 = now();
+
+    for(uint32_t i = 0; i < scan_lookups; i++) {
+      const char* path = paths[(i * 7919u) % n];
+
+      for(uint32_t j = 0; j < n; j++)
+        if(regexec(&regexes[j], path, 3, groups, 0) == 0) {
+          sink += j;
+          break;
+        }
+    }
+
+    t2 = now();
+
+    printf("%8u %14.1f %14.1f%s\n", n, (t1 - t0) * 1e9 / lookups, (t2 - t1) * 1e9 / scan_lookups, sink ? "" : " ");
+
+    for(uint32_t i = 0; i < n; i++)
+      regfree(&regexes[i]);
+
+    router_free(&r);
+    free(regexes);
+    free(paths);
+  }
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Throughput benchmark for the WHATWG streams implementation
+ * (lib/lws/streams.js): chunks/sec for 1e5 to 1e6 chunk pipelines, both
+ * readable.pipeTo(writable) and through an identity TransformStream. The
+ * source enqueues every chunk up front, so the readable's queue is as
+ * deep as the pipeline is long - the case an Array.prototype.shift()-
+ * based queue turns quadratic on. The last table is the queue on its
+ * own: SimpleQueue (lib/lws/simple-queue.js, what every stream-internal
+ * queue is) against a plain array drained with shift().
+ *
+ *   qjsm tests/bench/bench-streams.js
+ */
+import { ReadableStream, WritableStream, TransformStream } from '../../lib/lws/streams.js';
+import { SimpleQueue } from '../../lib/lws/simple-queue.js';
+
+const COUNTS = [100000, 300000, 1000000];
+
+function source(n) {
+  return new ReadableStream(
+    {
+      start(controller) {
+        for(let i = 0; i < n; i++) controller.enqueue(i);
+
+        controller.close();
+      },
+    },
+    { highWaterMark: n },
+  );
+}
+
+function sink() {
+  const counter = { count: 0 };
+
+  counter.stream = new WritableStream({
+    write() {
+      counter.count++;
+    },
+  });
+
+  return counter;
+}
+
+async function pipeTo(n) {
+  const out = sink();
+
+  await source(n).pipeTo(out.stream);
+
+  if(out.count !== n) throw new Error(`pipeTo: ${out.count} of ${n} chunks arrived`);
+}
+
+async function transform(n) {
+  const out = sink();
+
+  await source(n)
+    .pipeThrough(
+      new TransformStream({
+        transform(chunk, controller) {
+          controller.enqueue(chunk);
+        },
+      }),
+    )
+    .pipeTo(out.stream);
+
+  if(out.count !== n) throw new Error(`TransformStream: ${out.count} of ${n} chunks arrived`);
+}
+
+function queue(n, q) {
+  let sum = 0;
+
+  for(let i = 0; i < n; i++) q.push(i);
+
+  while(q.length > 0) sum += q.shift();
+
+  return sum;
+}
+
+async function time(fn) {
+  const t0 = Date.now();
+
+  await fn();
+
+  return Math.max(Date.now() - t0, 1) / 1000;
+}
+
+function row(...cells) {
+  return cells.map((c, i) => String(c)[i ? 'padStart' : 'padEnd'](i ? 16 : 8)).join(' ');
+}
+
+console.log(row('chunks', 'pipeTo chunk/s', 'transform chunk/s'));
+
+for(const n of COUNTS) console.log(row(n, Math.round(n / (await time(() => pipeTo(n)))), Math.round(n / (await time(() => transform(n))))));
+
+console.log('\n' + row('items', 'SimpleQueue op/s', 'Array op/s'));
+
+for(const n of COUNTS) console.log(row(n, Math.round(n / (await time(() => queue(n, new SimpleQueue())))), Math.round(n / (await time(() => queue(n, []))))));
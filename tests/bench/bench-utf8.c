@@ -0,0 +1,219 @@
+/*
+ * Micro-benchmark for utf8.h, the UTF-8 scanning behind toString() and
+ * encodeInto() (lws.c): throughput of validation (toString()'s strict
+ * mode) and of the lossy WHATWG decode (toString(buf, true)) over ASCII,
+ * mixed (mostly ASCII with 2-4 byte characters) and invalid (mixed with a
+ * stray 0xff every 97 bytes) inputs from 1 KB to 10 MB, next to the
+ * character-at-a-time loops they replaced. The ASCII and mixed rows
+ * should show the vector scan; invalid input mostly takes the same path
+ * as mixed. Validation stops at the first error, so there's no
+ * validate figure for invalid input.
+ *
+ *   cc -O2 -I. tests/bench/bench-utf8.c -o bench-utf8 && ./bench-utf8
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "utf8.h"
+
+static double
+now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t
+put_utf8(uint8_t* out, uint32_t c) {
+  if(c < 0x80) {
+    out[0] = c;
+    return 1;
+  }
+
+  if(c < 0x800) {
+    out[0] = 0xc0 | (c >> 6);
+    out[1] = 0x80 | (c & 0x3f);
+    return 2;
+  }
+
+  if(c < 0x10000) {
+    out[0] = 0xe0 | (c >> 12);
+    out[1] = 0x80 | ((c >> 6) & 0x3f);
+    out[2] = 0x80 | (c & 0x3f);
+    return 3;
+  }
+
+  out[0] = 0xf0 | (c >> 18);
+  out[1] = 0x80 | ((c >> 12) & 0x3f);
+  out[2] = 0x80 | ((c >> 6) & 0x3f);
+  out[3] = 0x80 | (c & 0x3f);
+  return 4;
+}
+
+/* The strict loop toString() used to run: one sequence per iteration. */
+static size_t
+old_validate(const uint8_t* p, size_t n) {
+  size_t i = 0, len, valid;
+
+  while(i < n) {
+    if(p[i] < 0x80)
+      len = 1;
+    else if(!(len = utf8_sequence(p + i, n - i, &valid)))
+      return i;
+
+    i += len;
+  }
+
+  return n;
+}
+
+/* The byte-at-a-time state machine lossy_utf8_decode() used to be. */
+static size_t
+old_decode_lossy(uint8_t* out, const uint8_t* p, size_t n) {
+  size_t out_len = 0, i = 0, seen = 0, needed = 0;
+  uint32_t cp = 0;
+  uint8_t lower = 0x80, upper = 0xbf;
+
+  while(i < n) {
+    uint8_t b = p[i];
+
+    if(!needed) {
+      if(b < 0x80) {
+        out_len += put_utf8(out + out_len, b);
+        ++i;
+        continue;
+      }
+
+      if(b >= 0xc2 && b <= 0xdf) {
+        needed = 1;
+        cp = b & 0x1f;
+      } else if(b >= 0xe0 && b <= 0xef) {
+        if(b == 0xe0)
+          lower = 0xa0;
+        else if(b == 0xed)
+          upper = 0x9f;
+        needed = 2;
+        cp = b & 0x0f;
+      } else if(b >= 0xf0 && b <= 0xf4) {
+        if(b == 0xf0)
+          lower = 0x90;
+        else if(b == 0xf4)
+          upper = 0x8f;
+        needed = 3;
+        cp = b & 0x07;
+      } else {
+        out_len += put_utf8(out + out_len, 0xfffd);
+        ++i;
+        continue;
+      }
+
+      seen = 0;
+      ++i;
+      continue;
+    }
+
+    if(b < lower || b > upper) {
+      out_len += put_utf8(out + out_len, 0xfffd);
+      needed = seen = cp = 0;
+      lower = 0x80;
+      upper = 0xbf;
+      continue;
+    }
+
+    lower = 0x80;
+    upper = 0xbf;
+    cp = (cp << 6) | (b & 0x3f);
+    ++seen;
+    ++i;
+
+    if(seen == needed) {
+      out_len += put_utf8(out + out_len, cp);
+      needed = seen = cp = 0;
+    }
+  }
+
+  if(needed)
+    out_len += put_utf8(out + out_len, 0xfffd);
+
+  return out_len;
+}
+
+/* ASCII text, with every 40th character swapped for one of 2, 3 or 4
+   bytes in "mixed", and a 0xff every 97 bytes on top in "invalid". */
+static void
+fill(uint8_t* buf, size_t n, int kind) {
+  static const uint32_t wide[] = {0xe9, 0x20ac, 0x1f600};
+  size_t i = 0, k = 0;
+
+  while(i < n) {
+    if(kind && k % 40 == 39 && i + 4 <= n)
+      i += put_utf8(buf + i, wide[k / 40 % 3]);
+    else
+      buf[i++] = 'a' + k % 26;
+
+    if(kind == 2 && i % 97 == 0 && i < n)
+      buf[i++] = 0xff;
+
+    k++;
+  }
+}
+
+int
+main(void) {
+  static const size_t sizes[] = {1024, 64 * 1024, 1024 * 1024, 10 * 1024 * 1024};
+  static const char* const kinds[] = {"ascii", "mixed", "invalid"};
+
+  printf("%-8s %9s %15s %15s %15s %15s\n", "input", "size", "validate MB/s", "(old) MB/s", "lossy MB/s", "(old) MB/s");
+
+  for(int kind = 0; kind < 3; kind++)
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      size_t n = sizes[s], rounds = (256 * 1024 * 1024) / n, sink = 0;
+      uint8_t *buf = malloc(n), *out = malloc(3 * n);
+      double t[5];
+
+      fill(buf, n, kind);
+
+      if(old_decode_lossy(out, buf, n) != utf8_decode_lossy(out, buf, n) || old_validate(buf, n) != utf8_validate(buf, n)) {
+        fprintf(stderr, "%s/%zu: results differ\n", kinds[kind], n);
+        return 1;
+      }
+
+      t[0] = now();
+
+      for(size_t r = 0; r < rounds; r++)
+        sink += utf8_validate(buf, n);
+
+      t[1] = now();
+
+      for(size_t r = 0; r < rounds; r++)
+        sink += old_validate(buf, n);
+
+      t[2] = now();
+
+      for(size_t r = 0; r < rounds; r++)
+        sink += utf8_decode_lossy(out, buf, n);
+
+      t[3] = now();
+
+      for(size_t r = 0; r < rounds; r++)
+        sink += old_decode_lossy(out, buf, n);
+
+      t[4] = now();
+
+      printf("%-8s %9zu", kinds[kind], n);
+
+      for(int i = 0; i < 4; i++)
+        if(kind == 2 && i < 2)
+          printf(" %15s", "-");
+        else
+          printf(" %15.0f", (double)n * rounds / (t[i + 1] - t[i]) / 1e6);
+
+      printf("%s\n", sink ? "" : " ");
+
+      free(buf);
+      free(out);
+    }
+
+  return 0;
+}
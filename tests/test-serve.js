@@ -24,7 +24,7 @@ import { URL } from '../lib/lws/url.js';
 import { generateSelfSignedCert } from '../lib/lws/tls.js';
 import { tests, assert, assertStrictEquals as eq } from './unittests/tinytest.js';
 import { toString, logLevel, LLL_ERR, LLL_USER, LWSMPRO_CALLBACK } from 'lws.so';
-import { TextDecoder } from 'textcode';
+import { TextDecoder, TextEncoder } from 'textcode';
 import * as std from 'std';
 
 logLevel(LLL_ERR | LLL_USER);
@@ -232,6 +232,27 @@ const TESTS = {
     server.stop();
   },
 
+  async 'callback mode: streamed chunks are framed by UTF-8 byte length, empty ones skipped'() {
+    const port = nextPort();
+    const chunks = ['héllo ', '', 'wörld ', new TextEncoder().encode('€'), ''];
+    const server = serve({
+      port,
+      hostname: 'localhost',
+      fetch: () =>
+        new Response(
+          (async function* () {
+            yield* chunks;
+          })(),
+        ),
+    });
+
+    const resp = await fetch(`http://127.0.0.1:${port}/`);
+    eq('chunked', resp.headers.get('transfer-encoding'));
+    eq('héllo wörld €', await resp.text());
+
+    server.stop();
+  },
+
   // Note: options.headers (LWS_CALLBACK_ADD_HEADERS) is *not* covered here -
   // confirmed separately (against the raw createServer() API, bypassing
   // serve() entirely) that onAddHeaders simply never fires for a
@@ -0,0 +1,113 @@
+/**
+ * Tests LWSByteQueue (lws-byte-queue.c) and the promise-based ByteQueue on
+ * top of it (lib/lws/byte-queue.js): that pushed chunks are kept by
+ * reference and read back as views when a read fits in one, that reads
+ * spanning chunks merge them (once), and that indexOf()/readUntil() find
+ * delimiters split across chunk boundaries.
+ */
+import { tests, eq, assert, assertStrictEquals } from './tinytest.js';
+import { LWSByteQueue, toString } from 'lws.so';
+import { ByteQueue } from '../../lib/lws/byte-queue.js';
+import { TextEncoder } from 'textcode';
+
+const text = u8 => toString(u8.buffer, u8.byteOffset, u8.byteLength);
+
+function queue(...chunks) {
+  const q = new LWSByteQueue();
+
+  for(const chunk of chunks) q.push(typeof chunk === 'string' ? new TextEncoder().encode(chunk) : chunk);
+
+  return q;
+}
+
+await tests({
+  'push() keeps chunks by reference, read() returns views onto them'() {
+    const chunk = new TextEncoder().encode('hello world');
+    const q = queue(chunk);
+
+    eq(11, q.length);
+
+    const hello = q.read(5);
+
+    assertStrictEquals(chunk.buffer, hello.buffer);
+    eq('hello', text(hello));
+    eq(6, q.length);
+    eq(' world', text(q.read()));
+    eq(0, q.length);
+    eq(0, q.segments);
+  },
+
+  'read()/peek() return null when fewer bytes are queued'() {
+    const q = queue('abc');
+
+    assertStrictEquals(null, q.read(4));
+    assertStrictEquals(null, q.peek(4));
+    eq(3, q.length);
+    eq(0, q.read(0).length);
+  },
+
+  'a read spanning chunks merges them into one segment'() {
+    const q = queue('ab', 'cd', 'ef', 'gh');
+
+    eq(4, q.segments);
+    eq('abc', text(q.peek(3)));
+    eq(3, q.segments);
+    eq('abcd', text(q.read(4)));
+    eq(2, q.segments);
+    eq('efgh', text(q.read(4)));
+  },
+
+  'indexOf() finds bytes, strings and buffers across chunk boundaries'() {
+    const q = queue('GET / HTTP/1.1\r', '\n', 'Host: x\r\n\r', '\nbody');
+
+    eq(14, q.indexOf('\r\n'));
+    eq(14, q.indexOf(13));
+    eq(23, q.indexOf('\r\n', 15));
+    eq(23, q.indexOf(new TextEncoder().encode('\r\n\r\n')));
+    eq(-1, q.indexOf('\n\n'));
+    eq(0, q.indexOf('G'));
+  },
+
+  'readUntil() consumes through the delimiter, or returns null'() {
+    const q = queue('line one\r', '\nline ', 'two\r\npartial');
+
+    eq('line one\r\n', text(q.readUntil('\r\n')));
+    eq('line two\r\n', text(q.readUntil('\r\n')));
+    assertStrictEquals(null, q.readUntil('\r\n'));
+    eq('partial', text(q.read()));
+  },
+
+  'skip() and clear() drop bytes'() {
+    const q = queue('abc', 'def');
+
+    eq(4, q.skip(4));
+    eq('ef', text(q.peek()));
+    q.clear();
+    eq(0, q.length);
+    eq(0, q.skip(1));
+  },
+
+  'strings and plain ArrayBuffers can be pushed too'() {
+    const q = new LWSByteQueue();
+
+    q.push('é', new TextEncoder().encode('!').buffer);
+    eq(3, q.length);
+    eq('é!', text(q.read()));
+  },
+
+  async 'ByteQueue resolves read() and readUntil() as bytes arrive'() {
+    const bq = new ByteQueue();
+    const header = bq.read(4);
+
+    bq.feed(new TextEncoder().encode('00').buffer);
+    bq.feed(new TextEncoder().encode('05hello\n').buffer);
+
+    eq('0005', text(await header));
+    eq('hello\n', text(await bq.readUntil('\n')));
+
+    const pending = bq.read(1);
+
+    bq.close();
+    assertStrictEquals(null, await pending);
+  },
+});
@@ -9,8 +9,9 @@
  * protocol-matrix coverage.
  */
 import { tests, eq, assert, assertStrictEquals } from './tinytest.js';
-import { createServer, toString, LWSMPRO_CALLBACK, LWS_WRITE_HTTP_FINAL } from 'lws.so';
+import { createServer, toString, LWSSocket, LWSMPRO_CALLBACK, LWS_WRITE_HTTP_FINAL } from 'lws.so';
 import { fetch } from '../../lib/fetch.js';
+import { ServerRequest } from '../../lib/lws/request.js';
 import { freePort } from './subprocess-utils.js';
 import * as std from 'std';
 
@@ -66,6 +67,56 @@ await tests({
     server.destroy();
   },
 
+  async 'wsi.header() reads single request headers case-insensitively'() {
+    const port = freePort();
+    let seen;
+
+    const server = echoServer(port, wsi => {
+      seen = [wsi.header('Content-Type'), wsi.header('x-custom'), wsi.header('x-absent'), wsi.headers['x-custom'], wsi.header('X-Custom')];
+      wsi.respond(200, { 'content-length': '2' });
+      wsi.write('ok', LWS_WRITE_HTTP_FINAL);
+    });
+
+    await fetch(`http://127.0.0.1:${port}/`, {
+      method: 'POST',
+      body: 'x',
+      headers: { 'content-type': 'text/plain', 'x-custom': 'yes' },
+      keepAlive: false,
+    });
+
+    const [contentType, custom, absent, fromObject, upperCase] = seen;
+    eq('text/plain', contentType);
+    eq('yes', custom);
+    assertStrictEquals(null, absent);
+    eq('yes', fromObject);
+    eq('yes', upperCase);
+
+    server.destroy();
+  },
+
+  async 'ServerRequest.headers read after the response completed still has that request\'s headers'() {
+    // Nothing reads req.headers while the request is handled: by the time
+    // it is read, the response is out, lws has released the header table,
+    // and on a keep-alive connection the same wsi has had the next request.
+    const port = freePort();
+    const reqs = [];
+
+    const server = echoServer(port, wsi => {
+      reqs.push(new ServerRequest(wsi));
+      wsi.respond(200, { 'content-length': '2' });
+      wsi.write('ok', LWS_WRITE_HTTP_FINAL);
+    });
+
+    for(const n of ['0', '1']) await (await fetch(`http://127.0.0.1:${port}/`, { headers: { 'x-n': n } })).text();
+
+    eq(2, reqs.length);
+    eq('0', reqs[0].headers['x-n']);
+    eq('1', reqs[1].headers['x-n']);
+    eq('0', reqs[0].toHeaders().get('x-n'));
+
+    server.destroy();
+  },
+
   async 'fetch(): a POST body arrives at the server byte-for-byte'() {
     const port = freePort();
     const chunks = [];
@@ -112,6 +163,69 @@ await tests({
     server.destroy();
   },
 
+  async 'fetch(): respond() with a compiled header block sends its headers on every response'() {
+    const port = freePort();
+    const block = LWSSocket.compileHeaders({ 'content-type': 'text/plain', 'x-compiled': 'yes', 'set-cookie': ['a=1', 'b=2'] });
+
+    let threw = false;
+
+    try {
+      LWSSocket.compileHeaders({ 'x-evil': 'a\r\nb' });
+    } catch(e) {
+      threw = e instanceof TypeError;
+    }
+
+    assert(threw, 'expected compileHeaders() to reject a value containing CRLF');
+
+    const server = echoServer(port, wsi => {
+      wsi.respond(200, 5, block);
+      wsi.write('hello', LWS_WRITE_HTTP_FINAL);
+    });
+
+    for(let i = 0; i < 2; i++) {
+      const resp = await fetch(`http://127.0.0.1:${port}/`, { keepAlive: false });
+
+      eq(200, resp.status);
+      eq('yes', resp.headers.get('x-compiled'));
+      eq('text/plain', resp.headers.get('content-type'));
+      assert(resp.headers.has('set-cookie'), 'expected the set-cookie lines');
+      eq('hello', await resp.text());
+    }
+
+    server.destroy();
+  },
+
+  async 'fetch(): a body write followed by an empty FINAL write ends the response exactly once'() {
+    // Both writes sit in the queue together, so the flush merges the empty
+    // FINAL chunk into the body write: that lws_write() must carry FINAL
+    // once and release the chunk, not send it again on its own. A body
+    // over one write's worth (16 KiB) is split, and no part but the last
+    // may claim FINAL.
+    const port = freePort();
+    const bodies = { '/small': 'hello', '/large': 'x'.repeat(40000) };
+    let handled = 0;
+
+    const server = echoServer(port, wsi => {
+      const body = bodies[wsi.uri];
+
+      handled++;
+      wsi.respond(200, { 'content-type': 'text/plain', 'content-length': String(body.length) });
+      wsi.write(body);
+      wsi.write('', LWS_WRITE_HTTP_FINAL);
+    });
+
+    for(const path of ['/small', '/large', '/small']) {
+      const resp = await fetch(`http://127.0.0.1:${port}${path}`);
+
+      eq(200, resp.status);
+      eq(bodies[path], await resp.text());
+    }
+
+    eq(3, handled);
+
+    server.destroy();
+  },
+
   async 'fetch(): follows a 3xx redirect automatically'() {
     const port = freePort();
 
@@ -1,5 +1,7 @@
 import { tests, eq, assert, assertStrictEquals, fail } from './tinytest.js';
 import { Headers } from '../../lib/lws/headers.js';
+import { createServer, LWSContext, LWSHeaders, LWSMPRO_CALLBACK, LWS_WRITE_HTTP_FINAL } from 'lws.so';
+import { freePort } from './subprocess-utils.js';
 
 await tests({
   'construct empty'() {
@@ -145,4 +147,108 @@ await tests({
     eq(2, obj['set-cookie'].length);
     eq('1', obj['x-a']);
   },
+
+  'copying a Headers does not share set-cookie arrays'() {
+    const a = new Headers();
+    a.append('set-cookie', 'a=1');
+    const b = new Headers(a);
+    b.append('set-cookie', 'b=2');
+    eq(1, a.getSetCookie().length);
+    eq(2, b.getSetCookie().length);
+  },
+
+  'fromNative() takes already-normalized native header objects as-is'() {
+    const native = Object.setPrototypeOf({ 'content-type': 'text/plain', 'x-a': '1' }, null);
+    const h = Headers.fromNative(native);
+    eq('text/plain', h.get('Content-Type'));
+    eq('1', h.get('x-a'));
+    eq('content-type,x-a', [...h.keys()].join(','));
+  },
+
+  'fromLWSHeaders() reads through the source and copies it only once modified'() {
+    const map = { host: 'example.com', 'x-a': '1' };
+    let copies = 0;
+    const native = {
+      get: name => map[name] ?? null,
+      has: name => name in map,
+      toObject: () => (copies++, { ...map }),
+    };
+    const h = Headers.fromLWSHeaders(native);
+    const copy = new Headers(h);
+    eq('example.com', h.get('Host'));
+    assertStrictEquals(true, copy.has('X-A'));
+    eq(0, copies);
+    h.set('x-b', '2');
+    eq(1, copies);
+    eq('host,x-a,x-b', [...h.keys()].join(','));
+    eq(null, copy.get('x-b'));
+    eq('host,x-a', [...copy.keys()].join(','));
+    eq(2, copies);
+  },
+
+  async 'LWSHeaders reads a live server request and keeps a snapshot once it completes'() {
+    const port = freePort();
+    let native, during;
+
+    const server = createServer({
+      port,
+      vhostName: 'localhost',
+      mounts: [{ mountpoint: '/', protocol: 'http', originProtocol: LWSMPRO_CALLBACK }],
+      protocols: [
+        {
+          name: 'http',
+          onHttp(wsi) {
+            native = new LWSHeaders(wsi);
+
+            const h = Headers.fromLWSHeaders(native);
+
+            during = { live: native.live, host: native.get('Host'), has: native.has('HOST'), absent: native.get('x-absent'), keys: [...h.keys()] };
+            wsi.respond(200, { 'content-length': '2' });
+            wsi.write('ok', LWS_WRITE_HTTP_FINAL);
+          },
+        },
+      ],
+    });
+
+    let ctx;
+    await new Promise((resolve, reject) => {
+      ctx = new LWSContext({
+        protocols: [
+          {
+            name: 'http',
+            onReceiveClientHttp(wsi) {
+              wsi.httpClientRead(new ArrayBuffer(4096));
+            },
+            onCompletedClientHttp() {
+              resolve();
+            },
+            onClosedClientHttp() {
+              resolve();
+            },
+            onClientConnectionError(wsi, msg) {
+              reject(new Error(msg));
+            },
+          },
+        ],
+      });
+      ctx.clientConnect({ address: 'localhost', port, path: '/', host: 'localhost', method: 'GET', protocol: 'http' });
+    });
+
+    assertStrictEquals(true, during.live);
+    eq('localhost', during.host);
+    assertStrictEquals(true, during.has);
+    assertStrictEquals(null, during.absent);
+    assert(during.keys.includes('host'), 'expected iteration to list host, got ' + during.keys.join(','));
+
+    // The response went out with LWS_WRITE_HTTP_FINAL, so lws has taken
+    // the header table back: what's left is the snapshot.
+    assertStrictEquals(false, native.live);
+    eq('localhost', native.get('host'));
+    assertStrictEquals(true, native.has('Host'));
+    eq('localhost', native.toObject().host);
+    eq('localhost', [...Headers.fromLWSHeaders(native)].find(([name]) => name === 'host')?.[1]);
+
+    ctx.destroy();
+    server.destroy();
+  },
 });
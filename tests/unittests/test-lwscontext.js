@@ -19,6 +19,310 @@ await tests({
     ctx.destroy();
   },
 
+  'writePool starts empty with the default cap'() {
+    const ctx = new LWSContext({ protocols: [{ name: 'http' }] });
+    const { hits, misses, retained, maxRetained } = ctx.writePool;
+    eq(0, hits);
+    eq(0, misses);
+    eq(0, retained);
+    eq(1048576, maxRetained);
+    ctx.destroy();
+  },
+
+  'writePoolMax option sets the write pool cap'() {
+    const ctx = new LWSContext({ protocols: [{ name: 'http' }], writePoolMax: 4096 });
+    eq(4096, ctx.writePool.maxRetained);
+    ctx.destroy();
+  },
+
+  'rxPool starts empty and honours rxPoolMax/rxPoolSize'() {
+    const dflt = new LWSContext({ protocols: [{ name: 'http' }] });
+    const { hits, misses, outstanding, retained, maxRetained, maxSpare } = dflt.rxPool;
+    eq(0, hits);
+    eq(0, misses);
+    eq(0, outstanding);
+    eq(0, retained);
+    eq(1048576, maxRetained);
+    eq(64, maxSpare);
+    dflt.destroy();
+
+    const ctx = new LWSContext({ protocols: [{ name: 'http' }], rxPoolMax: 8192, rx_pool_size: 4 });
+    eq(8192, ctx.rxPool.maxRetained);
+    eq(4, ctx.rxPool.maxSpare);
+    ctx.destroy();
+  },
+
+  'date is an RFC 7231 date string, cached within the second'() {
+    const ctx = new LWSContext({ protocols: [{ name: 'http' }] });
+    const a = ctx.date;
+    const b = ctx.date;
+    assert(/^(Sun|Mon|Tue|Wed|Thu|Fri|Sat), \d\d (Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Oct|Nov|Dec) \d{4} \d\d:\d\d:\d\d GMT$/.test(a), 'unexpected date: ' + a);
+    assert(a === b || Date.parse(b) - Date.parse(a) === 1000, 'expected both reads to agree: ' + a + ' / ' + b);
+    assert(Math.abs(Date.parse(a) - Date.now()) < 2000, 'expected the current time: ' + a);
+    ctx.destroy();
+  },
+
+  'serviceStats reflects the service budget options'() {
+    const dflt = new LWSContext({ protocols: [{ name: 'http' }] });
+    eq(64, dflt.serviceStats.budget);
+    eq(10000, dflt.serviceStats.budgetUs);
+    eq(0, dflt.serviceStats.exhausted);
+    dflt.destroy();
+
+    const ctx = new LWSContext({ protocols: [{ name: 'http' }], serviceBudget: 8, serviceBudgetUs: 0 });
+    eq(8, ctx.serviceStats.budget);
+    eq(0, ctx.serviceStats.budgetUs);
+    ctx.destroy();
+  },
+
+  async 'the service tick fires for a scheduled lws timer'() {
+    const ctx = new LWSContext({ protocols: [{ name: 'http' }] });
+    const { ticks } = ctx.serviceStats;
+
+    await new Promise(resolve => ctx.schedule(resolve, 20));
+
+    assert(ctx.serviceStats.ticks > ticks, 'expected at least one service tick');
+    const { nextTick } = ctx.serviceStats;
+    assert(nextTick === null || typeof nextTick == 'number', `unexpected nextTick ${nextTick}`);
+    ctx.destroy();
+  },
+
+  'pollBackend option selects the poll backend'() {
+    const ctx = new LWSContext({ protocols: [{ name: 'http' }], pollBackend: 'os' });
+    eq('os', ctx.pollBackend);
+    ctx.destroy();
+
+    const dflt = new LWSContext({ protocols: [{ name: 'http' }] });
+    assert(['os', 'epoll', 'io_uring'].includes(dflt.pollBackend), `unexpected pollBackend ${dflt.pollBackend}`);
+    dflt.destroy();
+  },
+
+  'pollBackend io_uring falls back when unavailable'() {
+    const ctx = new LWSContext({ protocols: [{ name: 'http' }], pollBackend: 'io_uring' });
+    assert(['os', 'epoll', 'io_uring'].includes(ctx.pollBackend), `unexpected pollBackend ${ctx.pollBackend}`);
+
+    if(ctx.pollBackend == 'io_uring') assert(ctx.uringStats.entries >= 256, 'expected at least uringEntries SQ entries');
+    else assert(!ctx.uringStats, 'expected no uringStats off the io_uring backend');
+
+    ctx.destroy();
+  },
+
+  'epollStats reports epoll_ctl accounting, or null on the os backend'() {
+    const os = new LWSContext({ protocols: [{ name: 'http' }], pollBackend: 'os' });
+    assert(os.epollStats === null || os.epollStats === undefined, 'expected no epollStats on the os backend');
+    os.destroy();
+
+    const ctx = new LWSContext({ protocols: [{ name: 'http' }], pollBackend: 'epoll', epollEdgeTriggered: true });
+
+    if(ctx.pollBackend == 'epoll') {
+      const stats = ctx.epollStats;
+      eq(true, stats.edgeTriggered);
+      eq(false, stats.exclusive);
+      eq(64, stats.batch);
+      assert(typeof stats.ctlCalls == 'number' && typeof stats.ctlPerSecond == 'number', 'expected numeric ctl counters');
+    }
+
+    ctx.destroy();
+  },
+
+  async 'a raw connection round-trips with either poll backend'() {
+    for(const [pollBackend, epollEdgeTriggered] of [
+      ['os', false],
+      ['epoll', false],
+      ['epoll', true],
+      ['io_uring', false],
+    ]) {
+      const port = freePort();
+      let resolveData, rejectClient;
+      const received = new Promise((resolve, reject) => {
+        resolveData = resolve;
+        rejectClient = reject;
+      });
+
+      const server = createServer({
+        port,
+        pollBackend,
+        epollEdgeTriggered,
+        epollExclusive: epollEdgeTriggered,
+        options: LWS_SERVER_OPTION_ONLY_RAW | LWS_SERVER_OPTION_FALLBACK_TO_APPLY_LISTEN_ACCEPT_CONFIG,
+        listenAcceptRole: 'raw-skt',
+        listenAcceptProtocol: 'raw',
+        protocols: [
+          {
+            name: 'raw',
+            onRawRx(wsi, data) {
+              resolveData(String.fromCharCode(...new Uint8Array(data)));
+            },
+          },
+        ],
+      });
+
+      const client = new LWSContext({
+        pollBackend,
+        epollEdgeTriggered,
+        protocols: [
+          {
+            name: 'raw',
+            onRawConnected(wsi) {
+              wsi.write('ping');
+            },
+            onClientConnectionError(wsi, msg) {
+              rejectClient(new Error(msg));
+            },
+          },
+        ],
+      });
+      client.clientConnect({ address: 'localhost', port, method: 'RAW', protocol: 'raw' });
+
+      eq('ping', await received);
+
+      client.destroy();
+      server.destroy();
+    }
+  },
+
+  async 'edge-triggered epoll: asking to write while idle costs no epoll_ctl()'() {
+    const port = freePort();
+    let resolveConnected, rejectClient;
+    const connected = new Promise((resolve, reject) => {
+      resolveConnected = resolve;
+      rejectClient = reject;
+    });
+
+    const server = createServer({
+      port,
+      options: LWS_SERVER_OPTION_ONLY_RAW | LWS_SERVER_OPTION_FALLBACK_TO_APPLY_LISTEN_ACCEPT_CONFIG,
+      listenAcceptRole: 'raw-skt',
+      listenAcceptProtocol: 'raw',
+      protocols: [{ name: 'raw' }],
+    });
+
+    const client = new LWSContext({
+      pollBackend: 'epoll',
+      epollEdgeTriggered: true,
+      protocols: [
+        {
+          name: 'raw',
+          onRawConnected(wsi) {
+            resolveConnected(wsi);
+          },
+          onClientConnectionError(wsi, msg) {
+            rejectClient(new Error(msg));
+          },
+        },
+      ],
+    });
+    client.clientConnect({ address: 'localhost', port, method: 'RAW', protocol: 'raw' });
+
+    const wsi = await connected;
+
+    if(client.pollBackend == 'epoll') {
+      // Each wantWrite() runs after the drain that delivered the last
+      // writable callback, so every one turns POLLOUT back on while idle.
+      const before = client.epollStats.ctlCalls;
+
+      for(let i = 0; i < 20; i++) await new Promise(r => wsi.wantWrite(r));
+
+      eq(before, client.epollStats.ctlCalls);
+    }
+
+    client.destroy();
+    server.destroy();
+  },
+
+  async 'copied RX data comes from the rx pool'() {
+    const port = freePort();
+    let resolveData, rejectClient;
+    const received = new Promise((resolve, reject) => {
+      resolveData = resolve;
+      rejectClient = reject;
+    });
+
+    const server = createServer({
+      port,
+      options: LWS_SERVER_OPTION_ONLY_RAW | LWS_SERVER_OPTION_FALLBACK_TO_APPLY_LISTEN_ACCEPT_CONFIG,
+      listenAcceptRole: 'raw-skt',
+      listenAcceptProtocol: 'raw',
+      protocols: [
+        {
+          name: 'raw',
+          onRawRx(wsi, data) {
+            resolveData(data);
+          },
+        },
+      ],
+    });
+
+    const client = new LWSContext({
+      protocols: [
+        {
+          name: 'raw',
+          onRawConnected(wsi) {
+            wsi.write('ping');
+          },
+          onClientConnectionError(wsi, msg) {
+            rejectClient(new Error(msg));
+          },
+        },
+      ],
+    });
+    client.clientConnect({ address: 'localhost', port, method: 'RAW', protocol: 'raw' });
+
+    const data = await received;
+    eq('ping', String.fromCharCode(...new Uint8Array(data)));
+    assert(server.rxPool.misses + server.rxPool.hits >= 1, 'expected the RX chunk to come from the pool');
+
+    client.destroy();
+    server.destroy();
+  },
+
+  async 'zeroCopyRx delivers RX data that is detached once the callback returns'() {
+    const port = freePort();
+    let resolveData, rejectClient, retained;
+    const received = new Promise((resolve, reject) => {
+      resolveData = resolve;
+      rejectClient = reject;
+    });
+
+    const server = createServer({
+      port,
+      options: LWS_SERVER_OPTION_ONLY_RAW | LWS_SERVER_OPTION_FALLBACK_TO_APPLY_LISTEN_ACCEPT_CONFIG,
+      listenAcceptRole: 'raw-skt',
+      listenAcceptProtocol: 'raw',
+      protocols: [
+        {
+          name: 'raw',
+          zeroCopyRx: true,
+          onRawRx(wsi, data) {
+            retained = data;
+            resolveData(String.fromCharCode(...new Uint8Array(data.slice())));
+          },
+        },
+      ],
+    });
+
+    const client = new LWSContext({
+      protocols: [
+        {
+          name: 'raw',
+          onRawConnected(wsi) {
+            wsi.write('ping');
+          },
+          onClientConnectionError(wsi, msg) {
+            rejectClient(new Error(msg));
+          },
+        },
+      ],
+    });
+    client.clientConnect({ address: 'localhost', port, method: 'RAW', protocol: 'raw' });
+
+    eq('ping', await received);
+    eq(0, retained.byteLength);
+
+    client.destroy();
+    server.destroy();
+  },
+
   'listening on a port succeeds and destroy() tears it down'() {
     const port = freePort();
     const ctx = createServer({ port, vhostName: 'localhost', protocols: [{ name: 'http' }] });
@@ -0,0 +1,174 @@
+/**
+ * Tests LWSRouter (lws-router.c, router.h): that match() picks the same
+ * route, with the same captures, as the first matching compilePath()
+ * regex would - static segments, :params, wildcards, mount prefixes and
+ * the root special cases - and that `from` walks the later matches in
+ * declaration order, the way App.dispatch() does. Also that a protocol's
+ * `router` answers routes with a static response (setResponse()) without
+ * calling onHttp.
+ */
+import { tests, eq, assert, assertStrictEquals } from './tinytest.js';
+import { createServer, LWSRouter, LWSSocket, LWSMPRO_CALLBACK, LWS_WRITE_HTTP_FINAL } from 'lws.so';
+import { compilePath } from '../../lib/lws/app.js';
+import { fetch } from '../../lib/fetch.js';
+import { freePort } from './subprocess-utils.js';
+
+const PATTERNS = [
+  ['/users/:id', true],
+  ['/users/me', true],
+  ['/api', false],
+  ['/static/*', true],
+  ['/a/*/z', true],
+  ['/p/:x/:y', true],
+  ['/', true],
+  ['*', true],
+];
+
+const PATHS = ['', '/', '/users/42', '/users/me', '/users/me/', '/users/', '/users/a%20b', '/api', '/api/v1/x', '/apix', '/static/', '/static/css/site.css', '/static', '/a/b/c/z', '/a//z', '/a/z', '/p/1/2', '/p/1', '/nope'];
+
+function router() {
+  const r = new LWSRouter();
+
+  for(const [pattern, end] of PATTERNS) r.add(pattern, end);
+
+  return r;
+}
+
+/* Every match for path as "index:capture,capture" strings, in order. */
+function viaRouter(r, path) {
+  const out = [];
+
+  for(let m, from = 0; (m = r.match(path, from)); from = m[0] + 1) out.push(m[0] + ':' + m.slice(1).join(','));
+
+  return out.join(' ');
+}
+
+function viaRegex(path) {
+  const out = [];
+
+  PATTERNS.forEach(([pattern, end], i) => {
+    const m = compilePath(pattern, end).regex.exec(path);
+
+    if(m) out.push(i + ':' + m.slice(1).join(','));
+  });
+
+  return out.join(' ');
+}
+
+await tests({
+  'add() returns consecutive indices and size counts them'() {
+    const r = new LWSRouter();
+
+    eq(0, r.add('/a'));
+    eq(1, r.add('/b/:c', false));
+    eq(2, r.size);
+    eq('[object LWSRouter]', Object.prototype.toString.call(r));
+  },
+
+  'match() returns [index, ...params] or null'() {
+    const r = router();
+    const m = r.match('/p/1/2');
+
+    assert(Array.isArray(m), 'expected an array');
+    eq(5, m[0]);
+    eq('1', m[1]);
+    eq('2', m[2]);
+    eq(3, m.length);
+    assertStrictEquals(null, new LWSRouter().match('/'));
+  },
+
+  'the lowest index wins, not the most specific route'() {
+    eq(0, router().match('/users/me')[0]);
+  },
+
+  'params are returned raw, not URI-decoded'() {
+    eq('a%20b', router().match('/users/a%20b')[1]);
+  },
+
+  'every match agrees with the compilePath() regexes'() {
+    const r = router();
+
+    for(const path of PATHS) {
+      const expected = viaRegex(path),
+        actual = viaRouter(r, path);
+
+      assert(expected === actual, `${JSON.stringify(path)}: expected "${expected}", got "${actual}"`);
+    }
+  },
+
+  'timeout is 0 until set, and never negative'() {
+    const router = new LWSRouter();
+
+    eq(0, router.timeout);
+    router.timeout = 30;
+    eq(30, router.timeout);
+    router.timeout = -1;
+    eq(0, router.timeout);
+  },
+
+  'compileResponse() reads the body only after the headers, which can detach it'() {
+    const body = new ArrayBuffer(64);
+    let threw = false;
+
+    try {
+      LWSSocket.compileResponse(
+        200,
+        {
+          get 'x-detach'() {
+            body.transfer();
+            return 'yes';
+          },
+        },
+        body,
+      );
+    } catch(e) {
+      threw = e instanceof TypeError;
+    }
+
+    assert(threw, 'expected a TypeError for the body detached by a header getter');
+  },
+
+  async 'a static response is sent without calling onHttp'() {
+    const port = freePort();
+    const router = new LWSRouter();
+    const response = LWSSocket.compileResponse(200, { 'content-type': 'application/json' }, '{"ok":true}');
+    let calls = 0;
+
+    eq(200, response.status);
+    eq(11, response.byteLength);
+
+    router.setResponse(router.add('/health'), response);
+    router.add('/dynamic');
+
+    const server = createServer({
+      port,
+      vhostName: 'localhost',
+      mounts: [{ mountpoint: '/', protocol: 'http', originProtocol: LWSMPRO_CALLBACK }],
+      protocols: [
+        {
+          name: 'http',
+          router,
+          onHttp(wsi) {
+            calls++;
+            wsi.respond(200, { 'content-type': 'text/plain' });
+            wsi.write('js', LWS_WRITE_HTTP_FINAL);
+          },
+        },
+      ],
+    });
+
+    for(let i = 0; i < 2; i++) {
+      const resp = await fetch(`http://127.0.0.1:${port}/health`, { keepAlive: false });
+
+      eq(200, resp.status);
+      eq('application/json', resp.headers.get('content-type'));
+      eq('{"ok":true}', await resp.text());
+    }
+
+    eq(0, calls);
+    eq('js', await (await fetch(`http://127.0.0.1:${port}/dynamic`, { keepAlive: false })).text());
+    eq(1, calls);
+
+    server.destroy();
+  },
+});
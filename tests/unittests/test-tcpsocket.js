@@ -22,7 +22,7 @@
  * counterpart.
  */
 import { tests, eq, assert, assertStrictEquals, fail } from './tinytest.js';
-import { createServer, LWSContext, toArrayBuffer, toString, LWS_SERVER_OPTION_ONLY_RAW, LWS_SERVER_OPTION_FALLBACK_TO_APPLY_LISTEN_ACCEPT_CONFIG } from 'lws.so';
+import { createServer, LWSContext, LWSSocket, toArrayBuffer, toString, LWS_SERVER_OPTION_ONLY_RAW, LWS_SERVER_OPTION_FALLBACK_TO_APPLY_LISTEN_ACCEPT_CONFIG } from 'lws.so';
 import { TCPSocket, CLOSED } from '../../lib/tcpsocket.js';
 import { TCPSocketStream } from '../../lib/tcpsocketstream.js';
 import { freePort } from './subprocess-utils.js';
@@ -63,8 +63,9 @@ function rawProtocolServer(port, protocol, entry) {
 /* Plain raw client, built directly on LWSContext - the mock counterpart for
    every `TCPSocket.listen()` (Bun API, server) test below, same role
    `rawClient()`-style helpers play in the `TCPSocket.protocol()` group
-   above. `onReceive`/`onError` are optional; `onConnected` always runs. */
-function rawClient(port, { onConnected, onReceive, onError } = {}) {
+   above. `onReceive`/`onClose`/`onError` are optional; `onConnected`
+   always runs. */
+function rawClient(port, { onConnected, onReceive, onClose, onError } = {}) {
   const ctx = new LWSContext({
     protocols: [
       {
@@ -75,6 +76,9 @@ function rawClient(port, { onConnected, onReceive, onError } = {}) {
         onRawRx(wsi, data) {
           onReceive?.(wsi, data);
         },
+        onRawClose(wsi) {
+          onClose?.(wsi);
+        },
         onClientConnectionError(wsi, msg) {
           if(onError) onError(msg);
           else fail('raw client connection error: ' + msg);
@@ -592,6 +596,124 @@ await tests({
     server.destroy();
   },
 
+  async 'TCPSocketStream: pipeTo() between two sockets relays in both directions, closing the other end'() {
+    const echoPort = freePort();
+    const echo = mockRawEchoServer(echoPort);
+    const port = freePort();
+    const payload = 'x'.repeat(256 * 1024);
+    let pipes;
+
+    const relay = rawProtocolServer(
+      port,
+      'relay',
+      TCPSocketStream.protocol('relay', async ts => {
+        const client = await ts.opened;
+        const onward = await new TCPSocketStream({ host: 'localhost', port: echoPort }).opened;
+
+        pipes = [client.readable.pipeTo(onward.writable), onward.readable.pipeTo(client.writable)];
+      }),
+    );
+
+    let got = 0, spliced;
+    let resolveEchoed;
+    const echoed = new Promise(resolve => (resolveEchoed = resolve));
+
+    const client = rawClient(port, {
+      onConnected: wsi => setTimeout(() => wsi.write(toArrayBuffer(payload)), 100),
+      onReceive: (wsi, data) => {
+        got += data.byteLength;
+
+        if(got >= payload.length) {
+          /* Both relay legs are still open here: each passed on the whole payload in C. */
+          spliced = LWSSocket.list().reduce((n, s) => n + (s.spliced ?? 0), 0);
+          resolveEchoed(got);
+          wsi.close();
+        }
+      },
+    });
+
+    eq(payload.length, await echoed);
+    eq(2 * payload.length, spliced);
+
+    /* The client leg closed first: its pipe ended normally, the one into it didn't. */
+    const [out, back] = await Promise.allSettled(pipes);
+
+    eq('fulfilled', out.status);
+    eq('rejected', back.status);
+
+    client.destroy();
+    relay.destroy();
+    echo.destroy();
+  },
+
+  async 'wsi.splice(): a socket spliced into one that is closing is stopped, not read and dropped'() {
+    // d -> c -> a: a closing closes c once drained, and c is then no
+    // destination for anything - d is closed as well instead of feeding it.
+    const port = freePort();
+    const hub = {}, unexpected = [];
+    let resplice, resolveSpliced, resolveClosed;
+    const spliced = new Promise(resolve => (resolveSpliced = resolve));
+    const closed = new Promise(resolve => (resolveClosed = resolve));
+
+    const server = rawProtocolServer(port, 'hub', {
+      name: 'hub',
+      onRawRx(wsi, data) {
+        const name = Object.keys(hub).find(k => hub[k] === wsi);
+
+        if(name) {
+          unexpected.push(name);
+          return;
+        }
+
+        hub[toString(data)] = wsi;
+
+        if(hub.a && hub.c && hub.d) {
+          assert(hub.d.splice(hub.c), 'expected d.splice(c) to succeed');
+          assert(hub.c.splice(hub.a), 'expected c.splice(a) to succeed');
+          resolveSpliced();
+        }
+      },
+      onRawClose(wsi) {
+        if(wsi === hub.a) resplice = hub.c.splice(hub.d);
+      },
+    });
+
+    const clients = {};
+    let atC = '';
+
+    for(const name of ['a', 'c', 'd'])
+      await new Promise(resolve => {
+        clients[name] = rawClient(port, {
+          onConnected: wsi => {
+            clients[name].wsi = wsi;
+            wsi.write(name);
+            setTimeout(resolve, 50);
+          },
+          onReceive: (wsi, data) => name === 'c' && (atC += toString(data)),
+          onClose: () => name === 'd' && resolveClosed(),
+        });
+      });
+
+    await spliced;
+
+    clients.d.wsi.write('before');
+    await new Promise(resolve => setTimeout(resolve, 100));
+    eq('before', atC);
+    eq(6, hub.d.spliced);
+
+    clients.a.wsi.close();
+
+    const timer = setInterval(() => clients.d.wsi.write('after'), 20);
+    await closed;
+    clearInterval(timer);
+
+    assertStrictEquals(false, resplice);
+    eq(0, unexpected.length);
+
+    for(const name in clients) clients[name].destroy();
+    server.destroy();
+  },
+
   async 'TCPSocketStream.protocol() (server): two concurrent connections stay independent'() {
     const port = freePort();
     const results = {};
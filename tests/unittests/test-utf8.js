@@ -0,0 +1,89 @@
+/**
+ * Tests the UTF-8 helpers on lws.so that sit on top of utf8.h: toString()
+ * in both modes (throwing on, or U+FFFD-replacing, malformed input -
+ * including inputs long enough for the vector ASCII scan to run into a
+ * multi-byte sequence or an error mid-block) and encodeInto(), which
+ * must only ever write whole characters and report `read` in UTF-16 code
+ * units, like TextEncoder.encodeInto().
+ */
+import { tests, eq, assert, fail } from './tinytest.js';
+import { toString, encodeInto } from 'lws.so';
+import { TextEncoder } from 'textcode';
+
+const bytes = (...parts) => new Uint8Array(parts.flatMap(p => (typeof p === 'string' ? [...new TextEncoder().encode(p)] : p))).buffer;
+
+const pad = 'x'.repeat(70);
+
+await tests({
+  'toString() decodes valid UTF-8, also past long ASCII runs'() {
+    eq('héllo €😀', toString(bytes('héllo €😀')));
+    eq(pad + 'é' + pad, toString(bytes(pad + 'é' + pad)));
+    eq('', toString(new ArrayBuffer(0)));
+  },
+
+  'toString() throws at the offset of the first malformed sequence'() {
+    for(const [buf, offset] of [
+      [bytes(pad, [0xff]), 70],
+      [bytes('ab', [0xc3]), 2],
+      [bytes([0xe0, 0x80, 0x80]), 0],
+      [bytes('a', [0xed, 0xa0, 0x80]), 1],
+      [bytes([0xf4, 0x90, 0x80, 0x80]), 0],
+    ]) {
+      try {
+        toString(buf);
+        fail('expected a throw');
+      } catch(e) {
+        assert(e instanceof TypeError && e.message.includes(`offset ${offset}:`), String(e));
+      }
+    }
+  },
+
+  'toString(buf, true) replaces malformed sequences with U+FFFD'() {
+    eq(pad + '�', toString(bytes(pad, [0xff]), true));
+    eq('a�b', toString(bytes('a', [0xe2, 0x82], 'b'), true));
+    eq('��', toString(bytes([0xe0, 0x80]), true));
+    eq('���a', toString(bytes([0xed, 0xa0, 0x80], 'a'), true));
+    eq('€�', toString(bytes('€', [0xf0, 0x9f, 0x98]), true));
+  },
+
+  'encodeInto() writes whole characters and counts UTF-16 units read'() {
+    const u8 = new Uint8Array(8);
+    const r = encodeInto('a€😀b', u8);
+
+    eq(8, r.written);
+    eq(4, r.read);
+    eq('a€😀', toString(u8.buffer, 0, r.written));
+
+    const short = encodeInto('a€😀', new Uint8Array(6));
+
+    eq(4, short.written);
+    eq(2, short.read);
+  },
+
+  'encodeInto() starts at the given offset, and writes a lone surrogate as U+FFFD'() {
+    const u8 = new Uint8Array(6).fill(0x2e);
+    const r = encodeInto('\ud800z', u8, 2);
+
+    eq(4, r.written);
+    eq(2, r.read);
+    eq('..�z', toString(u8.buffer));
+  },
+
+  'encodeInto() throws rather than writing into a buffer detached while converting its arguments'() {
+    for(const detachIn of ['string', 'offset']) {
+      const u8 = new Uint8Array(16);
+      const detach = v => (u8.buffer.transfer(), v);
+      const str = detachIn === 'string' ? { toString: () => detach('abc') } : 'abc';
+      const ofs = detachIn === 'offset' ? { valueOf: () => detach(1) } : 0;
+      let threw = false;
+
+      try {
+        encodeInto(str, u8, ofs);
+      } catch(e) {
+        threw = e instanceof TypeError;
+      }
+
+      assert(threw, `expected a TypeError when the ${detachIn} conversion detaches the buffer`);
+    }
+  },
+});
@@ -50,9 +50,9 @@
  * The equivalent isn't needed server-side: LWS_CALLBACK_ESTABLISHED has no
  * such special-cased rejection path.
  */
-import { tests, eq, assert } from './tinytest.js';
-import { createServer, LWSContext, LWSMPRO_NO_MOUNT, LWS_WRITE_TEXT } from 'lws.so';
-import { TextDecoder } from 'textcode';
+import { tests, eq, assert, fail } from './tinytest.js';
+import { createServer, LWSContext, LWSSocket, LWSMPRO_NO_MOUNT, LWS_WRITE_TEXT, LWS_WRITE_BINARY, LWS_WRITE_CONTINUATION, LWS_WRITE_NO_FIN } from 'lws.so';
+import { TextDecoder, TextEncoder } from 'textcode';
 import { freePort } from './subprocess-utils.js';
 
 // A fresh TextDecoder per call, not a shared module-level one: decode()
@@ -111,6 +111,302 @@ await tests({
     server.destroy();
   },
 
+  'LWSSocket.allocBuffer() leaves LWSSocket.PRE bytes of headroom'() {
+    const buf = LWSSocket.allocBuffer(10);
+    assert(buf instanceof Uint8Array, 'expected a Uint8Array');
+    eq(10, buf.length);
+    eq(LWSSocket.PRE, buf.byteOffset);
+    eq(LWSSocket.PRE + 10, buf.buffer.byteLength);
+  },
+
+  async 'client (raw): an allocBuffer() view is written without copying and left intact'() {
+    const port = freePort();
+    const text = 'pinned-hello';
+
+    const server = echoServer(port, {
+      onReceive(wsi, data) {
+        wsi.write(data);
+      },
+    });
+
+    // A view further into the buffer: the bytes in front of it are ours,
+    // and lws_write() must not leave its frame header in them.
+    const whole = LWSSocket.allocBuffer(64).fill(0x5a);
+    const view = whole.subarray(8, 8 + text.length);
+    for(let i = 0; i < text.length; i++) view[i] = text.charCodeAt(i);
+
+    let client, copies;
+    const chunks = () => client.writePool.hits + client.writePool.misses;
+    const received = new Promise((resolve, reject) => {
+      client = connect(port, {
+        onClientEstablished(wsi) {
+          const before = chunks();
+
+          wsi.write(view);
+          copies = chunks() - before;
+        },
+        onClientReceive(wsi, data) {
+          resolve(asText(data));
+        },
+        onClientConnectionError(wsi, msg) {
+          reject(new Error(msg));
+        },
+      });
+    });
+
+    eq(text, await received);
+    eq(0, copies);
+    assert(whole.subarray(0, 8).every(b => b == 0x5a), 'headroom in front of the payload was not restored');
+
+    client.destroy();
+    server.destroy();
+  },
+
+  async 'client (raw): allocBuffer() memory is recognized by address, not by its contents'() {
+    const port = freePort();
+
+    const server = echoServer(port, {
+      onReceive(wsi, data) {
+        wsi.write(data);
+      },
+    });
+
+    // A byte-for-byte copy of an allocBuffer() buffer is still someone
+    // else's memory; an allocBuffer() one with scribbled-on headroom is not.
+    const own = LWSSocket.allocBuffer(4);
+    const copy = new Uint8Array(own.buffer.slice(0));
+    const scribbled = LWSSocket.allocBuffer(4);
+
+    own.set([0x61, 0x62, 0x63, 0x64]);
+    copy.set(own, LWSSocket.PRE);
+    scribbled.set(own);
+    new Uint8Array(scribbled.buffer, 0, LWSSocket.PRE).fill(0xff);
+
+    let client;
+    const copies = [];
+    const chunks = () => client.writePool.hits + client.writePool.misses;
+    const received = new Promise((resolve, reject) => {
+      let text = '';
+
+      client = connect(port, {
+        onClientEstablished(wsi) {
+          for(const view of [copy.subarray(LWSSocket.PRE), scribbled]) {
+            const before = chunks();
+
+            wsi.write(view);
+            copies.push(chunks() - before);
+          }
+        },
+        onClientReceive(wsi, data) {
+          if((text += asText(data)).length == 8) resolve(text);
+        },
+        onClientConnectionError(wsi, msg) {
+          reject(new Error(msg));
+        },
+      });
+    });
+
+    eq('abcdabcd', await received);
+    eq(1, copies[0]);
+    eq(0, copies[1]);
+
+    client.destroy();
+    server.destroy();
+  },
+
+  async 'client (raw): any other view is copied, however much headroom it has'() {
+    const port = freePort();
+    const text = 'copied-hello';
+
+    const server = echoServer(port, {
+      onReceive(wsi, data) {
+        wsi.write(data);
+      },
+    });
+
+    const whole = new Uint8Array(LWSSocket.PRE + 64).fill(0x5a);
+    const view = whole.subarray(LWSSocket.PRE + 8, LWSSocket.PRE + 8 + text.length);
+    for(let i = 0; i < text.length; i++) view[i] = text.charCodeAt(i);
+
+    let client, copies;
+    const chunks = () => client.writePool.hits + client.writePool.misses;
+    const received = new Promise((resolve, reject) => {
+      client = connect(port, {
+        onClientEstablished(wsi) {
+          const before = chunks();
+
+          wsi.write(view);
+          copies = chunks() - before;
+          // The queued copy isn't affected by this.
+          view.fill(0x21);
+        },
+        onClientReceive(wsi, data) {
+          resolve(asText(data));
+        },
+        onClientConnectionError(wsi, msg) {
+          reject(new Error(msg));
+        },
+      });
+    });
+
+    eq(text, await received);
+    eq(1, copies);
+    assert(whole.subarray(0, LWSSocket.PRE + 8).every(b => b == 0x5a), 'bytes in front of the payload were touched');
+
+    client.destroy();
+    server.destroy();
+  },
+
+  async 'client (raw): wsi.writev() sends its pieces as one message'() {
+    const port = freePort();
+    const seen = [];
+
+    const server = echoServer(port, {
+      onReceive(wsi, data) {
+        seen.push(asText(data));
+        wsi.write(data, LWS_WRITE_TEXT);
+      },
+    });
+
+    let client;
+    const received = new Promise((resolve, reject) => {
+      client = connect(port, {
+        onClientEstablished(wsi) {
+          wsi.writev(['one-', new TextEncoder().encode('two-'), new TextEncoder().encode('three').buffer]);
+        },
+        onClientReceive(wsi, data) {
+          resolve(asText(data));
+        },
+        onClientConnectionError(wsi, msg) {
+          reject(new Error(msg));
+        },
+      });
+    });
+
+    eq('one-two-three', await received);
+    eq(1, seen.length);
+
+    client.destroy();
+    server.destroy();
+  },
+
+  async 'server (raw): reassemble delivers a fragmented message once, whole'() {
+    const port = freePort();
+    const seen = [];
+
+    const server = echoServer(port, {
+      reassemble: true,
+      onReceive(wsi, data, len, frame) {
+        seen.push({ data, len, frame });
+        wsi.write(data, LWS_WRITE_TEXT);
+      },
+    });
+
+    let client;
+    const received = new Promise((resolve, reject) => {
+      client = connect(port, {
+        onClientEstablished(wsi) {
+          wsi.write('one-', LWS_WRITE_TEXT | LWS_WRITE_NO_FIN);
+          wsi.write('two-', LWS_WRITE_CONTINUATION | LWS_WRITE_NO_FIN);
+          wsi.write('three', LWS_WRITE_CONTINUATION);
+        },
+        onClientReceive(wsi, data) {
+          resolve(asText(data));
+        },
+        onClientConnectionError(wsi, msg) {
+          reject(new Error(msg));
+        },
+      });
+    });
+
+    eq('one-two-three', await received);
+    eq(1, seen.length);
+    eq('string', typeof seen[0].data);
+    eq(13, seen[0].len);
+    eq(undefined, seen[0].frame);
+
+    client.destroy();
+    server.destroy();
+  },
+
+  async 'server (raw): reassemble keeps message boundaries when frames arrive split across reads'() {
+    // rx_buffer_size well under a frame: lws hands each frame over in
+    // several RECEIVE callbacks, and only the last one of the last frame
+    // may end the message.
+    const port = freePort();
+    const seen = [];
+    const frames = ['a', 'b', 'c', 'd', 'e'].map(c => c.repeat(3000));
+    let resolveAll;
+    const all = new Promise(resolve => (resolveAll = resolve));
+
+    const server = echoServer(port, {
+      reassemble: true,
+      rx_buffer_size: 512,
+      onReceive(wsi, data) {
+        seen.push(asText(data));
+
+        if(seen.length === 2) resolveAll();
+      },
+    });
+
+    const client = connect(port, {
+      onClientEstablished(wsi) {
+        wsi.write(frames[0], LWS_WRITE_TEXT | LWS_WRITE_NO_FIN);
+        wsi.write(frames[1], LWS_WRITE_CONTINUATION | LWS_WRITE_NO_FIN);
+        wsi.write(frames[2], LWS_WRITE_CONTINUATION);
+        wsi.write(frames[3], LWS_WRITE_TEXT | LWS_WRITE_NO_FIN);
+        wsi.write(frames[4], LWS_WRITE_CONTINUATION);
+      },
+      onClientConnectionError(wsi, msg) {
+        fail(msg);
+      },
+    });
+
+    await all;
+
+    eq(2, seen.length);
+    eq(frames.slice(0, 3).join(''), seen[0]);
+    eq(frames.slice(3).join(''), seen[1]);
+
+    client.destroy();
+    server.destroy();
+  },
+
+  async 'server (raw): a reassembled message past maxMessageSize closes with 1009'() {
+    const port = freePort();
+    let received = 0;
+
+    const server = echoServer(port, {
+      reassemble: true,
+      maxMessageSize: 8,
+      onReceive() {
+        received++;
+      },
+    });
+
+    let client;
+    const code = await new Promise((resolve, reject) => {
+      client = connect(port, {
+        onClientEstablished(wsi) {
+          wsi.write(new Uint8Array(6), LWS_WRITE_BINARY | LWS_WRITE_NO_FIN);
+          wsi.write(new Uint8Array(6), LWS_WRITE_CONTINUATION);
+        },
+        onWsPeerInitiatedClose(wsi, code) {
+          resolve(code);
+        },
+        onClientConnectionError(wsi, msg) {
+          reject(new Error(msg));
+        },
+      });
+    });
+
+    eq(1009, code);
+    eq(0, received);
+
+    client.destroy();
+    server.destroy();
+  },
+
   async 'server (raw): onClosed reports the code/reason the server itself sent (locally-initiated)'() {
     const port = freePort();
     let resolveClosed;
@@ -0,0 +1,224 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* UTF-8 scanning behind toString()/encodeInto() (lws.c) - the path every
+   text body takes on its way between ArrayBuffers and JS strings. Real
+   bodies are mostly ASCII, so everything here is built around
+   utf8_ascii_len(): the length of the leading ASCII run, found 32 bytes
+   at a time with AVX2 where the CPU has it (picked at runtime, no -mavx2
+   needed), 16 at a time with SSE2 (always there on x86-64), 8 at a time
+   otherwise. The multi-byte sequences in between are handled one by one,
+   by the WHATWG Encoding Standard's decoder rules (no overlongs, no
+   surrogates, nothing past U+10FFFF), after which the ASCII scan resumes.
+   Kept free of QuickJS/lws dependencies so tests/bench/bench-utf8.c can
+   build it on its own. */
+
+#if(defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define UTF8_SSE2 1
+#if defined(__x86_64__)
+#define UTF8_AVX2 1
+#endif
+#endif
+
+#define UTF8_HIGH_BITS 0x8080808080808080ULL
+
+static inline size_t
+utf8_ascii_len_scalar(const uint8_t* p, size_t n) {
+  size_t i = 0;
+
+  for(; i + 8 <= n; i += 8) {
+    uint64_t w;
+
+    memcpy(&w, p + i, 8);
+
+    if(w & UTF8_HIGH_BITS)
+      break;
+  }
+
+  while(i < n && p[i] < 0x80)
+    i++;
+
+  return i;
+}
+
+#ifdef UTF8_SSE2
+static inline size_t
+utf8_ascii_len_sse2(const uint8_t* p, size_t n) {
+  size_t i = 0;
+
+  for(; i + 16 <= n; i += 16) {
+    int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(p + i)));
+
+    if(mask)
+      return i + __builtin_ctz(mask);
+  }
+
+  return i + utf8_ascii_len_scalar(p + i, n - i);
+}
+#endif
+
+#ifdef UTF8_AVX2
+__attribute__((target("avx2"))) static inline size_t
+utf8_ascii_len_avx2(const uint8_t* p, size_t n) {
+  size_t i = 0;
+
+  for(; i + 32 <= n; i += 32) {
+    int mask = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(p + i)));
+
+    if(mask)
+      return i + __builtin_ctz(mask);
+  }
+
+  return i + utf8_ascii_len_sse2(p + i, n - i);
+}
+
+/* -1 until the first call asks the CPU. */
+static int utf8_have_avx2 = -1;
+#endif
+
+/* Length of the run of ASCII bytes p starts with. */
+static inline size_t
+utf8_ascii_len(const uint8_t* p, size_t n) {
+#ifdef UTF8_AVX2
+  if(utf8_have_avx2 < 0) {
+    __builtin_cpu_init();
+    utf8_have_avx2 = !!__builtin_cpu_supports("avx2");
+  }
+
+  /* Short runs aren't worth the wider registers. */
+  if(utf8_have_avx2 && n >= 64)
+    return utf8_ascii_len_avx2(p, n);
+#endif
+#ifdef UTF8_SSE2
+  return utf8_ascii_len_sse2(p, n);
+#else
+  return utf8_ascii_len_scalar(p, n);
+#endif
+}
+
+/* Length of the well-formed multi-byte sequence at p (2-4), or 0 if
+   there's none - p[0] is no lead byte, a continuation byte is out of the
+   range its lead allows, or the input ends early. *valid gets how many
+   bytes did fit before the sequence broke off, which the decoder turns
+   into one U+FFFD. */
+static inline size_t
+utf8_sequence(const uint8_t* p, size_t n, size_t* valid) {
+  uint8_t b = p[0], lower = 0x80, upper = 0xbf;
+  size_t len, i;
+
+  if(b >= 0xc2 && b <= 0xdf)
+    len = 2;
+  else if(b >= 0xe0 && b <= 0xef)
+    len = 3, lower = b == 0xe0 ? 0xa0 : 0x80, upper = b == 0xed ? 0x9f : 0xbf;
+  else if(b >= 0xf0 && b <= 0xf4)
+    len = 4, lower = b == 0xf0 ? 0x90 : 0x80, upper = b == 0xf4 ? 0x8f : 0xbf;
+  else
+    return *valid = 0;
+
+  for(i = 1; i < len; i++) {
+    if(i >= n || p[i] < lower || p[i] > upper) {
+      *valid = i;
+      return 0;
+    }
+
+    lower = 0x80;
+    upper = 0xbf;
+  }
+
+  return len;
+}
+
+/* Offset of the first byte of the first malformed sequence in p, or n if
+   all of it is valid UTF-8. */
+static inline size_t
+utf8_validate(const uint8_t* p, size_t n) {
+  size_t i = 0, len, valid;
+
+  for(;;) {
+    i += utf8_ascii_len(p + i, n - i);
+
+    if(i == n)
+      return n;
+
+    if(!(len = utf8_sequence(p + i, n - i, &valid)))
+      return i;
+
+    i += len;
+  }
+}
+
+/* WHATWG "decode" (non-fatal UTF-8): p is copied to out, each malformed
+   byte or sequence replaced with U+FFFD - a lead byte followed by too few
+   valid continuation bytes counts as one, and decoding picks up again at
+   the byte that broke it off. out needs room for 3 * n bytes (every byte
+   invalid). Returns the length of out. */
+static inline size_t
+utf8_decode_lossy(uint8_t* out, const uint8_t* p, size_t n) {
+  size_t i = 0, o = 0, len, valid;
+
+  for(;;) {
+    len = utf8_ascii_len(p + i, n - i);
+    memcpy(out + o, p + i, len);
+    i += len;
+    o += len;
+
+    if(i == n)
+      return o;
+
+    if((len = utf8_sequence(p + i, n - i, &valid))) {
+      memcpy(out + o, p + i, len);
+      i += len;
+      o += len;
+    } else {
+      memcpy(out + o, "\xef\xbf\xbd", 3);
+      i += valid ? valid : 1;
+      o += 3;
+    }
+  }
+}
+
+/* TextEncoder.encodeInto() on a string QuickJS has already turned into
+   UTF-8 (src, trusted to be well-formed apart from lone surrogates, which
+   it writes as 3-byte ED A0..BF sequences and this turns into U+FFFD, as
+   the encoder would): copies as many whole characters as fit into dst.
+   Returns the bytes written; *units gets the UTF-16 code units they were
+   in the string - encodeInto()'s `read`. */
+static inline size_t
+utf8_encode_into(uint8_t* dst, size_t dlen, const uint8_t* src, size_t slen, size_t* units) {
+  size_t i = 0, o = 0, len, room;
+
+  *units = 0;
+
+  for(;;) {
+    room = dlen - o < slen - i ? dlen - o : slen - i;
+    len = utf8_ascii_len(src + i, room);
+    memcpy(dst + o, src + i, len);
+    i += len;
+    o += len;
+    *units += len;
+
+    if(i == slen || o == dlen)
+      return o;
+
+    len = src[i] >= 0xf0 ? 4 : src[i] >= 0xe0 ? 3 : 2;
+
+    if(i + len > slen || o + len > dlen)
+      return o;
+
+    if(len == 3 && src[i] == 0xed && src[i + 1] >= 0xa0)
+      memcpy(dst + o, "\xef\xbf\xbd", 3);
+    else
+      memcpy(dst + o, src + i, len);
+
+    i += len;
+    o += len;
+    *units += len == 4 ? 2 : 1;
+  }
+}
+
+#endif /* defined UTF8_H */